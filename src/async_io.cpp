@@ -0,0 +1,181 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "async_io.hpp"
+#include <algorithm>
+
+/** Waits for all submitted requests and stops the ring or the thread pool */
+AsyncIO::~AsyncIO() {
+    // Request buffers are written until their request completes. Only a
+    // broken ring stops reporting completions, its buffers are leaked then
+    // because the kernel may still write to them.
+    while (!Requests.empty()) {
+        if (complete(true) == nullptr) {
+            for (std::unique_ptr<AsyncRequest>& request : Requests) {
+                request.release();
+            }
+            Requests.clear();
+        }
+    }
+
+    if (Ring != nullptr) {
+        closeAsyncRing(Ring);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(Lock);
+        Stopping = true;
+    }
+    QueueReady.notify_all();
+    for (std::thread& worker : Workers) {
+        worker.join();
+    }
+}
+
+/** Sets up an io_uring or the thread pool if there is none */
+void AsyncIO::start() {
+    Started = true;
+    Ring = openAsyncRing(ASYNC_MAX_PENDING);
+    if (Ring != nullptr) {
+        return;
+    }
+
+    for (size_t i = 0; i < ASYNC_WORKER_COUNT; i++) {
+        Workers.emplace_back([this]() { runWorker(); });
+    }
+}
+
+/** Performs queued requests until the pool stops */
+void AsyncIO::runWorker() {
+    std::unique_lock<std::mutex> guard(Lock);
+    while (true) {
+        QueueReady.wait(guard, [this]() { return Stopping || !Queue.empty(); });
+        if (Stopping) {
+            return;
+        }
+
+        AsyncRequest* request = Queue.front();
+        Queue.pop_front();
+        guard.unlock();
+
+        if (request->Write) {
+            request->Result =
+                writeHostFileAt(request->File, request->Data.data(),
+                                request->Data.size(), request->Offset);
+        } else {
+            request->Result =
+                readHostFileAt(request->File, request->Data.data(),
+                               request->Data.size(), request->Offset);
+        }
+
+        guard.lock();
+        Done.push_back(request);
+        DoneReady.notify_one();
+    }
+}
+
+/**
+ * Submits a request
+ * @param request Request with its file, offset and data
+ * @return On success returns the id of the request otherwise -1
+ */
+int64_t AsyncIO::submit(std::unique_ptr<AsyncRequest> request) {
+    if (Requests.size() >= ASYNC_MAX_PENDING) {
+        return -1;
+    }
+    if (!Started) {
+        start();
+    }
+
+    request->Id = NextId;
+    AsyncRequest* submitted = request.get();
+    if (Ring != nullptr) {
+        if (!submitAsyncRing(Ring, submitted)) {
+            return -1;
+        }
+    } else {
+        std::lock_guard<std::mutex> guard(Lock);
+        Queue.push_back(submitted);
+        QueueReady.notify_one();
+    }
+
+    NextId++;
+    Requests.push_back(std::move(request));
+    return static_cast<int64_t>(submitted->Id);
+}
+
+/**
+ * Takes a completed request
+ * @param block Wait until a request completes
+ * @return Completed request or nullptr if there is none or nothing is pending
+ */
+std::unique_ptr<AsyncRequest> AsyncIO::complete(bool block) {
+    if (Requests.empty()) {
+        return nullptr;
+    }
+
+    AsyncRequest* done = nullptr;
+    if (Ring != nullptr) {
+        done = reapAsyncRing(Ring, block);
+    } else {
+        std::unique_lock<std::mutex> guard(Lock);
+        if (block) {
+            DoneReady.wait(guard, [this]() { return !Done.empty(); });
+        }
+        if (!Done.empty()) {
+            done = Done.front();
+            Done.pop_front();
+        }
+    }
+    if (done == nullptr) {
+        return nullptr;
+    }
+
+    auto it = std::find_if(Requests.begin(), Requests.end(),
+                           [done](const std::unique_ptr<AsyncRequest>& req) {
+                               return req.get() == done;
+                           });
+    std::unique_ptr<AsyncRequest> request = std::move(*it);
+    Requests.erase(it);
+    return request;
+}
+
+/**
+ * Checks if a submitted request still uses a host file
+ * @param file Host file
+ * @return True if a request which has not been completed uses the file
+ */
+bool AsyncIO::usesFile(HostFile file) const {
+    for (const std::unique_ptr<AsyncRequest>& request : Requests) {
+        if (request->File == file) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Collects the guest buffers which submitted reads will write to once they
+ * are completed
+ * @param guestAddrs [out] Guest addresses of the buffers are appended
+ */
+void AsyncIO::pendingReads(std::vector<uint64_t>& guestAddrs) const {
+    for (const std::unique_ptr<AsyncRequest>& request : Requests) {
+        if (!request->Write) {
+            guestAddrs.push_back(request->GuestAddr);
+        }
+    }
+}
@@ -0,0 +1,106 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#pragma once
+#include "file_io.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Maximum number of requests which have not been completed by the program */
+constexpr size_t ASYNC_MAX_PENDING = 64;
+/** Number of threads performing requests if there is no io_uring */
+constexpr size_t ASYNC_WORKER_COUNT = 4;
+
+/** Operations of SYSCALL_ASYNC_SUBMIT */
+constexpr uint32_t ASYNC_OP_READ = 0x0;
+constexpr uint32_t ASYNC_OP_WRITE = 0x1;
+
+/** Queued file read or write */
+struct AsyncRequest {
+    /** Id returned to the program */
+    uint64_t Id = 0;
+    /** Host file */
+    HostFile File = INVALID_HOST_FILE;
+    /** Writes Data instead of reading into it */
+    bool Write = false;
+    /** File offset */
+    uint64_t Offset = 0;
+    /** Guest address of the buffer passed by the program */
+    uint64_t GuestAddr = 0;
+    /** Host side buffer, guest memory is not touched while in flight */
+    std::vector<uint8_t> Data;
+    /** Number of bytes transferred so far by the ring */
+    size_t Transferred = 0;
+    /** Number of bytes transferred or -1 */
+    int64_t Result = -1;
+};
+
+struct AsyncRing;
+
+/**
+ * Performs file reads and writes in the background. Uses an io_uring where
+ * the platform provides one and a pool of threads otherwise.
+ */
+class AsyncIO {
+  public:
+    AsyncIO() = default;
+    AsyncIO(const AsyncIO&) = delete;
+    AsyncIO& operator=(const AsyncIO&) = delete;
+    ~AsyncIO();
+
+    int64_t submit(std::unique_ptr<AsyncRequest> request);
+    std::unique_ptr<AsyncRequest> complete(bool block);
+    bool usesFile(HostFile file) const;
+    void pendingReads(std::vector<uint64_t>& guestAddrs) const;
+
+  private:
+    /** Submitted requests which have not been completed by the program */
+    std::vector<std::unique_ptr<AsyncRequest>> Requests;
+    /** Id of the next request */
+    uint64_t NextId = 1;
+    /** Has the ring or the thread pool been set up */
+    bool Started = false;
+    /** io_uring instance, nullptr if the thread pool is used */
+    AsyncRing* Ring = nullptr;
+    /** Thread pool */
+    std::vector<std::thread> Workers;
+    /** Guards Queue, Done and Stopping */
+    std::mutex Lock;
+    /** Signaled when a request is queued or the pool stops */
+    std::condition_variable QueueReady;
+    /** Signaled when a request is done */
+    std::condition_variable DoneReady;
+    /** Requests waiting for a worker */
+    std::deque<AsyncRequest*> Queue;
+    /** Requests performed by a worker */
+    std::deque<AsyncRequest*> Done;
+    /** Set to stop the workers */
+    bool Stopping = false;
+
+    void start();
+    void runWorker();
+};
+
+// Platform specific, implemented in platform/*_async.cpp
+AsyncRing* openAsyncRing(uint32_t entries);
+bool submitAsyncRing(AsyncRing* ring, AsyncRequest* request);
+AsyncRequest* reapAsyncRing(AsyncRing* ring, bool block);
+void closeAsyncRing(AsyncRing* ring);
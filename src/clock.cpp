@@ -0,0 +1,54 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "clock.hpp"
+#include <chrono>
+
+/** Time the cycle counter is compared against the monotonic clock */
+constexpr uint64_t CYCLE_CALIBRATION_NANOS = 10'000'000;
+
+/**
+ * Reads the monotonic clock
+ * @return Nanoseconds since an unspecified start
+ */
+uint64_t getMonotonicNanos() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+/**
+ * Measures the cycles per second of readCycleCounter() against the monotonic
+ * clock. Only the first call spends CYCLE_CALIBRATION_NANOS on measuring.
+ * @return Cycles per second
+ */
+uint64_t getCycleFrequency() {
+#ifdef UVM_HAS_TSC
+    static const uint64_t frequency = []() {
+        uint64_t startNanos = getMonotonicNanos();
+        uint64_t startCycles = readCycleCounter();
+        uint64_t nanos = 0;
+        do {
+            nanos = getMonotonicNanos() - startNanos;
+        } while (nanos < CYCLE_CALIBRATION_NANOS);
+        uint64_t cycles = readCycleCounter() - startCycles;
+        return static_cast<uint64_t>(static_cast<double>(cycles) * 1e9 /
+                                     static_cast<double>(nanos));
+    }();
+    return frequency;
+#else
+    return 1'000'000'000;
+#endif
+}
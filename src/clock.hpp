@@ -0,0 +1,45 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#pragma once
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UVM_HAS_TSC
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define UVM_HAS_TSC
+#endif
+
+uint64_t getMonotonicNanos();
+uint64_t getCycleFrequency();
+
+/**
+ * Reads the cycle counter. Uses the time stamp counter on x86, which is
+ * invariant on all recent CPUs, and the monotonic clock elsewhere.
+ * @return Cycles, ticking at getCycleFrequency()
+ */
+inline uint64_t readCycleCounter() {
+#ifdef UVM_HAS_TSC
+    return __rdtsc();
+#else
+    return getMonotonicNanos();
+#endif
+}
+
+// Platform specific, implemented in platform/*_clock.cpp
+uint64_t getThreadCpuNanos();
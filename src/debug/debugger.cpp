@@ -18,9 +18,30 @@
 #include "../error.hpp"
 #include "../instr/instructions.hpp"
 #include "http.hpp"
+#include <cstring>
 #include <iostream>
 #include <memory>
 
+/** Size of all register records of a full register dump */
+constexpr size_t DBG_REGS_SIZE = DBG_REG_COUNT * DBG_REG_RECORD_SIZE +
+                                 VEC_REG_COUNT * DBG_VEC_REG_RECORD_SIZE;
+
+/** Body size needed for the largest response without console output or memory
+ * content: magic, operation, pause reason and instruction pointer (larger than
+ * error code and status), register count and all register records */
+constexpr size_t RES_BODY_RESERVE = 8 + 1 + 1 + 8 + 1 + DBG_REGS_SIZE;
+
+/**
+ * Sets up the status, header fields and magic shared by every response
+ * @param res Response to initialize
+ */
+static void initResponse(Response& res) {
+    res.Code = ResponseCode::OK_200;
+    res.Headers["Access-Control-Allow-Origin"] = "*";
+    res.Body.reserve(RES_BODY_RESERVE);
+    res.append(&RES_MAGIC, 8);
+}
+
 /**
  * Starts a new debug session and awaits incoming handshake
  */
@@ -31,15 +52,13 @@ void Debugger::startSession() {
     Response closeSessionRes;
     closeSessionRes.Code = ResponseCode::OK_200;
     closeSessionRes.Headers["Access-Control-Allow-Origin"] = "*";
-    closeSessionRes.Body.write(reinterpret_cast<const char*>(&RES_MAGIC), 8);
-    closeSessionRes.Body << DBG_CLOSE_DBG_SESS;
+    closeSessionRes.append(&RES_MAGIC, 8);
+    closeSessionRes.append(DBG_CLOSE_DBG_SESS);
     closeSessionRes.fillBuffer();
 
     while (State != DbgSessState::CLOSED) {
         Response res;
-        res.Code = ResponseCode::OK_200;
-        res.Headers["Access-Control-Allow-Origin"] = "*";
-        res.Body.write(reinterpret_cast<const char*>(&RES_MAGIC), 8);
+        initResponse(res);
 
         Server.listenLoop(Req);
 
@@ -47,14 +66,33 @@ void Debugger::startSession() {
             std::cout << "[DEBUGGER] Error: could not handle request\n";
         }
 
-        if (State == DbgSessState::CLOSED) {
-            Server.sendReq(closeSessionRes.Stream);
-        } else {
+        if (ResponseDeferred) {
+            // A finished worker may still be answering its own parked client,
+            // which must not be replaced before it is closed
+            if (Worker.joinable()) {
+                Worker.join();
+            }
+
+            // The worker answers this client once execution stops
+            Server.parkClient();
+            startWorker();
+            ResponseDeferred = false;
+        } else if (ResponseStreamed) {
+            // The connection stays open until the trace is stopped
             res.fillBuffer();
-            Server.sendReq(res.Stream);
+            Server.beginStream(res);
+            startStreamer();
+            ResponseStreamed = false;
+        } else {
+            if (State == DbgSessState::CLOSED) {
+                Server.sendRes(closeSessionRes);
+            } else {
+                res.fillBuffer();
+                Server.sendRes(res);
+            }
+            Server.shutdownSock();
         }
         Req.reset();
-        Server.shutdownSock();
     }
 
     closeSession();
@@ -65,9 +103,97 @@ void Debugger::startSession() {
  */
 void Debugger::closeSession() {
     std::cout << "[DEBUGGER] Closing debug server...\n";
+    stopWorker();
+    stopTrace();
     Server.closeServer();
 }
 
+/**
+ * Stops the worker before the UVM instance it executes is destroyed
+ */
+Debugger::~Debugger() {
+    stopWorker();
+    stopTrace();
+}
+
+/**
+ * Executes the current UVM instance on the worker thread until a breakpoint is
+ * hit, a pause is requested or execution stops. The parked client receives
+ * the result of DeferredOp. The previous worker has to be joined already.
+ */
+void Debugger::startWorker() {
+    PauseRequested.store(false, std::memory_order_relaxed);
+    WorkerRunning.store(true, std::memory_order_release);
+    Worker = std::thread([this, op = DeferredOp]() {
+        uint32_t status = continueToBreakpoint();
+        if (Trace != nullptr) {
+            Trace->flush();
+        }
+
+        Response res;
+        initResponse(res);
+        appendExecResult(res, op, status);
+        res.fillBuffer();
+
+        // Hand the UVM instance back to the request loop before answering so
+        // that a client reacting on the response finds the VM idle
+        WorkerRunning.store(false, std::memory_order_release);
+        Server.sendParked(res);
+    });
+}
+
+/**
+ * Sends the records of the current tracer to the stream client until the
+ * trace is stopped
+ */
+void Debugger::startStreamer() {
+    Streamer = std::thread([this]() {
+        Trace->drain([this](const uint8_t* data, size_t size) {
+            return Server.sendChunk(data, size);
+        });
+        Server.endStream();
+    });
+}
+
+/**
+ * Closes the trace stream after all recorded instructions have been sent
+ */
+void Debugger::stopTrace() {
+    if (Trace == nullptr) {
+        return;
+    }
+
+    Trace->close();
+    Streamer.join();
+    Trace.reset();
+}
+
+/**
+ * Executes a single instruction and records it if a trace stream is open
+ * @return On success returns UVM_SUCCESS otherwise error code
+ */
+uint32_t Debugger::stepInstr() {
+    if (Trace == nullptr) {
+        return VM->nextInstr();
+    }
+
+    Trace->begin(VM->MMU);
+    uint32_t status = VM->nextInstr();
+    Trace->commit(VM->MMU, VM->Opcode);
+    return status;
+}
+
+/**
+ * Requests the worker to pause and waits until it has stopped
+ */
+void Debugger::stopWorker() {
+    if (Worker.joinable()) {
+        PauseRequested.store(true, std::memory_order_relaxed);
+        Worker.join();
+        PauseRequested.store(false, std::memory_order_relaxed);
+    }
+}
+
 /**
  * Handles an incoming request
  * @param res Response which on valid request will hold the response data
@@ -82,6 +208,25 @@ bool Debugger::handleRequest(Response& res) {
     }
 
     uint8_t operation = buff[8];
+
+    // The worker owns the UVM instance, breakpoints and session options until
+    // it stops
+    bool workerStopped = false;
+    if (WorkerRunning.load(std::memory_order_acquire)) {
+        switch (operation) {
+        case DBG_PAUSE:
+        case DBG_STOP_EXE:
+        case DBG_CLOSE_DBG_SESS:
+            stopWorker();
+            workerStopped = true;
+            break;
+        default:
+            res.append(DBG_ERROR);
+            res.append(ERR_VM_RUNNING);
+            return false;
+        }
+    }
+
     switch (operation) {
     // If the server is already in a debugging session and we receive another
     // request for a debug session send appropriate error
@@ -109,13 +254,14 @@ bool Debugger::handleRequest(Response& res) {
             }
 
             res.Code = ResponseCode::OK_200;
-            res.Body << DBG_OPEN_DBG_SESS;
+            res.append(DBG_OPEN_DBG_SESS);
 
             State = DbgSessState::RUNNING;
 
             return true;
         } else {
-            res.Body << DBG_ERROR << ERR_ALREADY_IN_DEBUG_SESSION;
+            res.append(DBG_ERROR);
+            res.append(ERR_ALREADY_IN_DEBUG_SESSION);
             return false;
         }
     } break;
@@ -124,7 +270,8 @@ bool Debugger::handleRequest(Response& res) {
             State = DbgSessState::CLOSED;
             return true;
         } else {
-            res.Body << DBG_ERROR << ERR_NOT_IN_DEBUG_SESSION;
+            res.append(DBG_ERROR);
+            res.append(ERR_NOT_IN_DEBUG_SESSION);
             return false;
         }
     }
@@ -150,71 +297,51 @@ bool Debugger::handleRequest(Response& res) {
             }
 
             if (VM->loadFile(fileBuff, fileSize) != UVM_SUCCESS) {
-                res.Body << DBG_ERROR << ERR_FILE_FORMAT_ERROR;
+                res.append(DBG_ERROR);
+                res.append(ERR_FILE_FORMAT_ERROR);
                 return false;
             }
             VM->Mode = ExecutionMode::DEBUGGER;
+            VM->enableHeapProfile();
+            ExitHeapReport.clear();
 
             if (!VM->init()) {
-                res.Body << DBG_ERROR << ERR_FILE_FORMAT_ERROR;
+                res.append(DBG_ERROR);
+                res.append(ERR_FILE_FORMAT_ERROR);
                 return false;
             }
+
+            // The client has not seen any register of the new instance yet
+            LastRegistersValid = false;
+            OnBreakpoint = false;
         } else {
-            res.Body << DBG_ERROR << ERR_NOT_IN_DEBUG_SESSION;
+            res.append(DBG_ERROR);
+            res.append(ERR_NOT_IN_DEBUG_SESSION);
             return false;
         }
 
-        // Either succeds or contains runtime error code
-        uint32_t status = continueToBreakpoint();
-
-        if (status != UVM_SUCCESS) {
-            res.Body << DBG_ERROR;
-            res.Body << ERR_RUNTIME_ERROR;
-            res.Body.write(reinterpret_cast<char*>(&status), 4);
-            appendRegisters(res.Body);
-            appendConsole(res.Body);
-        } else if (VM->Opcode == OP_EXIT) {
-            res.Body << DBG_EXE_FIN;
-            appendRegisters(res.Body);
-            appendConsole(res.Body);
-            VM.reset();
-            OnBreakpoint = false;
-        } else if (OnBreakpoint) {
-            res.Body << DBG_RUN_APP;
-            appendRegisters(res.Body);
-            appendConsole(res.Body);
-        }
+        ResponseDeferred = true;
+        DeferredOp = DBG_RUN_APP;
     } break;
     case DBG_NEXT_INSTR: {
         // TODO: ERR_NO_UX_FILE
         if (State == DbgSessState::RUNNING) {
-            uint32_t status = VM->nextInstr();
-
-            if (status != UVM_SUCCESS) {
-                res.Body << DBG_ERROR;
-                res.Body << ERR_RUNTIME_ERROR;
-                res.Body << status;
-                appendRegisters(res.Body);
-                appendConsole(res.Body);
-            } else if (VM->Opcode == OP_EXIT) {
-                res.Body << DBG_EXE_FIN;
-                appendRegisters(res.Body);
-                appendConsole(res.Body);
-                VM.reset();
-            } else {
-                res.Body << DBG_NEXT_INSTR;
-                appendRegisters(res.Body);
-                appendConsole(res.Body);
+            uint32_t status = stepInstr();
+            if (Trace != nullptr) {
+                Trace->flush();
             }
+            OnBreakpoint = false;
+            appendExecResult(res, DBG_NEXT_INSTR, status);
         } else {
-            res.Body << DBG_ERROR << ERR_NOT_IN_DEBUG_SESSION;
+            res.append(DBG_ERROR);
+            res.append(ERR_NOT_IN_DEBUG_SESSION);
         }
     } break;
     case DBG_SET_BREAKPNT: {
         // TODO: Range check parameter. What if breakpoint already exists?
         uint64_t breakpoint = *reinterpret_cast<uint64_t*>(&buff[9]);
         Breakpoints.push_back(breakpoint);
-        res.Body << DBG_SET_BREAKPNT;
+        res.append(DBG_SET_BREAKPNT);
     } break;
     case DBG_REMOVE_BREAKPNT: {
         uint64_t breakpoint = *reinterpret_cast<uint64_t*>(&buff[9]);
@@ -229,39 +356,142 @@ bool Debugger::handleRequest(Response& res) {
         }
 
         Breakpoints.erase(Breakpoints.begin() + index);
-        res.Body << DBG_REMOVE_BREAKPNT;
+        res.append(DBG_REMOVE_BREAKPNT);
     } break;
     case DBG_CONTINUE_: {
         if (State != DbgSessState::RUNNING) {
-            res.Body << DBG_ERROR << ERR_NOT_IN_DEBUG_SESSION;
+            res.append(DBG_ERROR);
+            res.append(ERR_NOT_IN_DEBUG_SESSION);
             return false;
         }
 
-        // Either succeds or contains runtime error code
-        uint32_t status = continueToBreakpoint();
+        if (VM == nullptr) {
+            res.append(DBG_ERROR);
+            res.append(ERR_NO_UX_FILE);
+            return false;
+        }
 
-        if (status != UVM_SUCCESS) {
-            res.Body << DBG_ERROR;
-            res.Body << ERR_RUNTIME_ERROR;
-            res.Body << status;
-            appendRegisters(res.Body);
-            appendConsole(res.Body);
-        } else if (VM->Opcode == OP_EXIT) {
-            res.Body << DBG_EXE_FIN;
-            appendRegisters(res.Body);
-            appendConsole(res.Body);
-            VM.reset();
-        } else if (OnBreakpoint) {
-            res.Body << DBG_CONTINUE_;
-            appendRegisters(res.Body);
-            appendConsole(res.Body);
+        ResponseDeferred = true;
+        DeferredOp = DBG_CONTINUE_;
+    } break;
+    case DBG_PAUSE: {
+        if (VM == nullptr) {
+            res.append(DBG_ERROR);
+            res.append(ERR_NO_UX_FILE);
+            return false;
         }
+
+        // A worker which reached a breakpoint first did not need the pause
+        uint8_t reason = DBG_PAUSE_IDLE;
+        if (OnBreakpoint) {
+            reason = DBG_PAUSE_BREAKPOINT;
+        } else if (workerStopped) {
+            reason = DBG_PAUSE_STOPPED;
+        }
+        appendPause(res, reason);
+        appendRegisters(res);
+    } break;
+    case DBG_SET_OPTIONS: {
+        constexpr size_t MIN_VALID_REQ_SIZE = 10;
+        if (Req.ContentLength < MIN_VALID_REQ_SIZE) {
+            return false;
+        }
+
+        uint8_t options = buff[9];
+        DeltaRegisters = (options & DBG_OPT_DELTA_REGS) != 0;
+        // Next register dump has to contain every register again
+        LastRegistersValid = false;
+        res.append(DBG_SET_OPTIONS);
+    } break;
+    case DBG_READ_MEM: {
+        // Request layout: <magic> <op> <u64 vAddr> <u32 size>
+        constexpr size_t MIN_VALID_REQ_SIZE = 21;
+        if (Req.ContentLength < MIN_VALID_REQ_SIZE) {
+            return false;
+        }
+
+        if (VM == nullptr) {
+            res.append(DBG_ERROR);
+            res.append(ERR_NO_UX_FILE);
+            return false;
+        }
+
+        uint64_t vAddr = 0;
+        uint32_t size = 0;
+        std::memcpy(&vAddr, &buff[9], 8);
+        std::memcpy(&size, &buff[17], 4);
+
+        if (size > DBG_MAX_MEM_READ) {
+            res.append(DBG_ERROR);
+            res.append(ERR_INVALID_MEM_RANGE);
+            return false;
+        }
+
+        appendMemory(res, vAddr, size);
+    } break;
+    case DBG_TRACE: {
+        // Request layout: <magic> <op> <u8 enable>
+        constexpr size_t MIN_VALID_REQ_SIZE = 10;
+        if (Req.ContentLength < MIN_VALID_REQ_SIZE) {
+            return false;
+        }
+
+        // Only a single trace stream can be open at once
+        stopTrace();
+        if (buff[9] != 0) {
+            Trace = std::make_unique<Tracer>();
+            res.Chunked = true;
+            ResponseStreamed = true;
+        }
+        res.append(DBG_TRACE);
+    } break;
+    case DBG_HEAP_PROFILE: {
+        // Response layout: <op> <report text>. Once the program finished the
+        // report made at its exit is sent.
+        if (VM == nullptr && ExitHeapReport.empty()) {
+            res.append(DBG_ERROR);
+            res.append(ERR_NO_UX_FILE);
+            return false;
+        }
+
+        std::string report =
+            VM != nullptr ? VM->HeapProfile->report(false) : ExitHeapReport;
+        res.append(DBG_HEAP_PROFILE);
+        res.append(report.data(), report.size());
+    } break;
+    case DBG_MEM_USAGE: {
+        // Response layout: <op> <u64 total> <u64 heap> <u64 stack>
+        // <u64 sections> <u64 bookkeeping> <u64 mapped> <u64 soft limit>
+        // <u64 hard limit> <u64 async>
+        if (VM == nullptr) {
+            res.append(DBG_ERROR);
+            res.append(ERR_NO_UX_FILE);
+            return false;
+        }
+
+        MemUsage usage = VM->MMU.usage();
+        uint64_t values[] = {usage.total(),
+                             usage.HeapBytes,
+                             usage.StackBytes,
+                             usage.SectionBytes,
+                             usage.MetaBytes,
+                             usage.MappedBytes,
+                             VM->MMU.Quota.SoftLimit,
+                             VM->MMU.Quota.HardLimit,
+                             usage.AsyncBytes};
+        res.append(DBG_MEM_USAGE);
+        res.append(values, sizeof(values));
     } break;
     case DBG_STOP_EXE: {
-        // TODO: Does UVM even run?
-        res.Body << DBG_STOP_EXE;
-        appendRegisters(res.Body);
-        appendConsole(res.Body);
+        if (VM == nullptr) {
+            res.append(DBG_ERROR);
+            res.append(ERR_NO_UX_FILE);
+            return false;
+        }
+
+        res.append(DBG_STOP_EXE);
+        appendRegisters(res);
+        appendConsole(res);
         VM.reset();
         OnBreakpoint = false;
     } break;
@@ -273,58 +503,171 @@ bool Debugger::handleRequest(Response& res) {
     return true;
 }
 
+static_assert(DBG_REG_COUNT == REG_FILE_SIZE - REG_INSTR_PTR,
+              "debugger registers have to match the register file");
+
 /**
- * Appends register data to the given stream
- * @param stream Target stream
+ * Reads all registers in the order of their register ids
+ * @param regs Output register values
  */
-void Debugger::appendRegisters(std::stringstream& stream) {
-    // Instruction pointer
-    stream << static_cast<char>(0x1);
-    stream.write(reinterpret_cast<char*>(&VM->MMU.IP), 8);
-    // Stack pointer
-    stream << static_cast<char>(0x2);
-    stream.write(reinterpret_cast<char*>(&VM->MMU.SP), 8);
-    // Base pointer
-    stream << static_cast<char>(0x3);
-    stream.write(reinterpret_cast<char*>(&VM->MMU.BP), 8);
-    // Flags
-    stream << static_cast<char>(0x4);
+void Debugger::readRegisters(std::array<uint64_t, DBG_REG_COUNT>& regs) {
+    // The register file shares the layout, id 0 is not a register
+    std::memcpy(regs.data(), &VM->MMU.Regs[REG_INSTR_PTR], sizeof(regs));
+
     uint64_t Flags = 0;
     uint64_t Carry = static_cast<uint64_t>(VM->MMU.Flags.Carry) << 63;
-    uint64_t Zero = static_cast<uint64_t>(VM->MMU.Flags.Zero) << 62;
-    uint64_t Signed = static_cast<uint64_t>(VM->MMU.Flags.Signed) << 61;
+    uint64_t Zero = static_cast<uint64_t>(VM->MMU.Flags.isZero()) << 62;
+    uint64_t Signed = static_cast<uint64_t>(VM->MMU.Flags.isSigned()) << 61;
     Flags |= Carry;
     Flags |= Zero;
     Flags |= Signed;
-    stream.write(reinterpret_cast<char*>(&Flags), 8);
+    regs[REG_FLAGS - REG_INSTR_PTR] = Flags;
+}
 
-    uint8_t regId = 0x5;
-    for (IntVal& val : VM->MMU.GP) {
-        stream << regId;
-        stream.write(reinterpret_cast<char*>(&val.I64), 8);
-        regId++;
+/**
+ * Appends register data to the given response. Every register is sent as a
+ * tagged record <id> <value>, followed by the vector registers as tagged
+ * records <id> <u128 value>. If the client enabled DBG_OPT_DELTA_REGS the
+ * records are prefixed with their count and only registers which changed since
+ * the last dump are sent.
+ * @param res Target response
+ */
+void Debugger::appendRegisters(Response& res) {
+    std::array<uint64_t, DBG_REG_COUNT> regs;
+    readRegisters(regs);
+    const std::array<VecVal, VEC_REG_COUNT>& vecRegs = VM->MMU.VecRegs;
+
+    // Write records directly into the already reserved body
+    size_t countOffset = res.Body.size();
+    res.Body.resize(countOffset + 1 + DBG_REGS_SIZE);
+    uint8_t* cursor = &res.Body[countOffset + 1];
+
+    uint8_t count = 0;
+    for (size_t i = 0; i < DBG_REG_COUNT; i++) {
+        if (DeltaRegisters && LastRegistersValid &&
+            regs[i] == LastRegisters[i]) {
+            continue;
+        }
+        // Register ids start at 0x1 (ip)
+        cursor[0] = static_cast<uint8_t>(i + 1);
+        std::memcpy(&cursor[1], &regs[i], 8);
+        cursor += DBG_REG_RECORD_SIZE;
+        count++;
     }
-    for (FloatVal& val : VM->MMU.FP) {
-        stream << regId;
-        stream.write(reinterpret_cast<char*>(&val.F64), 8);
-        regId++;
+    for (size_t i = 0; i < VEC_REG_COUNT; i++) {
+        if (DeltaRegisters && LastRegistersValid &&
+            std::memcmp(&vecRegs[i], &LastVecRegisters[i], 16) == 0) {
+            continue;
+        }
+        cursor[0] = static_cast<uint8_t>(i + REG_VEC_START);
+        std::memcpy(&cursor[1], &vecRegs[i], 16);
+        cursor += DBG_VEC_REG_RECORD_SIZE;
+        count++;
+    }
+
+    res.Body.resize(cursor - res.Body.data());
+    if (DeltaRegisters) {
+        res.Body[countOffset] = count;
+    } else {
+        // Full dumps have a fixed size and no count prefix
+        res.Body.erase(res.Body.begin() + countOffset);
     }
+
+    LastRegisters = regs;
+    LastVecRegisters = vecRegs;
+    LastRegistersValid = true;
 }
 
 /**
- * Appends console output to given stream and flushes console
- * @param stream Target stream
+ * Appends <DBG_PAUSE> <u8 reason> <u64 ip>. The header tells the client where
+ * execution stands even if a delta register dump has no records.
+ * @param res Target response
+ * @param reason Pause reason, one of DBG_PAUSE_*
  */
-void Debugger::appendConsole(std::stringstream& stream) {
-    stream << VM->DbgConsole.rdbuf();
-    // Clear console
-    VM->DbgConsole.str(std::string());
+void Debugger::appendPause(Response& res, uint8_t reason) {
+    res.append(DBG_PAUSE);
+    res.append(reason);
+    res.append(&VM->MMU.Regs[REG_INSTR_PTR].I64, 8);
+}
+
+/**
+ * Appends console output to given response and flushes console
+ * @param res Target response
+ */
+void Debugger::appendConsole(Response& res) {
+    res.append(VM->DbgConsole.data(), VM->DbgConsole.size());
     VM->DbgConsole.clear();
 }
 
 /**
- * Executes bytecode until breakpoint is hit, runtime error occures or code is
- * finished
+ * Appends a memory range of the current UVM instance as
+ * <DBG_READ_MEM> <u32 size> <bytes> or an error if the range is not readable
+ * @param res Target response
+ * @param vAddr Virtual start address
+ * @param size Size of memory range in bytes
+ */
+void Debugger::appendMemory(Response& res, uint64_t vAddr, uint32_t size) {
+    size_t headerOffset = res.Body.size();
+    res.Body.resize(headerOffset + 5 + size);
+    res.Body[headerOffset] = DBG_READ_MEM;
+    std::memcpy(&res.Body[headerOffset + 1], &size, 4);
+
+    uint32_t readRes =
+        VM->MMU.readLarge(vAddr, &res.Body[headerOffset + 5], size, 0);
+    if (readRes != UVM_SUCCESS) {
+        res.Body.resize(headerOffset);
+        res.append(DBG_ERROR);
+        res.append(ERR_INVALID_MEM_RANGE);
+    }
+}
+
+/**
+ * Appends the outcome of executing the UVM instance: a runtime error, the end
+ * of execution or the given operation if execution stopped on a breakpoint,
+ * after a single step or on a pause request
+ * @param res Target response
+ * @param op Operation which started execution
+ * @param status Execution status returned by the UVM
+ */
+void Debugger::appendExecResult(Response& res, uint8_t op, uint32_t status) {
+    if (status != UVM_SUCCESS) {
+        res.append(DBG_ERROR);
+        res.append(ERR_RUNTIME_ERROR);
+        res.append(&status, 4);
+        appendRegisters(res);
+        appendConsole(res);
+    } else if (VM->Opcode == OP_EXIT) {
+        res.append(DBG_EXE_FIN);
+        appendRegisters(res);
+        appendConsole(res);
+        ExitHeapReport = VM->HeapProfile->report(true);
+        VM.reset();
+        OnBreakpoint = false;
+    } else {
+        if (!OnBreakpoint && PauseRequested.load(std::memory_order_relaxed)) {
+            appendPause(res, DBG_PAUSE_STOPPED);
+        } else {
+            res.append(op);
+        }
+        appendRegisters(res);
+        appendConsole(res);
+    }
+}
+
+/**
+ * Checks if an opcode ends a basic block
+ * @param opcode Opcode of the executed instruction
+ * @return Returns true for jumps, calls and returns
+ */
+static inline bool isBlockEnd(uint8_t opcode) {
+    return (opcode >= OP_JMP && opcode <= OP_JLE) || opcode == OP_CALL ||
+           opcode == OP_RET;
+}
+
+/**
+ * Executes bytecode until breakpoint is hit, runtime error occures, a pause is
+ * requested or code is finished. Pause requests are only checked at the end of
+ * basic blocks.
  * @return On success returns UVM_SUCCESS otherwise returns error code
  */
 uint32_t Debugger::continueToBreakpoint() {
@@ -333,13 +676,13 @@ uint32_t Debugger::continueToBreakpoint() {
     uint32_t exeStatus = UVM_SUCCESS;
     while (VM->Opcode != OP_EXIT && exeStatus == UVM_SUCCESS) {
         if (OnBreakpoint) {
-            exeStatus = VM->nextInstr();
+            exeStatus = stepInstr();
             OnBreakpoint = false;
         } else {
             // Check if current instruction pointer is a breakpoint
             bool isBreakpoint = false;
             for (uint32_t i = 0; i < Breakpoints.size(); i++) {
-                if (Breakpoints[i] == VM->MMU.IP) {
+                if (Breakpoints[i] == VM->MMU.Regs[REG_INSTR_PTR].I64) {
                     isBreakpoint = true;
                     break;
                 }
@@ -349,9 +692,14 @@ uint32_t Debugger::continueToBreakpoint() {
                 OnBreakpoint = true;
                 break;
             } else {
-                exeStatus = VM->nextInstr();
+                exeStatus = stepInstr();
             }
         }
+
+        if (isBlockEnd(VM->Opcode) &&
+            PauseRequested.load(std::memory_order_relaxed)) {
+            break;
+        }
     }
 
     return exeStatus;
@@ -17,8 +17,13 @@
 #pragma once
 #include "../uvm.hpp"
 #include "http.hpp"
+#include "tracer.hpp"
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 
 constexpr uint64_t REQ_MAGIC = 0x3f697a65bcc37247;
@@ -27,13 +32,19 @@ constexpr uint64_t RES_MAGIC = 0x4772C3BC657A6921;
 // Operation codes
 constexpr uint8_t DBG_OPEN_DBG_SESS = 0x01;
 constexpr uint8_t DBG_CLOSE_DBG_SESS = 0x02;
+constexpr uint8_t DBG_SET_OPTIONS = 0x03;
 constexpr uint8_t DBG_SET_BREAKPNT = 0xB0;
 constexpr uint8_t DBG_REMOVE_BREAKPNT = 0xB1;
 constexpr uint8_t DBG_RUN_APP = 0xE0;
 constexpr uint8_t DBG_NEXT_INSTR = 0xE1;
 constexpr uint8_t DBG_CONTINUE_ = 0xE2;
 constexpr uint8_t DBG_STOP_EXE = 0xE3;
+constexpr uint8_t DBG_PAUSE = 0xE4;
 constexpr uint8_t DBG_GET_REGS = 0x10;
+constexpr uint8_t DBG_READ_MEM = 0x11;
+constexpr uint8_t DBG_TRACE = 0x12;
+constexpr uint8_t DBG_HEAP_PROFILE = 0x13;
+constexpr uint8_t DBG_MEM_USAGE = 0x14;
 constexpr uint8_t DBG_ERROR = 0xEE;
 constexpr uint8_t DBG_EXE_FIN = 0xFF;
 
@@ -44,6 +55,28 @@ constexpr uint8_t ERR_RUNTIME_ERROR = 0x3;
 constexpr uint8_t ERR_FILE_FORMAT_ERROR = 0x4;
 constexpr uint8_t ERR_BREAKPOINT_ALREADY_SET = 0x5;
 constexpr uint8_t ERR_BREAKPOINT_NOT_EXISTING = 0x6;
+constexpr uint8_t ERR_NO_UX_FILE = 0x7;
+constexpr uint8_t ERR_INVALID_MEM_RANGE = 0x8;
+constexpr uint8_t ERR_VM_RUNNING = 0x9;
+
+// Session options set with DBG_SET_OPTIONS
+constexpr uint8_t DBG_OPT_DELTA_REGS = 0b0000'0001;
+
+// Pause reasons sent as <DBG_PAUSE> <u8 reason> <u64 ip> before the registers
+constexpr uint8_t DBG_PAUSE_IDLE = 0x0;
+constexpr uint8_t DBG_PAUSE_STOPPED = 0x1;
+constexpr uint8_t DBG_PAUSE_BREAKPOINT = 0x2;
+
+/** Number of registers sent in a register dump, one per register file entry
+ * from ip (0x01) up to REG_FP_END */
+constexpr size_t DBG_REG_COUNT = 38;
+/** Size of a single tagged register record <id> <value> */
+constexpr size_t DBG_REG_RECORD_SIZE = 9;
+/** Size of a single tagged vector register record <id> <u128 value>, sent
+ * after the other registers */
+constexpr size_t DBG_VEC_REG_RECORD_SIZE = 17;
+/** Largest memory range which can be requested with DBG_READ_MEM */
+constexpr uint32_t DBG_MAX_MEM_READ = 0x10000;
 
 enum class DbgSessState {
     OPEN,
@@ -64,11 +97,47 @@ struct Debugger {
     std::vector<uint64_t> Breakpoints;
     /** Is UVM currently on a breakpoint */
     bool OnBreakpoint = false;
+    /** Only send registers which changed since the last register dump */
+    bool DeltaRegisters = false;
+    /** Register values of the last register dump sent to the client */
+    std::array<uint64_t, DBG_REG_COUNT> LastRegisters{};
+    /** Vector register values of the last register dump */
+    std::array<VecVal, VEC_REG_COUNT> LastVecRegisters{};
+    /** Does LastRegisters hold a dump the client knows about */
+    bool LastRegistersValid = false;
+    /** Thread executing the UVM instance during run and continue */
+    std::thread Worker;
+    /** Is the worker currently executing the UVM instance */
+    std::atomic<bool> WorkerRunning{false};
+    /** Set to stop the worker at the next branch */
+    std::atomic<bool> PauseRequested{false};
+    /** Current request is answered by the worker once execution stops */
+    bool ResponseDeferred = false;
+    /** Operation the deferred response answers */
+    uint8_t DeferredOp = 0;
+    /** Tracer of the open trace stream, null if no stream is open */
+    std::unique_ptr<Tracer> Trace;
+    /** Thread sending trace records to the stream client */
+    std::thread Streamer;
+    /** Current request is turned into a trace stream */
+    bool ResponseStreamed = false;
+    /** Heap profile report of the last program which ran until its exit */
+    std::string ExitHeapReport;
 
+    ~Debugger();
     void startSession();
     void closeSession();
     bool handleRequest(Response& res);
-    void appendRegisters(std::stringstream& stream);
-    void appendConsole(std::stringstream& stream);
+    void readRegisters(std::array<uint64_t, DBG_REG_COUNT>& regs);
+    void appendRegisters(Response& res);
+    void appendPause(Response& res, uint8_t reason);
+    void appendConsole(Response& res);
+    void appendMemory(Response& res, uint64_t vAddr, uint32_t size);
+    void startWorker();
+    void stopWorker();
+    void startStreamer();
+    void stopTrace();
+    uint32_t stepInstr();
+    void appendExecResult(Response& res, uint8_t op, uint32_t status);
     uint32_t continueToBreakpoint();
 };
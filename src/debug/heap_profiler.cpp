@@ -0,0 +1,182 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "heap_profiler.hpp"
+#include "../clock.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+HeapProfiler::HeapProfiler() : StartNanos(getMonotonicNanos()) {}
+
+/**
+ * Records an allocation. The site is the current instruction, which is the
+ * syscall causing the allocation, and the return addresses of the innermost
+ * call frames.
+ * @param mmu Memory manager performing the allocation
+ * @param vAddr Virtual address of the allocated block
+ * @param size Requested size
+ */
+void HeapProfiler::onAlloc(const MemManager& mmu,
+                           uint64_t vAddr,
+                           uint32_t size) {
+    HeapStack stack{};
+    stack[0] = mmu.Regs[REG_INSTR_PTR].I64;
+    size_t depth = std::min(mmu.ShadowDepth, HEAP_PROFILE_STACK_DEPTH - 1);
+    for (size_t i = 0; i < depth; i++) {
+        size_t frame = (mmu.ShadowTop - 1 - i) & (SHADOW_STACK_SIZE - 1);
+        stack[i + 1] = mmu.ShadowStack[frame].ReturnIP;
+    }
+
+    auto found = SiteIds.find(stack);
+    uint32_t siteId = 0;
+    if (found == SiteIds.end()) {
+        siteId = static_cast<uint32_t>(Sites.size());
+        SiteIds.emplace(stack, siteId);
+        Sites.emplace_back();
+        Sites.back().Stack = stack;
+    } else {
+        siteId = found->second;
+    }
+
+    HeapSite& site = Sites[siteId];
+    site.Allocs++;
+    site.AllocBytes += size;
+    site.LiveBlocks++;
+    site.LiveBytes += size;
+    site.PeakBytes = std::max(site.PeakBytes, site.LiveBytes);
+
+    Allocs++;
+    AllocBytes += size;
+    LiveBytes += size;
+    PeakBytes = std::max(PeakBytes, LiveBytes);
+
+    Live[vAddr] = HeapBlock{size, siteId, getMonotonicNanos()};
+}
+
+/**
+ * Records a deallocation. Blocks allocated before the profiler was attached
+ * are ignored.
+ * @param vAddr Virtual address of the deallocated block
+ */
+void HeapProfiler::onFree(uint64_t vAddr) {
+    auto found = Live.find(vAddr);
+    if (found == Live.end()) {
+        return;
+    }
+
+    const HeapBlock& block = found->second;
+    HeapSite& site = Sites[block.Site];
+    site.LiveBlocks--;
+    site.LiveBytes -= block.Size;
+    LiveBytes -= block.Size;
+    Frees++;
+    Live.erase(found);
+}
+
+/**
+ * Writes a call stack as a list of addresses, innermost first
+ * @param out Output stream
+ * @param stack Call stack
+ */
+static void writeStack(std::ostream& out, const HeapStack& stack) {
+    out << std::hex << "0x" << stack[0];
+    for (size_t i = 1; i < stack.size() && stack[i] != 0; i++) {
+        out << " <- 0x" << stack[i];
+    }
+    out << std::dec;
+}
+
+/**
+ * Creates a human readable report of the recorded allocations. Lists the
+ * sites holding the most live bytes and the oldest live blocks.
+ * @param atExit Program has finished, live blocks are reported as leaked
+ * @return Report text
+ */
+std::string HeapProfiler::report(bool atExit) const {
+    uint64_t nowNanos = getMonotonicNanos();
+    double seconds = static_cast<double>(nowNanos - StartNanos) / 1e9;
+    double allocRate = seconds > 0 ? static_cast<double>(Allocs) / seconds : 0;
+    double byteRate =
+        seconds > 0 ? static_cast<double>(AllocBytes) / seconds : 0;
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "Heap profile after " << seconds << " s\n"
+        << "  allocations:   " << Allocs << " (" << AllocBytes << " bytes), "
+        << allocRate << "/s (" << byteRate << " bytes/s)\n"
+        << "  deallocations: " << Frees << "\n"
+        << "  live:          " << LiveBytes << " bytes in " << Live.size()
+        << " blocks, peak " << PeakBytes << " bytes\n";
+
+    std::vector<uint32_t> siteOrder(Sites.size());
+    for (uint32_t i = 0; i < siteOrder.size(); i++) {
+        siteOrder[i] = i;
+    }
+    std::stable_sort(siteOrder.begin(), siteOrder.end(),
+                     [&](uint32_t a, uint32_t b) {
+                         return Sites[a].LiveBytes > Sites[b].LiveBytes;
+                     });
+
+    out << "\nSites by live bytes:\n"
+        << "    live bytes  live blocks   peak bytes       allocs"
+           "  alloc bytes  call stack\n";
+    size_t siteCount = std::min(siteOrder.size(), HEAP_PROFILE_MAX_SITES);
+    for (size_t i = 0; i < siteCount; i++) {
+        const HeapSite& site = Sites[siteOrder[i]];
+        out << "  " << std::setw(12) << site.LiveBytes << " " << std::setw(12)
+            << site.LiveBlocks << " " << std::setw(12) << site.PeakBytes
+            << " " << std::setw(12) << site.Allocs << " " << std::setw(12)
+            << site.AllocBytes << "  ";
+        writeStack(out, site.Stack);
+        out << "\n";
+    }
+    if (siteOrder.size() > siteCount) {
+        out << "  ... " << siteOrder.size() - siteCount << " more sites\n";
+    }
+
+    std::vector<std::pair<uint64_t, const HeapBlock*>> blocks;
+    blocks.reserve(Live.size());
+    for (const auto& entry : Live) {
+        blocks.emplace_back(entry.first, &entry.second);
+    }
+    std::sort(blocks.begin(), blocks.end(), [](const auto& a, const auto& b) {
+        if (a.second->AllocNanos != b.second->AllocNanos) {
+            return a.second->AllocNanos < b.second->AllocNanos;
+        }
+        return a.first < b.first;
+    });
+
+    out << (atExit ? "\nLeaked blocks, oldest first:\n"
+                   : "\nLive blocks, oldest first:\n")
+        << "             address         size      age (s)  call stack\n";
+    size_t blockCount = std::min(blocks.size(), HEAP_PROFILE_MAX_BLOCKS);
+    for (size_t i = 0; i < blockCount; i++) {
+        const HeapBlock& block = *blocks[i].second;
+        double age = static_cast<double>(nowNanos - block.AllocNanos) / 1e9;
+        out << "  0x" << std::hex << std::setfill('0') << std::setw(16)
+            << blocks[i].first << std::dec << std::setfill(' ') << " "
+            << std::setw(12) << block.Size << " " << std::setw(12) << age
+            << "  ";
+        writeStack(out, Sites[block.Site].Stack);
+        out << "\n";
+    }
+    if (blocks.size() > blockCount) {
+        out << "  ... " << blocks.size() - blockCount << " more blocks\n";
+    }
+
+    return out.str();
+}
@@ -0,0 +1,92 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#pragma once
+#include "../memory.hpp"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** Number of addresses recorded per allocation site, the allocating
+ * instruction followed by the innermost return addresses */
+constexpr size_t HEAP_PROFILE_STACK_DEPTH = 8;
+/** Number of sites listed in a report */
+constexpr size_t HEAP_PROFILE_MAX_SITES = 20;
+/** Number of live blocks listed in a report */
+constexpr size_t HEAP_PROFILE_MAX_BLOCKS = 32;
+
+/** Call stack of an allocation, unused entries are zero */
+using HeapStack = std::array<uint64_t, HEAP_PROFILE_STACK_DEPTH>;
+
+/** Allocations made from the same call stack */
+struct HeapSite {
+    /** Allocating instruction and return addresses, innermost first */
+    HeapStack Stack{};
+    /** Number of allocations */
+    uint64_t Allocs = 0;
+    /** Sum of all allocation sizes */
+    uint64_t AllocBytes = 0;
+    /** Number of blocks not deallocated yet */
+    uint64_t LiveBlocks = 0;
+    /** Size of all blocks not deallocated yet */
+    uint64_t LiveBytes = 0;
+    /** Largest value LiveBytes had */
+    uint64_t PeakBytes = 0;
+};
+
+/** Heap block which has not been deallocated yet */
+struct HeapBlock {
+    /** Requested size */
+    uint32_t Size = 0;
+    /** Index into HeapProfiler::Sites */
+    uint32_t Site = 0;
+    /** Monotonic time of the allocation in nanoseconds */
+    uint64_t AllocNanos = 0;
+};
+
+/**
+ * Records heap allocations of the guest program with the call stack they
+ * were made from. Attached to MemManager::Profiler, which calls it on every
+ * successful allocHeap() and deallocHeap().
+ */
+struct HeapProfiler {
+    /** Allocation sites in order of their first allocation */
+    std::vector<HeapSite> Sites;
+    /** Index of every site in Sites by its call stack */
+    std::map<HeapStack, uint32_t> SiteIds;
+    /** Blocks which have not been deallocated by their virtual address */
+    std::unordered_map<uint64_t, HeapBlock> Live;
+    /** Monotonic time the profiler was created at in nanoseconds */
+    uint64_t StartNanos = 0;
+    /** Total number of allocations */
+    uint64_t Allocs = 0;
+    /** Total number of deallocations */
+    uint64_t Frees = 0;
+    /** Sum of all allocation sizes */
+    uint64_t AllocBytes = 0;
+    /** Size of all blocks not deallocated yet */
+    uint64_t LiveBytes = 0;
+    /** Largest value LiveBytes had */
+    uint64_t PeakBytes = 0;
+
+    HeapProfiler();
+    void onAlloc(const MemManager& mmu, uint64_t vAddr, uint32_t size);
+    void onFree(uint64_t vAddr);
+    std::string report(bool atExit) const;
+};
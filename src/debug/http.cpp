@@ -16,16 +16,32 @@
 
 #include "http.hpp"
 #include <iostream>
-#include <sstream>
 #include <string>
 
 /**
- * Builds the response message and fills it into the buffer
+ * Appends raw bytes to the response body
+ * @param data Pointer to source data
+ * @param size Size of source data in bytes
+ */
+void Response::append(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    Body.insert(Body.end(), bytes, bytes + size);
+}
+
+/**
+ * Appends a single byte to the response body
+ * @param byte Byte to append
+ */
+void Response::append(uint8_t byte) {
+    Body.push_back(byte);
+}
+
+/**
+ * Builds the status line and header fields of the response. The body is kept
+ * in its own buffer so both can be sent without another copy.
  */
 void Response::fillBuffer() {
-    // Clear previous buffer
-    Stream.str(std::string());
-    Stream.clear();
+    Head.clear();
 
     char* responseCode = nullptr;
     switch (Code) {
@@ -37,11 +53,17 @@ void Response::fillBuffer() {
         break;
     }
 
-    Stream << HTTP_VERSION << ' ' << responseCode << "\r\n";
-    for (auto elem : Headers) {
-        Stream << elem.first << ": " << elem.second << "\r\n";
+    if (Chunked) {
+        Headers["Transfer-Encoding"] = "chunked";
+    } else {
+        Headers["Content-Length"] = std::to_string(Body.size());
+    }
+
+    Head.append(HTTP_VERSION).append(" ").append(responseCode).append("\r\n");
+    for (const auto& elem : Headers) {
+        Head.append(elem.first).append(": ").append(elem.second).append("\r\n");
     }
-    Stream << "\r\n" << Body.rdbuf();
+    Head.append("\r\n");
 }
 
 /**
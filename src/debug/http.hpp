@@ -16,9 +16,11 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstring>
 #include <map>
-#include <sstream>
+#include <string>
+#include <vector>
 
 constexpr char* PORT = "2001";
 constexpr size_t REC_BUFFER_SIZE = 1024;
@@ -55,10 +57,14 @@ struct Response {
     /** Header fields key value pair */
     std::map<std::string, std::string> Headers;
     /** Response body */
-    std::stringstream Body;
-    /** Response body stream */
-    std::stringstream Stream;
+    std::vector<uint8_t> Body;
+    /** Status line and header fields, built by fillBuffer() */
+    std::string Head;
+    /** Body is sent with chunked transfer encoding */
+    bool Chunked = false;
 
+    void append(const void* data, size_t size);
+    void append(uint8_t byte);
     void fillBuffer();
 };
 
@@ -109,16 +115,29 @@ struct HTTPServer {
     uint32_t UnixListenSock = -1;
     /** Unix socket handling requests */
     uint32_t UnixClientSock = -1;
+    /** Unix socket of a client waiting for a deferred response */
+    uint32_t UnixParkedSock = -1;
+    /** Unix socket of a client receiving a chunked stream */
+    uint32_t UnixStreamSock = -1;
     /** WinSocket listening for incoming requests */
     uint64_t* ListenSock = nullptr;
     /** WinSocket socket handling requests */
     uint64_t* ClientSock = nullptr;
+    /** WinSocket of a client waiting for a deferred response */
+    uint64_t* ParkedSock = nullptr;
+    /** WinSocket of a client receiving a chunked stream */
+    uint64_t* StreamSock = nullptr;
     /** Buffer containing incoming messages */
     uint8_t RecBuffer[REC_BUFFER_SIZE];
 
     bool startup();
     void listenLoop(RequestParser& rq);
-    void sendReq(std::ostream& stream);
+    void sendRes(const Response& res);
+    void parkClient();
+    void sendParked(const Response& res);
+    void beginStream(const Response& res);
+    bool sendChunk(const void* data, size_t size);
+    void endStream();
     void shutdownSock();
     void closeServer();
 };
@@ -0,0 +1,231 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "tracer.hpp"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+/** Largest block handed to a drain sink at once */
+constexpr size_t TRACE_DRAIN_BLOCK = 1 << 16;
+
+/**
+ * Constructor
+ */
+TraceRing::TraceRing() : Buffer(new uint8_t[TRACE_RING_SIZE]) {}
+
+/**
+ * Appends data to the ring. If the consumer is behind the producer waits
+ * until enough space is free so no record is lost.
+ * @param data Pointer to source buffer
+ * @param size Size of data in bytes, at most TRACE_RING_SIZE
+ */
+void TraceRing::push(const uint8_t* data, size_t size) {
+    uint64_t head = Head.load(std::memory_order_relaxed);
+    while (head + size - TailCache > TRACE_RING_SIZE) {
+        TailCache = Tail.load(std::memory_order_acquire);
+        if (head + size - TailCache > TRACE_RING_SIZE) {
+            std::this_thread::yield();
+        }
+    }
+
+    size_t offset = head & (TRACE_RING_SIZE - 1);
+    size_t firstPart = TRACE_RING_SIZE - offset;
+    if (size <= firstPart) {
+        std::memcpy(&Buffer[offset], data, size);
+    } else {
+        std::memcpy(&Buffer[offset], data, firstPart);
+        std::memcpy(&Buffer[0], data + firstPart, size - firstPart);
+    }
+
+    Head.store(head + size, std::memory_order_release);
+}
+
+/**
+ * Removes up to size bytes from the ring
+ * @param dest Pointer to destination buffer of at least given size
+ * @param size Size of destination buffer in bytes
+ * @return Number of bytes copied into dest
+ */
+size_t TraceRing::pop(uint8_t* dest, size_t size) {
+    uint64_t tail = Tail.load(std::memory_order_relaxed);
+    uint64_t available = Head.load(std::memory_order_acquire) - tail;
+    if (available < size) {
+        size = available;
+    }
+
+    size_t offset = tail & (TRACE_RING_SIZE - 1);
+    size_t firstPart = TRACE_RING_SIZE - offset;
+    if (size <= firstPart) {
+        std::memcpy(dest, &Buffer[offset], size);
+    } else {
+        std::memcpy(dest, &Buffer[offset], firstPart);
+        std::memcpy(dest + firstPart, &Buffer[0], size - firstPart);
+    }
+
+    Tail.store(tail + size, std::memory_order_release);
+    return size;
+}
+
+static_assert(TRACE_REG_COUNT == REG_FILE_SIZE - REG_STACK_PTR,
+              "trace registers have to match the register file");
+static_assert(TRACE_REG_COUNT + VEC_REG_COUNT <= TRACE_INFO_REG_MASK,
+              "changed registers have to fit into the record info");
+
+/**
+ * Packs the registers compared by the tracer in order of their register ids
+ * @param mmu Memory manager holding the registers
+ * @param regs Output register values
+ */
+static void readTraceRegs(const MemManager& mmu,
+                          std::array<uint64_t, TRACE_REG_COUNT>& regs) {
+    // The register file shares the layout, starting with the stack pointer
+    std::memcpy(regs.data(), &mmu.Regs[REG_STACK_PTR], sizeof(regs));
+    uint64_t zeroSigned = mmu.Flags.evalZeroSigned();
+    regs[REG_FLAGS - REG_STACK_PTR] =
+        static_cast<uint64_t>(mmu.Flags.Carry) << 63 |
+        (zeroSigned & 0b01) << 62 | (zeroSigned & 0b10) << 60;
+}
+
+/**
+ * Writes an unsigned LEB128 varint
+ * @param cursor Output cursor, advanced past the written bytes
+ * @param val Value to encode
+ */
+static inline void writeVarint(uint8_t*& cursor, uint64_t val) {
+    while (val >= 0x80) {
+        *cursor++ = static_cast<uint8_t>(val) | 0x80;
+        val >>= 7;
+    }
+    *cursor++ = static_cast<uint8_t>(val);
+}
+
+/**
+ * Captures the state before an instruction is executed
+ * @param mmu Memory manager of the traced UVM instance
+ */
+void Tracer::begin(MemManager& mmu) {
+    CurrentIP = mmu.Regs[REG_INSTR_PTR].I64;
+    mmu.WriteCount = 0;
+    readTraceRegs(mmu, Snapshot);
+    VecSnapshot = mmu.VecRegs;
+}
+
+/**
+ * Encodes the effect of the instruction executed since begin() and appends it
+ * to the current batch
+ * @param mmu Memory manager of the traced UVM instance
+ * @param opcode Opcode of the executed instruction
+ */
+void Tracer::commit(const MemManager& mmu, uint8_t opcode) {
+    std::array<uint64_t, TRACE_REG_COUNT> regs;
+    readTraceRegs(mmu, regs);
+
+    uint8_t* record = &Batch[BatchSize];
+    uint8_t* cursor = &record[2];
+
+    // Zigzag encoding keeps small backward jumps small
+    int64_t ipDelta = static_cast<int64_t>(CurrentIP - LastIP);
+    writeVarint(cursor, (static_cast<uint64_t>(ipDelta) << 1) ^
+                            static_cast<uint64_t>(ipDelta >> 63));
+    LastIP = CurrentIP;
+
+    uint8_t info = 0;
+    for (size_t i = 0; i < TRACE_REG_COUNT; i++) {
+        if (regs[i] != Snapshot[i]) {
+            // Register ids start at 0x2 (sp)
+            cursor[0] = static_cast<uint8_t>(i + REG_STACK_PTR);
+            std::memcpy(&cursor[1], &regs[i], 8);
+            cursor += 9;
+            info++;
+        }
+    }
+    for (size_t i = 0; i < VEC_REG_COUNT; i++) {
+        if (std::memcmp(&mmu.VecRegs[i], &VecSnapshot[i], 16) != 0) {
+            cursor[0] = static_cast<uint8_t>(i + REG_VEC_START);
+            std::memcpy(&cursor[1], &mmu.VecRegs[i], 16);
+            cursor += 17;
+            info++;
+        }
+    }
+
+    if (mmu.WriteCount != 0) {
+        info |= TRACE_INFO_MEM_WRITE;
+        size_t count = mmu.WriteCount;
+        if (count > WRITE_LOG_SIZE) {
+            info |= TRACE_INFO_WRITES_TRUNCATED;
+            count = WRITE_LOG_SIZE;
+        }
+        writeVarint(cursor, count);
+        for (size_t i = 0; i < count; i++) {
+            std::memcpy(cursor, &mmu.WriteLog[i].VAddr, 8);
+            cursor += 8;
+            writeVarint(cursor, mmu.WriteLog[i].Size);
+        }
+    }
+
+    record[0] = opcode;
+    record[1] = info;
+    BatchSize += cursor - record;
+
+    // Keep room for the largest possible record
+    if (BatchSize > TRACE_BATCH_SIZE - TRACE_MAX_RECORD_SIZE) {
+        flush();
+    }
+}
+
+/**
+ * Pushes the current batch into the ring so the consumer can see it
+ */
+void Tracer::flush() {
+    Ring.push(Batch.data(), BatchSize);
+    BatchSize = 0;
+}
+
+/**
+ * Flushes the last batch and marks the end of the trace, drain() returns once
+ * all records are consumed
+ */
+void Tracer::close() {
+    flush();
+    Ring.Closed.store(true, std::memory_order_release);
+}
+
+/**
+ * Hands encoded records to the sink until the tracer is closed and every
+ * record has been consumed. Meant to run on its own thread.
+ * @param sink Receives blocks of encoded records, returns false if it cannot
+ * take any more data. Remaining records are discarded so the producer never
+ * blocks on a dead consumer.
+ */
+void Tracer::drain(const std::function<bool(const uint8_t*, size_t)>& sink) {
+    std::unique_ptr<uint8_t[]> block(new uint8_t[TRACE_DRAIN_BLOCK]);
+    bool sinkOpen = true;
+    while (true) {
+        // Check before popping so records pushed before closing are not lost
+        bool closed = Ring.Closed.load(std::memory_order_acquire);
+        size_t size = Ring.pop(block.get(), TRACE_DRAIN_BLOCK);
+        if (size != 0) {
+            if (sinkOpen) {
+                sinkOpen = sink(block.get(), size);
+            }
+        } else if (closed) {
+            return;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
@@ -0,0 +1,101 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#pragma once
+#include "../memory.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+// Trace encoding
+//
+// Every executed instruction is encoded as a variable sized record:
+//   <u8 opcode> <u8 info> <varint ip delta> [<u8 reg id> <u64 value>]...
+//   [<u8 vector reg id> <u128 value>]...
+//   [<varint write count> [<u64 write address> <varint write size>]...]
+// The lower 6 bits of info hold the number of changed registers including the
+// vector registers and bit 6 is set if the instruction wrote to memory. Up to
+// WRITE_LOG_SIZE writes are listed in the order they happened, bit 7 is set if
+// the instruction wrote more ranges than listed. The instruction pointer is
+// stored as zigzag encoded difference to the instruction pointer of the
+// previous record, so sequential code only needs a single byte. Register ids
+// match the register ids of the instruction encoding, flags are packed like in
+// a debugger register dump.
+//
+// Trace files start with <u64 TRACE_FILE_MAGIC> <u8 TRACE_VERSION> followed by
+// the records.
+
+constexpr uint64_t TRACE_FILE_MAGIC = 0x45434152544D5655;
+constexpr uint8_t TRACE_VERSION = 0x4;
+constexpr uint8_t TRACE_INFO_REG_MASK = 0b0011'1111;
+constexpr uint8_t TRACE_INFO_MEM_WRITE = 0b0100'0000;
+constexpr uint8_t TRACE_INFO_WRITES_TRUNCATED = 0b1000'0000;
+/** Size of the ring buffer in bytes, has to be a power of two */
+constexpr size_t TRACE_RING_SIZE = 1 << 22;
+/** Number of registers compared after every instruction, one per register
+ * file entry from sp (0x02) up to REG_FP_END */
+constexpr size_t TRACE_REG_COUNT = 37;
+/** Records are collected in batches of this size before entering the ring */
+constexpr size_t TRACE_BATCH_SIZE = 1 << 12;
+/** Upper bound of a single encoded record */
+constexpr size_t TRACE_MAX_RECORD_SIZE =
+    2 + 10 + TRACE_REG_COUNT * 9 + VEC_REG_COUNT * 17 + 1 +
+    WRITE_LOG_SIZE * (8 + 5);
+
+/**
+ * Lock free single producer single consumer byte ring buffer
+ */
+struct TraceRing {
+    TraceRing();
+    /** Ring storage */
+    std::unique_ptr<uint8_t[]> Buffer;
+    /** Total number of bytes written by the producer */
+    alignas(64) std::atomic<uint64_t> Head{0};
+    /** Producer side copy of Tail to avoid reading the shared counter */
+    uint64_t TailCache = 0;
+    /** Total number of bytes read by the consumer */
+    alignas(64) std::atomic<uint64_t> Tail{0};
+    /** Set by the producer once no more data is pushed */
+    std::atomic<bool> Closed{false};
+
+    void push(const uint8_t* data, size_t size);
+    size_t pop(uint8_t* dest, size_t size);
+};
+
+struct Tracer {
+    /** Encoded records waiting for the consumer */
+    TraceRing Ring;
+    /** Register values before the current instruction */
+    std::array<uint64_t, TRACE_REG_COUNT> Snapshot;
+    /** Vector register values before the current instruction */
+    std::array<VecVal, VEC_REG_COUNT> VecSnapshot;
+    /** Instruction pointer of the current instruction */
+    uint64_t CurrentIP = 0;
+    /** Instruction pointer of the previous record */
+    uint64_t LastIP = 0;
+    /** Records not yet pushed into the ring */
+    std::array<uint8_t, TRACE_BATCH_SIZE> Batch;
+    /** Used size of Batch in bytes */
+    size_t BatchSize = 0;
+
+    void begin(MemManager& mmu);
+    void commit(const MemManager& mmu, uint8_t opcode);
+    void flush();
+    void close();
+    void drain(const std::function<bool(const uint8_t*, size_t)>& sink);
+};
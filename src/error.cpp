@@ -80,6 +80,9 @@ const char* translateError(uint32_t errCode) {
     case E_INVALID_BASE_PTR:
         strPtr = "invalid base pointer address";
         break;
+    case E_MEM_QUOTA_EXCEEDED:
+        strPtr = "memory quota exceeded";
+        break;
     default:
         strPtr = "Unknown error code\n";
         break;
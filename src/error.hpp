@@ -46,6 +46,7 @@ constexpr uint32_t E_SYSCALL_FAILURE =          0xE00D;
 constexpr uint32_t E_DIVISON_ZERO =             0xE00E;
 constexpr uint32_t E_INVALID_STACK_OP =         0xE00F;
 constexpr uint32_t E_INVALID_BASE_PTR =         0xE010;
+constexpr uint32_t E_MEM_QUOTA_EXCEEDED =       0xE011;
 // clang-format on
 
 const char* translateError(uint32_t errCode);
@@ -0,0 +1,147 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "file_io.hpp"
+#include <algorithm>
+#include <cstring>
+
+/** Closes all files which are still open */
+FileTable::~FileTable() {
+    for (HostFile file : Files) {
+        if (file != INVALID_HOST_FILE) {
+            closeHostFile(file);
+        }
+    }
+}
+
+/**
+ * Adds an opened host file, reusing the lowest closed slot
+ * @param file Host file
+ * @return Guest file handle
+ */
+int64_t FileTable::add(HostFile file) {
+    for (size_t i = 0; i < Files.size(); i++) {
+        if (Files[i] == INVALID_HOST_FILE) {
+            Files[i] = file;
+            return static_cast<int64_t>(i);
+        }
+    }
+    Files.push_back(file);
+    return static_cast<int64_t>(Files.size() - 1);
+}
+
+/**
+ * Looks up the host file of a guest file handle
+ * @param handle Guest file handle
+ * @return On success returns the host file otherwise INVALID_HOST_FILE
+ */
+HostFile FileTable::get(uint64_t handle) const {
+    if (handle >= Files.size()) {
+        return INVALID_HOST_FILE;
+    }
+    return Files[handle];
+}
+
+/**
+ * Closes the host file of a guest file handle
+ * @param handle Guest file handle
+ * @return On success returns true otherwise false
+ */
+bool FileTable::close(uint64_t handle) {
+    HostFile file = get(handle);
+    if (file == INVALID_HOST_FILE) {
+        return false;
+    }
+    Files[handle] = INVALID_HOST_FILE;
+    return closeHostFile(file);
+}
+
+/**
+ * Reads from the standard input
+ * @param dest Destination buffer of at least size bytes
+ * @param size Maximum number of bytes to read
+ * @param fill Read until size is reached or the input ends, otherwise stop
+ * after the first bytes became available
+ * @return On success returns the number of bytes read, 0 at the end of the
+ * input, otherwise -1
+ */
+int64_t StdinReader::read(uint8_t* dest, size_t size, bool fill) {
+    size_t total = std::min(size, Pending.size() - PendingPos);
+    if (total != 0) {
+        std::memcpy(dest, Pending.data() + PendingPos, total);
+        PendingPos += total;
+    }
+    if (PendingPos == Pending.size()) {
+        Pending.clear();
+        PendingPos = 0;
+    }
+
+    HostFile stdinFile = getStdinFile();
+    while (total < size && (fill || total == 0)) {
+        int64_t res = readHostFileOnce(stdinFile, dest + total, size - total);
+        if (res < 0) {
+            return total > 0 ? static_cast<int64_t>(total) : -1;
+        }
+        if (res == 0) {
+            break;
+        }
+        total += static_cast<size_t>(res);
+    }
+    return static_cast<int64_t>(total);
+}
+
+/**
+ * Gives bytes back, they are returned by the next read
+ * @param src Bytes which were read last
+ * @param size Number of bytes
+ */
+void StdinReader::unread(const uint8_t* src, size_t size) {
+    Pending.erase(Pending.begin(), Pending.begin() + PendingPos);
+    Pending.insert(Pending.begin(), src, src + size);
+    PendingPos = 0;
+}
+
+/**
+ * Reads a line without its line feed like std::getline
+ * @param line Output line
+ * @return False if the input ended before any byte was read
+ */
+bool StdinReader::readLine(std::string& line) {
+    line.clear();
+    while (true) {
+        const uint8_t* start = Pending.data() + PendingPos;
+        size_t available = Pending.size() - PendingPos;
+        const void* lineFeed =
+            available != 0 ? std::memchr(start, '\n', available) : nullptr;
+        if (lineFeed != nullptr) {
+            size_t length = static_cast<const uint8_t*>(lineFeed) - start;
+            line.append(reinterpret_cast<const char*>(start), length);
+            PendingPos += length + 1;
+            return true;
+        }
+        line.append(reinterpret_cast<const char*>(start), available);
+
+        Pending.resize(STDIN_BUFFER_SIZE);
+        PendingPos = 0;
+        int64_t res =
+            readHostFileOnce(getStdinFile(), Pending.data(), Pending.size());
+        if (res <= 0) {
+            Pending.clear();
+            return !line.empty();
+        }
+        Pending.resize(static_cast<size_t>(res));
+    }
+}
@@ -0,0 +1,106 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/** Host file descriptor or handle */
+using HostFile = intptr_t;
+constexpr HostFile INVALID_HOST_FILE = -1;
+
+/** Open mode flags of SYSCALL_FILE_OPEN */
+constexpr uint32_t FILE_MODE_READ = 0x1;
+constexpr uint32_t FILE_MODE_WRITE = 0x2;
+constexpr uint32_t FILE_MODE_CREATE = 0x4;
+constexpr uint32_t FILE_MODE_TRUNCATE = 0x8;
+constexpr uint32_t FILE_MODE_APPEND = 0x10;
+
+/** Origins of SYSCALL_FILE_SEEK */
+constexpr uint32_t FILE_SEEK_SET = 0x0;
+constexpr uint32_t FILE_SEEK_CUR = 0x1;
+constexpr uint32_t FILE_SEEK_END = 0x2;
+
+/** Size of the host buffer used to read lines from the standard input */
+constexpr size_t STDIN_BUFFER_SIZE = 64 * 1024;
+
+/** Read only view of a host file */
+struct FileMapping {
+    /** Start of the mapping, aligned to the mapping granularity */
+    void* Base = nullptr;
+    /** Size of the mapping starting at Base */
+    size_t BaseSize = 0;
+    /** First byte of the requested range */
+    uint8_t* Data = nullptr;
+    /** Size of the requested range */
+    uint64_t Size = 0;
+};
+
+/** Files opened by the guest, indexed by guest file handle */
+class FileTable {
+  public:
+    FileTable() = default;
+    FileTable(const FileTable&) = delete;
+    FileTable& operator=(const FileTable&) = delete;
+    ~FileTable();
+
+    int64_t add(HostFile file);
+    HostFile get(uint64_t handle) const;
+    bool close(uint64_t handle);
+
+  private:
+    /** Host files, closed slots hold INVALID_HOST_FILE */
+    std::vector<HostFile> Files;
+};
+
+/**
+ * Reads the standard input for the console syscalls. Bytes which were read
+ * ahead or given back with unread() are returned first, bulk reads go
+ * straight into the destination.
+ */
+class StdinReader {
+  public:
+    int64_t read(uint8_t* dest, size_t size, bool fill);
+    void unread(const uint8_t* src, size_t size);
+    bool readLine(std::string& line);
+
+  private:
+    /** Bytes read ahead */
+    std::vector<uint8_t> Pending;
+    /** Position of the next byte in Pending */
+    size_t PendingPos = 0;
+};
+
+// Platform specific, implemented in platform/*_file.cpp
+HostFile getStdinFile();
+int64_t readHostFileOnce(HostFile file, void* dest, size_t size);
+HostFile openHostFile(const std::filesystem::path& path, uint32_t mode);
+int64_t readHostFile(HostFile file, void* dest, size_t size);
+int64_t writeHostFile(HostFile file, const void* src, size_t size);
+int64_t
+readHostFileAt(HostFile file, void* dest, size_t size, uint64_t offset);
+int64_t
+writeHostFileAt(HostFile file, const void* src, size_t size, uint64_t offset);
+int64_t seekHostFile(HostFile file, int64_t offset, uint32_t origin);
+bool closeHostFile(HostFile file);
+bool mapHostFile(HostFile file,
+                 uint64_t offset,
+                 uint64_t size,
+                 FileMapping& mapping);
+void unmapHostFile(const FileMapping& mapping);
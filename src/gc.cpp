@@ -0,0 +1,182 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "gc.hpp"
+#include "error.hpp"
+#include <algorithm>
+#include <cstring>
+
+/** Blocks of a single collection, sorted by their virtual address */
+struct MarkState {
+    /** Virtual start addresses */
+    std::vector<uint64_t> Starts;
+    /** Block sizes */
+    std::vector<uint32_t> Sizes;
+    /** Is the block reachable */
+    std::vector<uint8_t> Marked;
+    /** Marked blocks which have not been scanned yet */
+    std::vector<size_t> Pending;
+    /** Lowest address pointing into a block */
+    uint64_t Low = 0;
+    /** Highest address pointing into a block */
+    uint64_t High = 0;
+};
+
+/**
+ * Marks the block a word points into
+ * @param state Collection state
+ * @param word Possible pointer
+ */
+static void markWord(MarkState& state, uint64_t word) {
+    if (word < state.Low || word > state.High) {
+        return;
+    }
+
+    const std::vector<uint64_t>& starts = state.Starts;
+    auto next = std::upper_bound(starts.begin(), starts.end(), word);
+    size_t index = next - starts.begin() - 1;
+    if (word - state.Starts[index] > state.Sizes[index] ||
+        state.Marked[index] != 0) {
+        return;
+    }
+    state.Marked[index] = 1;
+    state.Pending.push_back(index);
+}
+
+/**
+ * Marks the blocks of every 8 byte word in a buffer. Words are read at every
+ * byte offset because the guest stores values without alignment.
+ * @param state Collection state
+ * @param data Buffer
+ * @param size Buffer size
+ */
+static void scanBytes(MarkState& state, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i + sizeof(uint64_t) <= size; i++) {
+        uint64_t word = 0;
+        std::memcpy(&word, &data[i], sizeof(word));
+        markWord(state, word);
+    }
+}
+
+/**
+ * Records an allocated block. Empty blocks cannot be deallocated and are not
+ * collected.
+ * @param vAddr Virtual address of the block
+ * @param size Block size
+ */
+void HeapCollector::onAlloc(uint64_t vAddr, uint32_t size) {
+    AllocatedBytes += size;
+    if (size != 0) {
+        Blocks[vAddr] = size;
+        LiveBytes += size;
+    }
+}
+
+/**
+ * Removes a deallocated block
+ * @param vAddr Virtual address of the block
+ */
+void HeapCollector::onFree(uint64_t vAddr) {
+    auto found = Blocks.find(vAddr);
+    if (found != Blocks.end()) {
+        LiveBytes -= found->second;
+        Blocks.erase(found);
+    }
+}
+
+/**
+ * Marks all blocks reachable from the roots and deallocates the others. The
+ * next collection is due once as much as is still live has been allocated
+ * again.
+ * @param mmu Memory manager owning the heap
+ * @param roots Additional addresses which have to stay allocated
+ * @return Number of bytes deallocated
+ */
+uint64_t HeapCollector::collect(MemManager& mmu,
+                                const std::vector<uint64_t>& roots) {
+    Collections++;
+    AllocatedBytes = 0;
+
+    MarkState state;
+    state.Starts.reserve(Blocks.size());
+    state.Sizes.reserve(Blocks.size());
+    for (const auto& block : Blocks) {
+        state.Starts.push_back(block.first);
+        state.Sizes.push_back(block.second);
+    }
+    state.Marked.assign(Blocks.size(), 0);
+    if (Blocks.empty()) {
+        Threshold = GC_MIN_THRESHOLD;
+        return 0;
+    }
+    state.Low = state.Starts.front();
+    state.High = state.Starts.back() + state.Sizes.back();
+
+    for (uint8_t id = REG_GP_START; id <= REG_GP_END; id++) {
+        markWord(state, mmu.Regs[id].I64);
+    }
+    for (const VecVal& reg : mmu.VecRegs) {
+        markWord(state, reg.I64[0]);
+        markWord(state, reg.I64[1]);
+    }
+    for (uint64_t root : roots) {
+        markWord(state, root);
+    }
+
+    // The whole stack is scanned, values above the stack pointer may still be
+    // used as locals
+    for (const MemBuffer& buff : mmu.Buffers) {
+        if (buff.Type == MemType::STACK || buff.Type == MemType::GLOBAL ||
+            buff.Type == MemType::STATIC) {
+            scanBytes(state, buff.Buffer, buff.Size);
+        }
+    }
+
+    // Blocks larger than a heap buffer span several host buffers, words
+    // crossing them are only seen in a copy
+    std::vector<MemSpan> spans;
+    std::vector<uint8_t> copy;
+    while (!state.Pending.empty()) {
+        size_t index = state.Pending.back();
+        state.Pending.pop_back();
+        uint32_t resolveRes =
+            mmu.resolveRange(state.Starts[index], state.Sizes[index], 0, spans);
+        if (resolveRes != UVM_SUCCESS) {
+            continue;
+        }
+
+        if (spans.size() == 1) {
+            scanBytes(state, spans[0].Ptr, spans[0].Size);
+        } else {
+            copy.clear();
+            for (const MemSpan& span : spans) {
+                copy.insert(copy.end(), span.Ptr, span.Ptr + span.Size);
+            }
+            scanBytes(state, copy.data(), copy.size());
+        }
+    }
+
+    uint64_t freed = 0;
+    for (size_t i = 0; i < state.Starts.size(); i++) {
+        if (state.Marked[i] == 0 &&
+            mmu.deallocHeap(state.Starts[i]) == UVM_SUCCESS) {
+            freed += state.Sizes[i];
+        }
+    }
+
+    Threshold = std::max(GC_MIN_THRESHOLD, LiveBytes);
+    return freed;
+}
@@ -0,0 +1,65 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#pragma once
+#include "memory.hpp"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/** Smallest number of bytes allocated between two collections */
+constexpr uint64_t GC_MIN_THRESHOLD = 64 * 1024;
+
+/**
+ * Conservative mark and sweep collector of the guest heap. Every aligned or
+ * unaligned 8 byte word in the roots and in reachable blocks which points into
+ * a block, or one past its end, keeps the block alive. Roots are the general
+ * purpose and vector registers, the stack buffer, GLOBAL and STATIC sections
+ * and the addresses passed to collect(). Attached to MemManager::Collector,
+ * which reports every allocation and deallocation to it.
+ */
+struct HeapCollector {
+    /** Size of every allocated block by its virtual address */
+    std::map<uint64_t, uint32_t> Blocks;
+    /** Sum of the sizes in Blocks */
+    uint64_t LiveBytes = 0;
+    /** Bytes allocated since the last collection */
+    uint64_t AllocatedBytes = 0;
+    /** A collection is due once AllocatedBytes reaches this */
+    uint64_t Threshold = GC_MIN_THRESHOLD;
+    /** Number of collections */
+    uint64_t Collections = 0;
+
+    void onAlloc(uint64_t vAddr, uint32_t size);
+    void onFree(uint64_t vAddr);
+
+    /**
+     * Checks if a virtual address is the start of an allocated block
+     * @param vAddr Virtual address
+     * @return True if the block has not been freed
+     */
+    inline bool contains(uint64_t vAddr) const {
+        return Blocks.find(vAddr) != Blocks.end();
+    }
+
+    /**
+     * Checks if enough has been allocated since the last collection
+     * @return True if a collection is due
+     */
+    inline bool isDue() const { return AllocatedBytes >= Threshold; }
+
+    uint64_t collect(MemManager& mmu, const std::vector<uint64_t>& roots);
+};
@@ -16,39 +16,115 @@
 
 #include "../error.hpp"
 #include "instructions.hpp"
+#include <array>
 #include <cmath>
+#include <cstring>
+#include <utility>
 
 /**
- * Performs operations for instructions add, sub, mul, muls, div and divs with
- * arguments <ireg> <ireg>
+ * Maps an IntType to its unsigned and signed C++ type and the matching field of
+ * IntVal
+ */
+template <IntType Type> struct IntTypeTraits;
+template <> struct IntTypeTraits<IntType::I8> {
+    using U = uint8_t;
+    using S = int8_t;
+    static constexpr U IntVal::*Field = &IntVal::I8;
+    static constexpr U RegVal::*RegField = &RegVal::I8;
+};
+template <> struct IntTypeTraits<IntType::I16> {
+    using U = uint16_t;
+    using S = int16_t;
+    static constexpr U IntVal::*Field = &IntVal::I16;
+    static constexpr U RegVal::*RegField = &RegVal::I16;
+};
+template <> struct IntTypeTraits<IntType::I32> {
+    using U = uint32_t;
+    using S = int32_t;
+    static constexpr U IntVal::*Field = &IntVal::I32;
+    static constexpr U RegVal::*RegField = &RegVal::I32;
+};
+template <> struct IntTypeTraits<IntType::I64> {
+    using U = uint64_t;
+    using S = int64_t;
+    static constexpr U IntVal::*Field = &IntVal::I64;
+    static constexpr U RegVal::*RegField = &RegVal::I64;
+};
+
+/**
+ * Applies an arithmetic operation on two integers of the same width
+ * @param lhs Left operand
+ * @param rhs Right operand
+ * @param result Output result of the operation
+ * @return On success returns UVM_SUCCESS otherwise E_DIVISON_ZERO
+ */
+template <ArithmOp Op, IntType Type>
+static inline uint32_t applyArithm(typename IntTypeTraits<Type>::U lhs,
+                                   typename IntTypeTraits<Type>::U rhs,
+                                   typename IntTypeTraits<Type>::U& result) {
+    using U = typename IntTypeTraits<Type>::U;
+    using S = typename IntTypeTraits<Type>::S;
+
+    if constexpr (Op == ArithmOp::ADD) {
+        result = static_cast<U>(lhs + rhs);
+    } else if constexpr (Op == ArithmOp::SUB) {
+        result = static_cast<U>(lhs - rhs);
+    } else if constexpr (Op == ArithmOp::MUL) {
+        result = static_cast<U>(lhs * rhs);
+    } else if constexpr (Op == ArithmOp::MULS) {
+        result = static_cast<U>(static_cast<S>(lhs) * static_cast<S>(rhs));
+    } else if constexpr (Op == ArithmOp::DIV) {
+        if (rhs == 0) {
+            return E_DIVISON_ZERO;
+        }
+        result = static_cast<U>(lhs / rhs);
+    } else if constexpr (Op == ArithmOp::DIVS) {
+        if (rhs == 0) {
+            return E_DIVISON_ZERO;
+        }
+        result = static_cast<U>(static_cast<S>(lhs) / static_cast<S>(rhs));
+    }
+
+    return UVM_SUCCESS;
+}
+
+/**
+ * Writes the lower bytes of an integer register. General purpose registers are
+ * written directly, every other register goes through setIntReg.
+ * @param mmu Memory manager holding the registers
+ * @param regId Id of an already validated integer register
+ * @param val Value to write
+ */
+template <IntType Type>
+static inline void storeIntReg(MemManager& mmu,
+                               uint8_t regId,
+                               typename IntTypeTraits<Type>::U val) {
+    if (regId >= REG_GP_START && regId <= REG_GP_END) {
+        mmu.Regs[regId].*IntTypeTraits<Type>::RegField = val;
+    } else {
+        IntVal regVal;
+        regVal.*IntTypeTraits<Type>::Field = val;
+        mmu.setIntReg(regId, regVal, Type);
+    }
+}
+
+/**
+ * Performs operation Op of width Type with arguments <ireg> <ireg>
  * @param vm UVM instance
  * @param width Instruction width
- * @param flag Type of INSTR_FLAG_OP_* flag
- * @return On success returns UVM_SUCCESS otherwise error state [E_INVALID_TYPE,
- * E_INVALID_SRC_REG, E_INVALID_DEST_REG, E_DIVISON_ZERO]
+ * @param flag Unused
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_INVALID_SRC_REG, E_INVALID_DEST_REG, E_DIVISON_ZERO]
  */
-uint32_t instr_arithm_common_ireg_ireg(UVM* vm, uint32_t width, uint32_t flag) {
-    // Versions:
-    // add <iT> <iR1> <iR2>
-    // sub <iT> <iR1> <iR2>
-    // mul <iT> <iR1> <iR2>
-    // muls <iT> <iR1> <iR2>
-    // div <iT> <iR1> <iR2>
-    // divs <iT> <iR1> <iR2>
-
-    constexpr uint32_t TYPE_OFFSET = 1;
+template <ArithmOp Op, IntType Type>
+static uint32_t instr_arithm_ireg_ireg(UVM* vm, uint32_t width, uint32_t flag) {
     constexpr uint32_t SRC_REG_OFFSET = 2;
     constexpr uint32_t DEST_REG_OFFSET = 3;
+    constexpr auto FIELD = IntTypeTraits<Type>::Field;
 
-    uint8_t type = vm->MMU.InstrBuffer[TYPE_OFFSET];
     uint8_t srcRegId = vm->MMU.InstrBuffer[SRC_REG_OFFSET];
     uint8_t destRegId = vm->MMU.InstrBuffer[DEST_REG_OFFSET];
 
-    IntType intType = IntType::I32;
-    if (!parseIntType(type, &intType)) {
-        return E_INVALID_TYPE;
-    }
-
     IntVal srcRegVal;
     IntVal destRegVal;
 
@@ -59,130 +135,207 @@ uint32_t instr_arithm_common_ireg_ireg(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_DEST_REG;
     }
 
-    IntVal result;
-    if ((flag & INSTR_FLAG_OP_ADD) != 0) {
-        switch (intType) {
-        case IntType::I8:
-            result.I8 = srcRegVal.I8 + destRegVal.I8;
-            break;
-        case IntType::I16:
-            result.I16 = srcRegVal.I16 + destRegVal.I16;
-            break;
-        case IntType::I32:
-            result.I32 = srcRegVal.I32 + destRegVal.I32;
-            break;
-        case IntType::I64:
-            result.I64 = srcRegVal.I64 + destRegVal.I64;
-            break;
-        }
-    } else if ((flag & INSTR_FLAG_OP_SUB) != 0) {
-        switch (intType) {
-        case IntType::I8:
-            result.I8 = srcRegVal.I8 - destRegVal.I8;
-            break;
-        case IntType::I16:
-            result.I16 = srcRegVal.I16 - destRegVal.I16;
-            break;
-        case IntType::I32:
-            result.I32 = srcRegVal.I32 - destRegVal.I32;
-            break;
-        case IntType::I64:
-            result.I64 = srcRegVal.I64 - destRegVal.I64;
-            break;
-        }
-    } else if ((flag & INSTR_FLAG_OP_MUL) != 0) {
-        switch (intType) {
-        case IntType::I8:
-            result.I8 = srcRegVal.I8 * destRegVal.I8;
-            break;
-        case IntType::I16:
-            result.I16 = srcRegVal.I16 * destRegVal.I16;
-            break;
-        case IntType::I32:
-            result.I32 = srcRegVal.I32 * destRegVal.I32;
-            break;
-        case IntType::I64:
-            result.I64 = srcRegVal.I64 * destRegVal.I64;
-            break;
-        }
-    } else if ((flag & INSTR_FLAG_OP_MULS) != 0) {
-        switch (intType) {
-        case IntType::I8:
-            result.S8 = srcRegVal.S8 * destRegVal.S8;
-            break;
-        case IntType::I16:
-            result.S16 = srcRegVal.S16 * destRegVal.S16;
-            break;
-        case IntType::I32:
-            result.S32 = srcRegVal.S32 * destRegVal.S32;
-            break;
-        case IntType::I64:
-            result.S64 = srcRegVal.S64 * destRegVal.S64;
-            break;
-        }
-    } else if ((flag & INSTR_FLAG_OP_DIV) != 0) {
-        switch (intType) {
-        case IntType::I8:
-            if (destRegVal.I8 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.I8 = srcRegVal.I8 / destRegVal.I8;
-            break;
-        case IntType::I16:
-            if (destRegVal.I16 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.I16 = srcRegVal.I16 / destRegVal.I16;
-            break;
-        case IntType::I32:
-            if (destRegVal.I32 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.I32 = srcRegVal.I32 / destRegVal.I32;
-            break;
-        case IntType::I64:
-            if (destRegVal.I64 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.I64 = srcRegVal.I64 / destRegVal.I64;
-            break;
-        }
-    } else if ((flag & INSTR_FLAG_OP_DIVS) != 0) {
-        switch (intType) {
-        case IntType::I8:
-            if (destRegVal.S8 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.S8 = srcRegVal.S8 / destRegVal.S8;
-            break;
-        case IntType::I16:
-            if (destRegVal.S16 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.S16 = srcRegVal.S16 / destRegVal.S16;
-            break;
-        case IntType::I32:
-            if (destRegVal.S32 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.S32 = srcRegVal.S32 / destRegVal.S32;
-            break;
-        case IntType::I64:
-            if (destRegVal.S64 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.S64 = srcRegVal.S64 / destRegVal.S64;
-            break;
-        }
+    typename IntTypeTraits<Type>::U result;
+    uint32_t status =
+        applyArithm<Op, Type>(srcRegVal.*FIELD, destRegVal.*FIELD, result);
+    if (status != UVM_SUCCESS) {
+        return status;
     }
 
-    // No need to evaluate reg id because this was already done by the earlier
-    // get
-    vm->MMU.setIntReg(destRegId, result, intType);
+    storeIntReg<Type>(vm->MMU, destRegId, result);
 
     return UVM_SUCCESS;
 }
 
+/**
+ * Performs operation Op of width Type with arguments <ireg> <int>
+ * @param vm UVM instance
+ * @param width Instruction width
+ * @param flag Unused
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_INVALID_SRC_REG, E_DIVISON_ZERO]
+ */
+template <ArithmOp Op, IntType Type>
+uint32_t instr_arithm_ireg_int(UVM* vm, uint32_t width, uint32_t flag) {
+    constexpr uint32_t REG_OFFSET = 1;
+    constexpr uint32_t INT_OFFSET = 2;
+    using U = typename IntTypeTraits<Type>::U;
+
+    uint8_t regId = vm->MMU.InstrBuffer[REG_OFFSET];
+
+    IntVal regVal;
+    if (vm->MMU.getIntReg(regId, regVal) != 0) {
+        return E_INVALID_SRC_REG;
+    }
+
+    U operand;
+    std::memcpy(&operand, &vm->MMU.InstrBuffer[INT_OFFSET], sizeof(U));
+
+    U result;
+    uint32_t status = applyArithm<Op, Type>(
+        regVal.*IntTypeTraits<Type>::Field, operand, result);
+    if (status != UVM_SUCCESS) {
+        return status;
+    }
+
+    storeIntReg<Type>(vm->MMU, regId, result);
+
+    return UVM_SUCCESS;
+}
+
+/**
+ * Fused load <int> <iR1> followed by operation Op of width Type with arguments
+ * <iR1> <iR2>. The buffer holds the bytes of the arithmetic instruction
+ * followed by the loaded immediate as i64. Both registers have been validated
+ * as general purpose registers and the type byte as Type.
+ * @param vm UVM instance
+ * @param width Unused
+ * @param flag Number of bytes written by the load
+ * @return On success returns UVM_SUCCESS otherwise E_DIVISON_ZERO
+ */
+template <ArithmOp Op, IntType Type>
+uint32_t instr_load_arithm_ireg_ireg(UVM* vm, uint32_t width, uint32_t flag) {
+    constexpr uint32_t SRC_REG_OFFSET = 2;
+    constexpr uint32_t DEST_REG_OFFSET = 3;
+    constexpr uint32_t INT_OFFSET = 4;
+    constexpr auto FIELD = IntTypeTraits<Type>::RegField;
+
+    uint8_t srcRegId = vm->MMU.InstrBuffer[SRC_REG_OFFSET];
+    uint8_t destRegId = vm->MMU.InstrBuffer[DEST_REG_OFFSET];
+
+    uint64_t imm;
+    std::memcpy(&imm, &vm->MMU.InstrBuffer[INT_OFFSET], sizeof(imm));
+    std::memcpy(&vm->MMU.Regs[srcRegId].I64, &imm, flag);
+
+    typename IntTypeTraits<Type>::U result;
+    uint32_t status = applyArithm<Op, Type>(
+        static_cast<typename IntTypeTraits<Type>::U>(imm),
+        vm->MMU.Regs[destRegId].*FIELD, result);
+    if (status != UVM_SUCCESS) {
+        return status;
+    }
+
+    vm->MMU.Regs[destRegId].*FIELD = result;
+
+    return UVM_SUCCESS;
+}
+
+/**
+ * Replaces mul <iR> <int> and muls <iR> <int> with a power of two multiplier
+ * by a left shift of width Type. The buffer holds the original instruction,
+ * its register has been validated as general purpose register.
+ * @param vm UVM instance
+ * @param width Unused
+ * @param flag Shift amount, log2 of the multiplier
+ * @return Always returns UVM_SUCCESS
+ */
+template <IntType Type>
+uint32_t instr_lsh_ireg_int(UVM* vm, uint32_t width, uint32_t flag) {
+    constexpr uint32_t REG_OFFSET = 1;
+    constexpr auto FIELD = IntTypeTraits<Type>::RegField;
+    using U = typename IntTypeTraits<Type>::U;
+
+    RegVal& reg = vm->MMU.Regs[vm->MMU.InstrBuffer[REG_OFFSET]];
+    reg.*FIELD = static_cast<U>(reg.*FIELD << flag);
+
+    return UVM_SUCCESS;
+}
+
+template MAKE_INSTR(lsh_ireg_int<IntType::I8>);
+template MAKE_INSTR(lsh_ireg_int<IntType::I16>);
+template MAKE_INSTR(lsh_ireg_int<IntType::I32>);
+template MAKE_INSTR(lsh_ireg_int<IntType::I64>);
+
+// The decoder and the peephole optimizer take the addresses of these handlers
+// in other translation units
+#define INSTANTIATE_ARITHM(op, type)                                           \
+    template uint32_t instr_arithm_ireg_int<ArithmOp::op, IntType::type>(      \
+        UVM * vm, uint32_t width, uint32_t flag);                              \
+    template uint32_t                                                          \
+    instr_load_arithm_ireg_ireg<ArithmOp::op, IntType::type>(                  \
+        UVM * vm, uint32_t width, uint32_t flag)
+
+#define INSTANTIATE_ARITHM_OP(op)                                              \
+    INSTANTIATE_ARITHM(op, I8);                                                \
+    INSTANTIATE_ARITHM(op, I16);                                               \
+    INSTANTIATE_ARITHM(op, I32);                                               \
+    INSTANTIATE_ARITHM(op, I64)
+
+INSTANTIATE_ARITHM_OP(ADD);
+INSTANTIATE_ARITHM_OP(SUB);
+INSTANTIATE_ARITHM_OP(MUL);
+INSTANTIATE_ARITHM_OP(MULS);
+INSTANTIATE_ARITHM_OP(DIV);
+INSTANTIATE_ARITHM_OP(DIVS);
+
+#undef INSTANTIATE_ARITHM_OP
+#undef INSTANTIATE_ARITHM
+
+/** Handlers of a single operation and integer width */
+struct ArithmHandlers {
+    uint32_t (*IregIreg)(UVM* vm, uint32_t width, uint32_t flag);
+    uint32_t (*IregInt)(UVM* vm, uint32_t width, uint32_t flag);
+    uint32_t (*LoadIregIreg)(UVM* vm, uint32_t width, uint32_t flag);
+};
+
+/**
+ * Builds the handlers of all integer widths for a single operation
+ * @return Handlers indexed by IntType - 1
+ */
+template <ArithmOp Op, size_t... TypeIndex>
+static constexpr std::array<ArithmHandlers, INT_TYPE_COUNT>
+makeArithmRow(std::index_sequence<TypeIndex...>) {
+    return {{{instr_arithm_ireg_ireg<Op, static_cast<IntType>(TypeIndex + 1)>,
+              instr_arithm_ireg_int<Op, static_cast<IntType>(TypeIndex + 1)>,
+              instr_load_arithm_ireg_ireg<
+                  Op, static_cast<IntType>(TypeIndex + 1)>}...}};
+}
+
+/**
+ * Builds the handlers of all operations and integer widths
+ * @return Handlers indexed by ArithmOp and IntType - 1
+ */
+template <size_t... OpIndex>
+static constexpr std::array<std::array<ArithmHandlers, INT_TYPE_COUNT>,
+                            ARITHM_OP_COUNT>
+makeArithmTable(std::index_sequence<OpIndex...>) {
+    return {{makeArithmRow<static_cast<ArithmOp>(OpIndex)>(
+        std::make_index_sequence<INT_TYPE_COUNT>())...}};
+}
+
+/** Every integer arithmetic handler indexed by ArithmOp and IntType - 1 */
+static constexpr auto ARITHM_HANDLERS =
+    makeArithmTable(std::make_index_sequence<ARITHM_OP_COUNT>());
+
+/**
+ * Performs operations for instructions add, sub, mul, muls, div and divs with
+ * arguments <ireg> <ireg> by dispatching on the type operand
+ * @param vm UVM instance
+ * @param width Instruction width
+ * @param flag ArithmOp of the instruction
+ * @return On success returns UVM_SUCCESS otherwise error state [E_INVALID_TYPE,
+ * E_INVALID_SRC_REG, E_INVALID_DEST_REG, E_DIVISON_ZERO]
+ */
+uint32_t instr_arithm_common_ireg_ireg(UVM* vm, uint32_t width, uint32_t flag) {
+    // Versions:
+    // add <iT> <iR1> <iR2>
+    // sub <iT> <iR1> <iR2>
+    // mul <iT> <iR1> <iR2>
+    // muls <iT> <iR1> <iR2>
+    // div <iT> <iR1> <iR2>
+    // divs <iT> <iR1> <iR2>
+
+    constexpr uint32_t TYPE_OFFSET = 1;
+
+    // Valid IntType values are 0x1 - 0x4
+    uint32_t typeIndex = vm->MMU.InstrBuffer[TYPE_OFFSET] - 1u;
+    if (typeIndex >= INT_TYPE_COUNT) {
+        return E_INVALID_TYPE;
+    }
+
+    return ARITHM_HANDLERS[flag][typeIndex].IregIreg(vm, width, flag);
+}
+
 /**
  * Performs operations for instructions addf, subf, mulf and divf with arguments
  * <freg> <freg>
@@ -274,196 +427,6 @@ uint32_t instr_arithm_common_freg_freg(UVM* vm, uint32_t width, uint32_t flag) {
     return UVM_SUCCESS;
 }
 
-/**
- * Performs operations for instructions add, sub, mul, muls, div and divs with
- * arguments <ireg> <int>
- * @param vm UVM instance
- * @param width Instruction width
- * @param flag Bitmask of INSTR_FLAG_TYPE_* and INSTR_FLAG_OP_*
- * @return On success returns UVM_SUCCESS otherwise error state
- * [E_INVALID_SRC_REG, E_DIVISON_ZERO]
- */
-uint32_t instr_arithm_common_ireg_int(UVM* vm, uint32_t width, uint32_t flag) {
-    // Versions:
-    // add <iR> <i8>
-    // add <iR> <i16>
-    // add <iR> <i32>
-    // add <iR> <i64>
-    // sub <iR> <i8>
-    // sub <iR> <i16>
-    // sub <iR> <i32>
-    // sub <iR> <i64>
-    // mul <iR> <i8>
-    // mul <iR> <i16>
-    // mul <iR> <i32>
-    // mul <iR> <i64>
-    // muls <iR> <i8>
-    // muls <iR> <i16>
-    // muls <iR> <i32>
-    // muls <iR> <i64>
-    // div <iR> <i8>
-    // div <iR> <i16>
-    // div <iR> <i32>
-    // div <iR> <i64>
-
-    constexpr uint32_t REG_OFFSET = 1;
-    constexpr uint32_t INT_OFFSET = 2;
-
-    uint8_t regId = vm->MMU.InstrBuffer[REG_OFFSET];
-
-    IntVal regVal;
-    if (vm->MMU.getIntReg(regId, regVal) != 0) {
-        return E_INVALID_SRC_REG;
-    }
-
-    uint32_t type = flag & INSTR_FLAG_TYPE_MASK;
-
-    IntType intType = IntType::I8;
-    IntVal operandVal;
-    switch (type) {
-    case INSTR_FLAG_TYPE_I8:
-        intType = IntType::I8;
-        operandVal.I8 = vm->MMU.InstrBuffer[INT_OFFSET];
-        break;
-    case INSTR_FLAG_TYPE_I16:
-        intType = IntType::I16;
-        operandVal.I16 =
-            *reinterpret_cast<uint16_t*>(&vm->MMU.InstrBuffer[INT_OFFSET]);
-        break;
-    case INSTR_FLAG_TYPE_I32:
-        intType = IntType::I32;
-        operandVal.I32 =
-            *reinterpret_cast<uint32_t*>(&vm->MMU.InstrBuffer[INT_OFFSET]);
-        break;
-    case INSTR_FLAG_TYPE_I64:
-        intType = IntType::I64;
-        operandVal.I64 =
-            *reinterpret_cast<uint64_t*>(&vm->MMU.InstrBuffer[INT_OFFSET]);
-        break;
-    }
-
-    IntVal result;
-    if ((flag & INSTR_FLAG_OP_ADD) != 0) {
-        switch (type) {
-        case INSTR_FLAG_TYPE_I8:
-            result.I8 = regVal.I8 + operandVal.I8;
-            break;
-        case INSTR_FLAG_TYPE_I16:
-            result.I16 = regVal.I16 + operandVal.I16;
-            break;
-        case INSTR_FLAG_TYPE_I32:
-            result.I32 = regVal.I32 + operandVal.I32;
-            break;
-        case INSTR_FLAG_TYPE_I64:
-            result.I64 = regVal.I64 + operandVal.I64;
-            break;
-        }
-    } else if ((flag & INSTR_FLAG_OP_SUB) != 0) {
-        switch (type) {
-        case INSTR_FLAG_TYPE_I8:
-            result.I8 = regVal.I8 - operandVal.I8;
-            break;
-        case INSTR_FLAG_TYPE_I16:
-            result.I16 = regVal.I16 - operandVal.I16;
-            break;
-        case INSTR_FLAG_TYPE_I32:
-            result.I32 = regVal.I32 - operandVal.I32;
-            break;
-        case INSTR_FLAG_TYPE_I64:
-            result.I64 = regVal.I64 - operandVal.I64;
-            break;
-        }
-    } else if ((flag & INSTR_FLAG_OP_MUL) != 0) {
-        switch (type) {
-        case INSTR_FLAG_TYPE_I8:
-            result.I8 = regVal.I8 * operandVal.I8;
-            break;
-        case INSTR_FLAG_TYPE_I16:
-            result.I16 = regVal.I16 * operandVal.I16;
-            break;
-        case INSTR_FLAG_TYPE_I32:
-            result.I32 = regVal.I32 * operandVal.I32;
-            break;
-        case INSTR_FLAG_TYPE_I64:
-            result.I64 = regVal.I64 * operandVal.I64;
-            break;
-        }
-    } else if ((flag & INSTR_FLAG_OP_MULS) != 0) {
-        switch (type) {
-        case INSTR_FLAG_TYPE_I8:
-            result.S8 = regVal.S8 * operandVal.S8;
-            break;
-        case INSTR_FLAG_TYPE_I16:
-            result.S16 = regVal.S16 * operandVal.S16;
-            break;
-        case INSTR_FLAG_TYPE_I32:
-            result.S32 = regVal.S32 * operandVal.S32;
-            break;
-        case INSTR_FLAG_TYPE_I64:
-            result.S64 = regVal.S64 * operandVal.S64;
-            break;
-        }
-    } else if ((flag & INSTR_FLAG_OP_DIV) != 0) {
-        switch (type) {
-        case INSTR_FLAG_TYPE_I8:
-            if (operandVal.I8 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.I8 = regVal.I8 / operandVal.I8;
-            break;
-        case INSTR_FLAG_TYPE_I16:
-            if (operandVal.I16 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.I16 = regVal.I16 / operandVal.I16;
-            break;
-        case INSTR_FLAG_TYPE_I32:
-            if (operandVal.I32 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.I32 = regVal.I32 / operandVal.I32;
-            break;
-        case INSTR_FLAG_TYPE_I64:
-            if (operandVal.I64 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.I64 = regVal.I64 / operandVal.I64;
-            break;
-        }
-    } else if ((flag & INSTR_FLAG_OP_DIVS) != 0) {
-        switch (type) {
-        case INSTR_FLAG_TYPE_I8:
-            if (operandVal.S8 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.S8 = regVal.S8 / operandVal.S8;
-            break;
-        case INSTR_FLAG_TYPE_I16:
-            if (operandVal.S16 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.S16 = regVal.S16 / operandVal.S16;
-            break;
-        case INSTR_FLAG_TYPE_I32:
-            if (operandVal.S32 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.S32 = regVal.S32 / operandVal.S32;
-            break;
-        case INSTR_FLAG_TYPE_I64:
-            if (operandVal.S64 == 0) {
-                return E_DIVISON_ZERO;
-            }
-            result.S64 = regVal.S64 / operandVal.S64;
-            break;
-        }
-    }
-
-    vm->MMU.setIntReg(regId, result, intType);
-
-    return UVM_SUCCESS;
-}
-
 /**
  * Performs operations for instructions addf, subf, mulf and divf with arguments
  * <freg> <float>
@@ -16,6 +16,7 @@
 
 #include "../error.hpp"
 #include "instructions.hpp"
+#include <cstring>
 #include <iostream>
 
 /**
@@ -51,38 +52,11 @@ uint32_t instr_cmp(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_DEST_REG;
     }
 
-    IntVal result;
-    uint32_t shiftWidth = 0;
-    switch (intType) {
-    case IntType::I8:
-        result.I8 = srcRegVal.I8 - destRegVal.I8;
-        shiftWidth = 7;
-        break;
-    case IntType::I16:
-        result.I16 = srcRegVal.I16 - destRegVal.I16;
-        shiftWidth = 15;
-        break;
-    case IntType::I32:
-        result.I32 = srcRegVal.I32 - destRegVal.I32;
-        shiftWidth = 31;
-        break;
-    case IntType::I64:
-        result.I64 = srcRegVal.I64 - destRegVal.I64;
-        shiftWidth = 63;
-        break;
-    }
-
-    if (result.I64 == 0.0f) {
-        vm->MMU.Flags.Zero = true;
-    } else {
-        vm->MMU.Flags.Zero = false;
-    }
-
-    if ((result.I64 >> shiftWidth) == 1) {
-        vm->MMU.Flags.Signed = true;
-    } else {
-        vm->MMU.Flags.Signed = false;
-    }
+    // Flags are derived from the operands once a jump needs them
+    vm->MMU.Flags.CmpLhs = srcRegVal.I64;
+    vm->MMU.Flags.CmpRhs = destRegVal.I64;
+    vm->MMU.Flags.Type =
+        static_cast<CmpType>(static_cast<uint8_t>(intType) - 1);
 
     return UVM_SUCCESS;
 }
@@ -120,31 +94,11 @@ uint32_t instr_cmpf(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_DEST_REG;
     }
 
-    FloatVal result;
-    // This bit mask is used to determin if the float/double is signed
-    uint64_t floatSignBitMask = 0;
-    switch (floatType) {
-    case FloatType::F32:
-        result.F32 = srcRegVal.F32 - destRegVal.F32;
-        floatSignBitMask = 0x80000000;
-        break;
-    case FloatType::F64:
-        result.F64 = srcRegVal.F64 - destRegVal.F64;
-        floatSignBitMask = 0x8000000000000000;
-        break;
-    }
-
-    if (result.F64 == 0) {
-        vm->MMU.Flags.Zero = true;
-    } else {
-        vm->MMU.Flags.Zero = false;
-    }
-
-    if ((*reinterpret_cast<uint64_t*>(&result.F64) & floatSignBitMask) == 0) {
-        vm->MMU.Flags.Signed = false;
-    } else {
-        vm->MMU.Flags.Signed = true;
-    }
+    // Flags are derived from the operands once a jump needs them
+    std::memcpy(&vm->MMU.Flags.CmpLhs, &srcRegVal, 8);
+    std::memcpy(&vm->MMU.Flags.CmpRhs, &destRegVal, 8);
+    vm->MMU.Flags.Type =
+        floatType == FloatType::F32 ? CmpType::F32 : CmpType::F64;
 
     return UVM_SUCCESS;
 }
@@ -164,57 +118,20 @@ uint32_t instr_jmp(UVM* vm, uint32_t width, uint32_t flag) {
     uint64_t targetAddr =
         *reinterpret_cast<uint64_t*>(&vm->MMU.InstrBuffer[ADDR_OFFSET]);
 
-    MemSection* memSec = vm->MMU.findSection(targetAddr, 1);
-    if (memSec == nullptr) {
-        return E_INVALID_JUMP_DEST;
+    uint32_t targetStatus = vm->MMU.checkJumpTarget(targetAddr);
+    if (targetStatus != UVM_SUCCESS) {
+        return targetStatus;
     }
 
-    if ((memSec->Perm & PERM_EXE_MASK) != PERM_EXE_MASK) {
-        return E_MISSING_PERM;
+    uint32_t takeJump = 1;
+    if (flag != static_cast<uint32_t>(JumpCondition::UNCONDITIONAL)) {
+        uint32_t zeroSigned = vm->MMU.Flags.evalZeroSigned();
+        takeJump = (JUMP_TRUTH_TABLE[flag] >> zeroSigned) & 1;
     }
 
-    JumpCondition cond = static_cast<JumpCondition>(flag);
-    switch (cond) {
-    case JumpCondition::UNCONDITIONAL:
-        vm->MMU.IP = targetAddr;
+    if (takeJump != 0) {
+        vm->MMU.Regs[REG_INSTR_PTR].I64 = targetAddr;
         return UVM_SUCCESS_JUMPED;
-    case JumpCondition::IF_EQUALS:
-        if (vm->MMU.Flags.Zero) {
-            vm->MMU.IP = targetAddr;
-            return UVM_SUCCESS_JUMPED;
-        }
-        break;
-    case JumpCondition::IF_NOT_EQUALS:
-        if (!vm->MMU.Flags.Zero) {
-            vm->MMU.IP = targetAddr;
-            return UVM_SUCCESS_JUMPED;
-        }
-        break;
-    case JumpCondition::IF_GREATER_THAN:
-        if (!vm->MMU.Flags.Zero && !vm->MMU.Flags.Signed) {
-            vm->MMU.IP = targetAddr;
-            return UVM_SUCCESS_JUMPED;
-        }
-        break;
-    case JumpCondition::IF_LESS_THAN:
-        if (!vm->MMU.Flags.Zero && vm->MMU.Flags.Signed) {
-            vm->MMU.IP = targetAddr;
-            return UVM_SUCCESS_JUMPED;
-        }
-        break;
-    case JumpCondition::IF_GREATER_EQUALS:
-        if (!vm->MMU.Flags.Signed) {
-            vm->MMU.IP = targetAddr;
-            return UVM_SUCCESS_JUMPED;
-        }
-        break;
-    case JumpCondition::IF_LESS_EQUALS:
-        if ((vm->MMU.Flags.Zero && !vm->MMU.Flags.Signed) ||
-            (!vm->MMU.Flags.Zero && vm->MMU.Flags.Signed)) {
-            vm->MMU.IP = targetAddr;
-            return UVM_SUCCESS_JUMPED;
-        }
-        break;
     }
 
     return UVM_SUCCESS;
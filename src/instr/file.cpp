@@ -0,0 +1,394 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "../async_io.hpp"
+#include "../error.hpp"
+#include "../file_io.hpp"
+#include "instructions.hpp"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Failing host operations return -1 or UVM_NULLPTR to the program, only
+// invalid guest memory makes the syscall itself fail. Reads and writes work
+// directly on the memory buffers of the guest range.
+
+/**
+ * Opens a host file
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+static bool syscall_file_open(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t path string pointer
+    // r1: uint32_t path string size
+    // r2: uint32_t combination of FILE_MODE_* flags
+
+    // Return values:
+    // r0: int64_t file handle or -1
+
+    MemManager& mmu = vm->MMU;
+    uint64_t pathAddr = mmu.Regs[REG_GP_START].I64;
+    uint32_t pathSize = mmu.Regs[REG_GP_START + 1].I32;
+    uint32_t mode = mmu.Regs[REG_GP_START + 2].I32;
+
+    std::vector<MemSpan> spans;
+    if (mmu.resolveRange(pathAddr, pathSize, PERM_READ_MASK, spans) !=
+        UVM_SUCCESS) {
+        return false;
+    }
+
+    std::string path;
+    path.reserve(pathSize);
+    for (const MemSpan& span : spans) {
+        path.append(reinterpret_cast<const char*>(span.Ptr), span.Size);
+    }
+
+    int64_t handle = -1;
+    HostFile file = openHostFile(std::filesystem::u8path(path), mode);
+    if (file != INVALID_HOST_FILE) {
+        handle = vm->Files.add(file);
+    }
+    mmu.Regs[REG_GP_START].S64 = handle;
+    return true;
+}
+
+/**
+ * Reads from a file into guest memory
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+static bool syscall_file_read(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t file handle
+    // r1: uint64_t destination pointer
+    // r2: uint32_t number of bytes to read
+
+    // Return values:
+    // r0: int64_t number of bytes read, less at the end of the file, or -1
+
+    MemManager& mmu = vm->MMU;
+    HostFile file = vm->Files.get(mmu.Regs[REG_GP_START].I64);
+    uint64_t destAddr = mmu.Regs[REG_GP_START + 1].I64;
+    uint32_t size = mmu.Regs[REG_GP_START + 2].I32;
+
+    std::vector<MemSpan> spans;
+    if (mmu.resolveRange(destAddr, size, PERM_WRITE_MASK, spans) !=
+        UVM_SUCCESS) {
+        return false;
+    }
+    if (file == INVALID_HOST_FILE) {
+        mmu.Regs[REG_GP_START].S64 = -1;
+        return true;
+    }
+
+    int64_t total = 0;
+    for (const MemSpan& span : spans) {
+        int64_t res = readHostFile(file, span.Ptr, span.Size);
+        if (res < 0) {
+            total = -1;
+            break;
+        }
+        total += res;
+        if (static_cast<size_t>(res) < span.Size) {
+            break;
+        }
+    }
+
+    if (total > 0) {
+        mmu.logWrite(destAddr, static_cast<uint32_t>(total));
+    }
+    mmu.Regs[REG_GP_START].S64 = total;
+    return true;
+}
+
+/**
+ * Writes guest memory to a file
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+static bool syscall_file_write(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t file handle
+    // r1: uint64_t source pointer
+    // r2: uint32_t number of bytes to write
+
+    // Return values:
+    // r0: int64_t number of bytes written or -1
+
+    MemManager& mmu = vm->MMU;
+    HostFile file = vm->Files.get(mmu.Regs[REG_GP_START].I64);
+    uint64_t srcAddr = mmu.Regs[REG_GP_START + 1].I64;
+    uint32_t size = mmu.Regs[REG_GP_START + 2].I32;
+
+    std::vector<MemSpan> spans;
+    if (mmu.resolveRange(srcAddr, size, PERM_READ_MASK, spans) !=
+        UVM_SUCCESS) {
+        return false;
+    }
+    if (file == INVALID_HOST_FILE) {
+        mmu.Regs[REG_GP_START].S64 = -1;
+        return true;
+    }
+
+    int64_t total = 0;
+    for (const MemSpan& span : spans) {
+        if (writeHostFile(file, span.Ptr, span.Size) < 0) {
+            total = -1;
+            break;
+        }
+        total += span.Size;
+    }
+    mmu.Regs[REG_GP_START].S64 = total;
+    return true;
+}
+
+/**
+ * Moves the position of a file
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+static bool syscall_file_seek(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t file handle
+    // r1: int64_t offset
+    // r2: uint32_t origin, one of FILE_SEEK_*
+
+    // Return values:
+    // r0: int64_t new position or -1
+
+    MemManager& mmu = vm->MMU;
+    HostFile file = vm->Files.get(mmu.Regs[REG_GP_START].I64);
+    int64_t offset = mmu.Regs[REG_GP_START + 1].S64;
+    uint32_t origin = mmu.Regs[REG_GP_START + 2].I32;
+
+    int64_t position = -1;
+    if (file != INVALID_HOST_FILE) {
+        position = seekHostFile(file, offset, origin);
+    }
+    mmu.Regs[REG_GP_START].S64 = position;
+    return true;
+}
+
+/**
+ * Closes a file
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+static bool syscall_file_close(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t file handle
+
+    // Return values:
+    // r0: int64_t 0 or -1, files of pending async requests stay open
+
+    MemManager& mmu = vm->MMU;
+    uint64_t handle = mmu.Regs[REG_GP_START].I64;
+    HostFile file = vm->Files.get(handle);
+    bool closed = file != INVALID_HOST_FILE && !vm->Async.usesFile(file) &&
+                  vm->Files.close(handle);
+    mmu.Regs[REG_GP_START].S64 = closed ? 0 : -1;
+    return true;
+}
+
+/**
+ * Maps a range of a file read only into the guest address space without
+ * copying it
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+static bool syscall_file_map(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t file handle
+    // r1: uint64_t file offset
+    // r2: uint32_t size, 0 maps until the end of the file
+
+    // Return values:
+    // r0: uint64_t virtual address of the mapped range or UVM_NULLPTR
+
+    MemManager& mmu = vm->MMU;
+    HostFile file = vm->Files.get(mmu.Regs[REG_GP_START].I64);
+    uint64_t offset = mmu.Regs[REG_GP_START + 1].I64;
+    uint32_t size = mmu.Regs[REG_GP_START + 2].I32;
+
+    uint64_t vAddr = UVM_NULLPTR;
+    FileMapping mapping;
+    if (file != INVALID_HOST_FILE &&
+        mapHostFile(file, offset, size, mapping)) {
+        vAddr = mmu.addFileMapping(mapping);
+        if (vAddr == UVM_NULLPTR) {
+            unmapHostFile(mapping);
+        }
+    }
+    mmu.Regs[REG_GP_START].I64 = vAddr;
+    return true;
+}
+
+/**
+ * Unmaps a range mapped by SYSCALL_FILE_MAP
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+static bool syscall_file_unmap(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t virtual address returned by SYSCALL_FILE_MAP
+
+    // Return values:
+    // -
+
+    return vm->MMU.removeFileMapping(vm->MMU.Regs[REG_GP_START].I64) ==
+           UVM_SUCCESS;
+}
+
+/**
+ * Queues a read or write at a file offset. Written data is copied when the
+ * request is submitted and read data when it is completed, the guest buffer
+ * may be used in between. The copy counts against the memory limits.
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+static bool syscall_async_submit(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t file handle
+    // r1: uint64_t buffer pointer
+    // r2: uint32_t number of bytes to read or write
+    // r3: uint64_t file offset
+    // r4: uint32_t operation, ASYNC_OP_READ or ASYNC_OP_WRITE
+
+    // Return values:
+    // r0: int64_t request id or -1
+
+    MemManager& mmu = vm->MMU;
+    auto request = std::make_unique<AsyncRequest>();
+    request->File = vm->Files.get(mmu.Regs[REG_GP_START].I64);
+    request->GuestAddr = mmu.Regs[REG_GP_START + 1].I64;
+    uint32_t size = mmu.Regs[REG_GP_START + 2].I32;
+    request->Offset = mmu.Regs[REG_GP_START + 3].I64;
+    uint32_t op = mmu.Regs[REG_GP_START + 4].I32;
+    request->Write = op == ASYNC_OP_WRITE;
+
+    std::vector<MemSpan> spans;
+    uint8_t perm = request->Write ? PERM_READ_MASK : PERM_WRITE_MASK;
+    if (mmu.resolveRange(request->GuestAddr, size, perm, spans) !=
+        UVM_SUCCESS) {
+        return false;
+    }
+    if (request->File == INVALID_HOST_FILE ||
+        (op != ASYNC_OP_READ && op != ASYNC_OP_WRITE)) {
+        mmu.Regs[REG_GP_START].S64 = -1;
+        return true;
+    }
+
+    // The host copy of the data counts against the memory limits
+    uint64_t used = mmu.usage().total() + size;
+    if ((mmu.Quota.SoftLimit != 0 && used > mmu.Quota.SoftLimit) ||
+        (mmu.Quota.HardLimit != 0 && used > mmu.Quota.HardLimit)) {
+        mmu.Regs[REG_GP_START].S64 = -1;
+        return true;
+    }
+
+    request->Data.resize(size);
+    if (request->Write) {
+        size_t offset = 0;
+        for (const MemSpan& span : spans) {
+            std::memcpy(&request->Data[offset], span.Ptr, span.Size);
+            offset += span.Size;
+        }
+    }
+    int64_t id = vm->Async.submit(std::move(request));
+    if (id >= 0) {
+        mmu.Usage.AsyncBytes += size;
+    }
+    mmu.Regs[REG_GP_START].S64 = id;
+    return true;
+}
+
+/**
+ * Completes an async request and copies read data into the guest buffer
+ * @param vm UVM instance
+ * @param block Wait until a request completes
+ * @return On success returns true otherwise false
+ */
+static bool syscall_async_complete(UVM* vm, bool block) {
+    // Arguments:
+    // -
+
+    // Return values:
+    // r0: int64_t id of the completed request or -1 if none completed
+    // r1: int64_t number of bytes transferred, less at the end of the file,
+    //     or -1
+
+    MemManager& mmu = vm->MMU;
+    std::unique_ptr<AsyncRequest> request = vm->Async.complete(block);
+    if (request == nullptr) {
+        mmu.Regs[REG_GP_START].S64 = -1;
+        mmu.Regs[REG_GP_START + 1].S64 = -1;
+        return true;
+    }
+    mmu.Usage.AsyncBytes -= request->Data.size();
+
+    if (!request->Write && request->Result > 0) {
+        std::vector<MemSpan> spans;
+        uint32_t size = static_cast<uint32_t>(request->Result);
+        if (mmu.resolveRange(request->GuestAddr, size, PERM_WRITE_MASK,
+                             spans) != UVM_SUCCESS) {
+            return false;
+        }
+
+        size_t offset = 0;
+        for (const MemSpan& span : spans) {
+            std::memcpy(span.Ptr, &request->Data[offset], span.Size);
+            offset += span.Size;
+        }
+        mmu.logWrite(request->GuestAddr, size);
+    }
+
+    mmu.Regs[REG_GP_START].S64 = static_cast<int64_t>(request->Id);
+    mmu.Regs[REG_GP_START + 1].S64 = request->Result;
+    return true;
+}
+
+/**
+ * Performs the file syscalls
+ * @param vm UVM instance
+ * @param syscallType Syscall id, one of SYSCALL_FILE_*
+ * @return On success returns true otherwise false
+ */
+bool syscall_file_io(UVM* vm, uint8_t syscallType) {
+    switch (syscallType) {
+    case SYSCALL_FILE_OPEN:
+        return syscall_file_open(vm);
+    case SYSCALL_FILE_READ:
+        return syscall_file_read(vm);
+    case SYSCALL_FILE_WRITE:
+        return syscall_file_write(vm);
+    case SYSCALL_FILE_SEEK:
+        return syscall_file_seek(vm);
+    case SYSCALL_FILE_CLOSE:
+        return syscall_file_close(vm);
+    case SYSCALL_FILE_MAP:
+        return syscall_file_map(vm);
+    case SYSCALL_ASYNC_SUBMIT:
+        return syscall_async_submit(vm);
+    case SYSCALL_ASYNC_POLL:
+        return syscall_async_complete(vm, false);
+    case SYSCALL_ASYNC_WAIT:
+        return syscall_async_complete(vm, true);
+    default:
+        return syscall_file_unmap(vm);
+    }
+}
@@ -38,21 +38,17 @@ uint32_t instr_call(UVM* vm, uint32_t width, uint32_t flag) {
         reinterpret_cast<uint64_t*>(&vm->MMU.InstrBuffer[ADDR_OFFSET]);
 
     // Push next instruction pointer
-    uint64_t currentIP = vm->MMU.IP + width;
-    if (vm->MMU.stackPush(&currentIP, UVMDataSize::QWORD) != 0) {
+    uint64_t currentIP = vm->MMU.Regs[REG_INSTR_PTR].I64 + width;
+    if (vm->MMU.pushReturnAddr(currentIP) != 0) {
         return E_INVALID_STACK_OP;
     }
 
-    MemSection* memSec = vm->MMU.findSection(*targetAddr, 1);
-    if (memSec == nullptr) {
-        return E_INVALID_JUMP_DEST;
+    uint32_t targetStatus = vm->MMU.checkJumpTarget(*targetAddr);
+    if (targetStatus != UVM_SUCCESS) {
+        return targetStatus;
     }
 
-    if ((memSec->Perm & PERM_EXE_MASK) != PERM_EXE_MASK) {
-        return E_MISSING_PERM;
-    }
-
-    vm->MMU.IP = *targetAddr;
+    vm->MMU.Regs[REG_INSTR_PTR].I64 = *targetAddr;
 
     return UVM_SUCCESS_JUMPED;
 }
@@ -68,20 +64,12 @@ uint32_t instr_call(UVM* vm, uint32_t width, uint32_t flag) {
  */
 uint32_t instr_ret(UVM* vm, uint32_t width, uint32_t flag) {
     uint64_t targetIP = 0;
-    if (vm->MMU.stackPop(&targetIP, UVMDataSize::QWORD) != 0) {
-        return E_INVALID_STACK_OP;
-    }
-
-    MemSection* memSec = vm->MMU.findSection(targetIP, 1);
-    if (memSec == nullptr) {
-        return E_INVALID_JUMP_DEST;
-    }
-
-    if ((memSec->Perm & PERM_EXE_MASK) != PERM_EXE_MASK) {
-        return E_MISSING_PERM;
+    uint32_t targetStatus = vm->MMU.popReturnAddr(&targetIP);
+    if (targetStatus != UVM_SUCCESS) {
+        return targetStatus;
     }
 
-    vm->MMU.IP = targetIP;
+    vm->MMU.Regs[REG_INSTR_PTR].I64 = targetIP;
 
     return UVM_SUCCESS_JUMPED;
 }
@@ -124,13 +124,53 @@ constexpr uint8_t OP_JGT = 0xE4;
 constexpr uint8_t OP_JLT = 0xE5;
 constexpr uint8_t OP_JGE = 0xE6;
 constexpr uint8_t OP_JLE = 0xE7;
+constexpr uint8_t OP_VLOAD_RO_VR = 0xF0;
+constexpr uint8_t OP_VSTORE_VR_RO = 0xF1;
+constexpr uint8_t OP_VADD_VT_VR_VR = 0xF2;
+constexpr uint8_t OP_VSUB_VT_VR_VR = 0xF3;
+constexpr uint8_t OP_VMUL_VT_VR_VR = 0xF4;
+constexpr uint8_t OP_VMIN_VT_VR_VR = 0xF5;
+constexpr uint8_t OP_VMAX_VT_VR_VR = 0xF6;
+constexpr uint8_t OP_VCMPEQ_VT_VR_VR = 0xF7;
+constexpr uint8_t OP_VCMPGT_VT_VR_VR = 0xF8;
+constexpr uint8_t OP_VSHUF_VR_I8_VR = 0xF9;
 
 // Syscalls
 constexpr uint8_t SYSCALL_PRINT = 0x1;
 constexpr uint8_t SYSCALL_CONSOLE_READ = 0x2;
+constexpr uint8_t SYSCALL_CONSOLE_READ_BULK = 0x3;
+constexpr uint8_t SYSCALL_CONSOLE_READ_LINES = 0x4;
 constexpr uint8_t SYSCALL_TIME = 0x10;
+constexpr uint8_t SYSCALL_TIME_MONOTONIC = 0x11;
+constexpr uint8_t SYSCALL_TIME_THREAD_CPU = 0x12;
+constexpr uint8_t SYSCALL_CYCLES = 0x13;
+constexpr uint8_t SYSCALL_CYCLES_FREQUENCY = 0x14;
+constexpr uint8_t SYSCALL_FILE_OPEN = 0x20;
+constexpr uint8_t SYSCALL_FILE_READ = 0x21;
+constexpr uint8_t SYSCALL_FILE_WRITE = 0x22;
+constexpr uint8_t SYSCALL_FILE_SEEK = 0x23;
+constexpr uint8_t SYSCALL_FILE_CLOSE = 0x24;
+constexpr uint8_t SYSCALL_FILE_MAP = 0x25;
+constexpr uint8_t SYSCALL_FILE_UNMAP = 0x26;
+constexpr uint8_t SYSCALL_ASYNC_SUBMIT = 0x27;
+constexpr uint8_t SYSCALL_ASYNC_POLL = 0x28;
+constexpr uint8_t SYSCALL_ASYNC_WAIT = 0x29;
 constexpr uint8_t SYSCALL_ALLOC = 0x41;
 constexpr uint8_t SYSCALL_DEALLOC = 0x44;
+constexpr uint8_t SYSCALL_MEMCPY = 0x45;
+constexpr uint8_t SYSCALL_MEMSET = 0x46;
+constexpr uint8_t SYSCALL_MEMCMP = 0x47;
+constexpr uint8_t SYSCALL_MEMCHR = 0x48;
+constexpr uint8_t SYSCALL_MEM_USAGE = 0x49;
+constexpr uint8_t SYSCALL_GC_COLLECT = 0x4A;
+constexpr uint8_t SYSCALL_VEC_DOT = 0x50;
+constexpr uint8_t SYSCALL_VEC_SUM = 0x51;
+constexpr uint8_t SYSCALL_VEC_MIN = 0x52;
+constexpr uint8_t SYSCALL_VEC_MAX = 0x53;
+constexpr uint8_t SYSCALL_VEC_AXPY = 0x54;
+constexpr uint8_t SYSCALL_VEC_EXP = 0x55;
+constexpr uint8_t SYSCALL_VEC_LOG = 0x56;
+constexpr uint8_t SYSCALL_VEC_SQRT = 0x57;
 
 // Instruction flags
 // clang-format off
@@ -168,6 +208,42 @@ enum class JumpCondition {
     IF_LESS_EQUALS,
 };
 
+/** Jump taken for each combination of <signed> <zero> flags, indexed by
+ * JumpCondition */
+constexpr uint8_t JUMP_TRUTH_TABLE[] = {
+    0b1111, // UNCONDITIONAL
+    0b1010, // IF_EQUALS: zero
+    0b0101, // IF_NOT_EQUALS: !zero
+    0b0001, // IF_GREATER_THAN: !zero && !signed
+    0b0100, // IF_LESS_THAN: !zero && signed
+    0b0011, // IF_GREATER_EQUALS: !signed
+    0b0110, // IF_LESS_EQUALS: zero != signed
+};
+
+/** Integer arithmetic operations, used as flag of arithm_common_ireg_ireg */
+enum class ArithmOp {
+    ADD,
+    SUB,
+    MUL,
+    MULS,
+    DIV,
+    DIVS,
+};
+
+constexpr size_t ARITHM_OP_COUNT = 6;
+constexpr size_t INT_TYPE_COUNT = 4;
+
+/** Packed lane operations, used as flag of varithm_vtype_vreg_vreg */
+enum class VecOp {
+    ADD,
+    SUB,
+    MUL,
+    MIN,
+    MAX,
+    CMPEQ,
+    CMPGT,
+};
+
 // Note: For readability use snake_case for instruction function names
 #define MAKE_INSTR(name)                                                       \
     uint32_t instr_##name(UVM* vm, uint32_t width, uint32_t flag)
@@ -176,7 +252,7 @@ enum class JumpCondition {
 // Arithmetic
 MAKE_INSTR(arithm_common_ireg_ireg);
 MAKE_INSTR(arithm_common_freg_freg);
-MAKE_INSTR(arithm_common_ireg_int);
+template <ArithmOp Op, IntType Type> MAKE_INSTR(arithm_ireg_int);
 MAKE_INSTR(arithm_common_freg_float);
 MAKE_INSTR(bitwise_common_itype_ireg_ireg);
 MAKE_INSTR(shift_common_ireg_ireg);
@@ -218,3 +294,14 @@ MAKE_INSTR(copyf_ro_ro);
 MAKE_INSTR(lea_ro_ireg);
 // Syscall
 MAKE_INSTR(syscall);
+bool syscall_vec_math(UVM* vm, uint8_t kernel);
+bool syscall_file_io(UVM* vm, uint8_t syscallType);
+// Vector
+MAKE_INSTR(vload_ro_vreg);
+MAKE_INSTR(vstore_vreg_ro);
+MAKE_INSTR(varithm_vtype_vreg_vreg);
+MAKE_INSTR(vshuf_vreg_int_vreg);
+// Fused instructions, only emitted by the peephole optimizer of loop traces
+template <ArithmOp Op, IntType Type> MAKE_INSTR(load_arithm_ireg_ireg);
+template <IntType Type> MAKE_INSTR(lsh_ireg_int);
+MAKE_INSTR(push_pop_ireg);
@@ -19,6 +19,86 @@
 #include <cstring>
 #include <iostream>
 
+/**
+ * Loads an integer of given type from virtual memory
+ * @param mmu Memory manager
+ * @param vAddr Source virtual address
+ * @param type Type of the integer
+ * @param val [out] Loaded integer
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_VADDR_NOT_FOUND, E_MISSING_PERM]
+ */
+static uint32_t
+loadInt(MemManager& mmu, uint64_t vAddr, IntType type, IntVal& val) {
+    switch (type) {
+    case IntType::I8:
+        return mmu.load(vAddr, val.I8);
+    case IntType::I16:
+        return mmu.load(vAddr, val.I16);
+    case IntType::I32:
+        return mmu.load(vAddr, val.I32);
+    default:
+        return mmu.load(vAddr, val.I64);
+    }
+}
+
+/**
+ * Stores an integer of given type to virtual memory
+ * @param mmu Memory manager
+ * @param vAddr Destination virtual address
+ * @param type Type of the integer
+ * @param val Integer to store
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_VADDR_NOT_FOUND, E_MISSING_PERM]
+ */
+static uint32_t
+storeInt(MemManager& mmu, uint64_t vAddr, IntType type, IntVal val) {
+    switch (type) {
+    case IntType::I8:
+        return mmu.store(vAddr, val.I8);
+    case IntType::I16:
+        return mmu.store(vAddr, val.I16);
+    case IntType::I32:
+        return mmu.store(vAddr, val.I32);
+    default:
+        return mmu.store(vAddr, val.I64);
+    }
+}
+
+/**
+ * Loads a float of given type from virtual memory
+ * @param mmu Memory manager
+ * @param vAddr Source virtual address
+ * @param type Type of the float
+ * @param val [out] Loaded float
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_VADDR_NOT_FOUND, E_MISSING_PERM]
+ */
+static uint32_t
+loadFloat(MemManager& mmu, uint64_t vAddr, FloatType type, FloatVal& val) {
+    if (type == FloatType::F32) {
+        return mmu.load(vAddr, val.F32);
+    }
+    return mmu.load(vAddr, val.F64);
+}
+
+/**
+ * Stores a float of given type to virtual memory
+ * @param mmu Memory manager
+ * @param vAddr Destination virtual address
+ * @param type Type of the float
+ * @param val Float to store
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_VADDR_NOT_FOUND, E_MISSING_PERM]
+ */
+static uint32_t
+storeFloat(MemManager& mmu, uint64_t vAddr, FloatType type, FloatVal val) {
+    if (type == FloatType::F32) {
+        return mmu.store(vAddr, val.F32);
+    }
+    return mmu.store(vAddr, val.F64);
+}
+
 /**
  * Pushes an integer value of given size on top of the stack and increases the
  * stack pointer by the size of the pushed value
@@ -219,6 +299,37 @@ uint32_t instr_pop_ireg(UVM* vm, uint32_t width, uint32_t flag) {
     return UVM_SUCCESS;
 }
 
+/**
+ * Fused push <iT> <iR1> followed by pop <iT> <iR2>. The pushed value is still
+ * written to the stack but the stack pointer stays unchanged. The buffer holds
+ * the push instruction followed by the id of iR2. iR1 has been validated as
+ * readable integer register, iR2 as general purpose register and the types as
+ * equal.
+ * @param vm UVM instance
+ * @param width Unused
+ * @param flag Size of iT in bytes
+ * @return On success returns UVM_SUCCESS otherwise E_INVALID_STACK_OP
+ */
+uint32_t instr_push_pop_ireg(UVM* vm, uint32_t width, uint32_t flag) {
+    constexpr uint32_t SRC_IREG_OFFSET = 2;
+    constexpr uint32_t DEST_IREG_OFFSET = 3;
+
+    MemManager& mmu = vm->MMU;
+    uint64_t sp = mmu.Regs[REG_STACK_PTR].I64;
+    if (sp + flag > mmu.VStackEnd) {
+        return E_INVALID_STACK_OP;
+    }
+
+    uint64_t val = mmu.Regs[mmu.InstrBuffer[SRC_IREG_OFFSET]].I64;
+    uint8_t* stackBuffer = mmu.Buffers[mmu.StackBufferIndex].Buffer;
+    memcpy(&stackBuffer[sp - mmu.VStackStart], &val, flag);
+    mmu.logWrite(sp, flag);
+
+    memcpy(&mmu.Regs[mmu.InstrBuffer[DEST_IREG_OFFSET]].I64, &val, flag);
+
+    return UVM_SUCCESS;
+}
+
 /**
  * Loads an immedate integer value into an integer register
  * @param vm UVM instance
@@ -293,43 +404,9 @@ uint32_t instr_load_ro_ireg(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_DEST_REG_OFFSET;
     }
 
-    UVMDataSize readSize = UVMDataSize::BYTE;
-    switch (intType) {
-    case IntType::I8:
-        readSize = UVMDataSize::BYTE;
-        break;
-    case IntType::I16:
-        readSize = UVMDataSize::WORD;
-        break;
-    case IntType::I32:
-        readSize = UVMDataSize::DWORD;
-        break;
-    case IntType::I64:
-        readSize = UVMDataSize::QWORD;
-        break;
-    }
-
-    uint64_t readBuff = 0;
-    uint32_t readRes = vm->MMU.read(
-        roAddress, reinterpret_cast<uint8_t*>(&readBuff), readSize, 0);
-    if (readRes != UVM_SUCCESS) {
-        return E_INVALID_READ;
-    }
-
     IntVal intVal;
-    switch (intType) {
-    case IntType::I8:
-        intVal.I8 = *reinterpret_cast<uint8_t*>(&readBuff);
-        break;
-    case IntType::I16:
-        std::memcpy(&intVal.I16, &readBuff, 2);
-        break;
-    case IntType::I32:
-        std::memcpy(&intVal.I32, &readBuff, 4);
-        break;
-    case IntType::I64:
-        std::memcpy(&intVal.I64, &readBuff, 8);
-        break;
+    if (loadInt(vm->MMU, roAddress, intType, intVal) != UVM_SUCCESS) {
+        return E_INVALID_READ;
     }
 
     if (vm->MMU.setIntReg(srcRegId, intVal, intType) != 0) {
@@ -402,31 +479,9 @@ uint32_t instr_loadf_ro_freg(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_SRC_REG_OFFSET;
     }
 
-    UVMDataSize readSize = UVMDataSize::BYTE;
-    switch (floatType) {
-    case FloatType::F32:
-        readSize = UVMDataSize::DWORD;
-        break;
-    case FloatType::F64:
-        readSize = UVMDataSize::QWORD;
-        break;
-    }
-
-    uint64_t readBuff = 0;
-    uint32_t readRes = vm->MMU.read(
-        roAddress, reinterpret_cast<uint8_t*>(&readBuff), readSize, 0);
-    if (readRes != UVM_SUCCESS) {
-        return E_INVALID_READ;
-    }
-
     FloatVal floatVal;
-    switch (floatType) {
-    case FloatType::F32:
-        std::memcpy(&floatVal.F32, &readBuff, 4);
-        break;
-    case FloatType::F64:
-        std::memcpy(&floatVal.F64, &readBuff, 8);
-        break;
+    if (loadFloat(vm->MMU, roAddress, floatType, floatVal) != UVM_SUCCESS) {
+        return E_INVALID_READ;
     }
 
     if (vm->MMU.setFloatReg(fReg, floatVal, floatType) != 0) {
@@ -467,24 +522,7 @@ uint32_t instr_store_ireg_ro(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_DEST_REG_OFFSET;
     }
 
-    UVMDataSize writeSize = UVMDataSize::BYTE;
-    switch (intType) {
-    case IntType::I8:
-        writeSize = UVMDataSize::BYTE;
-        break;
-    case IntType::I16:
-        writeSize = UVMDataSize::WORD;
-        break;
-    case IntType::I32:
-        writeSize = UVMDataSize::DWORD;
-        break;
-    case IntType::I64:
-        writeSize = UVMDataSize::QWORD;
-        break;
-    }
-
-    uint32_t writeRes = vm->MMU.write(&intReg, roAddress, writeSize, 0);
-    if (writeRes != UVM_SUCCESS) {
+    if (storeInt(vm->MMU, roAddress, intType, intReg) != UVM_SUCCESS) {
         return E_INVALID_WRITE;
     }
 
@@ -525,17 +563,8 @@ uint32_t instr_storef_freg_ro(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_DEST_REG_OFFSET;
     }
 
-    UVMDataSize writeSize = UVMDataSize::BYTE;
-    switch (floatType) {
-    case FloatType::F32:
-        writeSize = UVMDataSize::DWORD;
-        break;
-    case FloatType::F64:
-        writeSize = UVMDataSize::QWORD;
-        break;
-    }
-
-    uint32_t writeRes = vm->MMU.write(&sourceRegVal, roAddress, writeSize, 0);
+    uint32_t writeRes =
+        storeFloat(vm->MMU, roAddress, floatType, sourceRegVal);
     if (writeRes != UVM_SUCCESS) {
         return E_INVALID_WRITE;
     }
@@ -565,26 +594,21 @@ uint32_t instr_copy_int_ro(UVM* vm, uint32_t width, uint32_t flag) {
     uint32_t roOffset = 0;
 
     IntVal immVal;
-    UVMDataSize intSize = UVMDataSize::BYTE;
     switch (type) {
     case IntType::I8:
         immVal.I8 = vm->MMU.InstrBuffer[INT_OFFSET];
-        intSize = UVMDataSize::BYTE;
         roOffset = 2;
         break;
     case IntType::I16:
         std::memcpy(&immVal.I16, &vm->MMU.InstrBuffer[INT_OFFSET], 2);
-        intSize = UVMDataSize::WORD;
         roOffset = 3;
         break;
     case IntType::I32:
         std::memcpy(&immVal.I32, &vm->MMU.InstrBuffer[INT_OFFSET], 4);
-        intSize = UVMDataSize::DWORD;
         roOffset = 5;
         break;
     case IntType::I64:
         std::memcpy(&immVal.I64, &vm->MMU.InstrBuffer[INT_OFFSET], 8);
-        intSize = UVMDataSize::QWORD;
         roOffset = 9;
         break;
     }
@@ -594,8 +618,7 @@ uint32_t instr_copy_int_ro(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_DEST_REG_OFFSET;
     }
 
-    uint32_t writeRes = vm->MMU.write(&immVal.I64, roAddress, intSize, 0);
-    if (writeRes != UVM_SUCCESS) {
+    if (storeInt(vm->MMU, roAddress, type, immVal) != UVM_SUCCESS) {
         return E_INVALID_WRITE;
     }
 
@@ -664,22 +687,6 @@ uint32_t instr_copy_ro_ro(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_TYPE;
     }
 
-    UVMDataSize readSize = UVMDataSize::BYTE;
-    switch (intType) {
-    case IntType::I8:
-        readSize = UVMDataSize::BYTE;
-        break;
-    case IntType::I16:
-        readSize = UVMDataSize::WORD;
-        break;
-    case IntType::I32:
-        readSize = UVMDataSize::DWORD;
-        break;
-    case IntType::I64:
-        readSize = UVMDataSize::QWORD;
-        break;
-    }
-
     uint64_t srcROAddr = 0;
     uint64_t destROAddr = 0;
     if (!vm->MMU.evalRegOffset(&vm->MMU.InstrBuffer[SRC_RO_OFFSET],
@@ -692,15 +699,12 @@ uint32_t instr_copy_ro_ro(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_DEST_REG_OFFSET;
     }
 
-    uint64_t readBuff = 0;
-    uint32_t readRes = vm->MMU.read(
-        srcROAddr, reinterpret_cast<uint8_t*>(&readBuff), readSize, 0);
-    if (readRes != UVM_SUCCESS) {
+    IntVal val;
+    if (loadInt(vm->MMU, srcROAddr, intType, val) != UVM_SUCCESS) {
         return E_INVALID_READ;
     }
 
-    uint32_t writeRes = vm->MMU.write(&readBuff, destROAddr, readSize, 0);
-    if (writeRes != UVM_SUCCESS) {
+    if (storeInt(vm->MMU, destROAddr, intType, val) != UVM_SUCCESS) {
         return E_INVALID_WRITE;
     }
 
@@ -727,16 +731,13 @@ uint32_t instr_copyf_float_ro(UVM* vm, uint32_t width, uint32_t flag) {
     uint32_t roOffset = 0;
 
     FloatVal immVal;
-    UVMDataSize intSize = UVMDataSize::BYTE;
     switch (type) {
     case FloatType::F32:
         std::memcpy(&immVal.F32, &vm->MMU.InstrBuffer[FLOAT_OFFSET], 4);
-        intSize = UVMDataSize::DWORD;
         roOffset = 5;
         break;
     case FloatType::F64:
         std::memcpy(&immVal.F64, &vm->MMU.InstrBuffer[FLOAT_OFFSET], 8);
-        intSize = UVMDataSize::QWORD;
         roOffset = 9;
         break;
     }
@@ -746,8 +747,7 @@ uint32_t instr_copyf_float_ro(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_DEST_REG_OFFSET;
     }
 
-    uint32_t writeRes = vm->MMU.write(&immVal.F64, roAddress, intSize, 0);
-    if (writeRes != UVM_SUCCESS) {
+    if (storeFloat(vm->MMU, roAddress, type, immVal) != UVM_SUCCESS) {
         return E_INVALID_WRITE;
     }
 
@@ -816,16 +816,6 @@ uint32_t instr_copyf_ro_ro(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_TYPE;
     }
 
-    UVMDataSize readSize = UVMDataSize::BYTE;
-    switch (floatType) {
-    case FloatType::F32:
-        readSize = UVMDataSize::DWORD;
-        break;
-    case FloatType::F64:
-        readSize = UVMDataSize::QWORD;
-        break;
-    }
-
     uint64_t srcROAddr = 0;
     uint64_t destROAddr = 0;
     if (!vm->MMU.evalRegOffset(&vm->MMU.InstrBuffer[SRC_RO_OFFSET],
@@ -838,15 +828,15 @@ uint32_t instr_copyf_ro_ro(UVM* vm, uint32_t width, uint32_t flag) {
         return E_INVALID_DEST_REG_OFFSET;
     }
 
-    uint64_t readBuff = 0;
-    uint32_t readRes = vm->MMU.read(
-        srcROAddr, reinterpret_cast<uint8_t*>(&readBuff), readSize, 0);
-    if (readRes != UVM_SUCCESS) {
+    // Copied as raw bits so that signaling NaNs stay unchanged
+    IntVal val;
+    IntType bitsType =
+        floatType == FloatType::F32 ? IntType::I32 : IntType::I64;
+    if (loadInt(vm->MMU, srcROAddr, bitsType, val) != UVM_SUCCESS) {
         return E_INVALID_READ;
     }
 
-    uint32_t writeRes = vm->MMU.write(&readBuff, destROAddr, readSize, 0);
-    if (writeRes != UVM_SUCCESS) {
+    if (storeInt(vm->MMU, destROAddr, bitsType, val) != UVM_SUCCESS) {
         return E_INVALID_WRITE;
     }
 
@@ -14,11 +14,14 @@
 // limitations under the License.
 // ======================================================================== //
 
+#include "../clock.hpp"
 #include "../error.hpp"
 #include "instructions.hpp"
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
-#include <memory>
+#include <vector>
 
 /**
  * Performs syscall for printing to console
@@ -33,29 +36,34 @@ bool syscall_print(UVM* vm) {
     // Return values:
     // r0: uint64_t ptr to allocated mem block
 
-    IntVal r0 = vm->MMU.GP[0];
-    IntVal r1 = vm->MMU.GP[1];
+    IntVal r0;
+    r0.I64 = vm->MMU.Regs[REG_GP_START].I64;
+    IntVal r1;
+    r1.I64 = vm->MMU.Regs[REG_GP_START + 1].I64;
 
     uint32_t stringSize = r1.I32;
 
-    // Create temporary string buffer (is not \0 terminated)
-    std::unique_ptr<char[]> buff = std::make_unique<char[]>(stringSize);
-
-    uint32_t readRes = vm->MMU.readLarge(r0.I64, buff.get(), stringSize, 0);
-    if (readRes != UVM_SUCCESS) {
+    // The string (is not \0 terminated) is printed straight from guest memory,
+    // nothing is printed if any part of it is not readable
+    std::vector<MemSpan> spans;
+    if (vm->MMU.resolveRange(r0.I64, stringSize, PERM_READ_MASK, spans) !=
+        UVM_SUCCESS) {
         return false;
     }
 
     // Depending from what context the VM was started the output will either go
     // to stdout or into a console buffer which will later be sent to the debug
     // client
-    switch (vm->Mode) {
-    case ExecutionMode::USER:
-        fwrite(buff.get(), 1, stringSize, stdout);
-        break;
-    case ExecutionMode::DEBUGGER:
-        vm->DbgConsole.write(buff.get(), stringSize);
-        break;
+    for (const MemSpan& span : spans) {
+        switch (vm->Mode) {
+        case ExecutionMode::USER:
+            fwrite(span.Ptr, 1, span.Size, stdout);
+            break;
+        case ExecutionMode::DEBUGGER:
+            vm->DbgConsole.append(reinterpret_cast<const char*>(span.Ptr),
+                                  span.Size);
+            break;
+        }
     }
 
     return true;
@@ -74,11 +82,13 @@ bool syscall_console_read(UVM* vm) {
     // Return values:
     // -
 
-    IntVal strPtrPtr = vm->MMU.GP[0];
-    IntVal strSizePtr = vm->MMU.GP[1];
+    IntVal strPtrPtr;
+    strPtrPtr.I64 = vm->MMU.Regs[REG_GP_START].I64;
+    IntVal strSizePtr;
+    strSizePtr.I64 = vm->MMU.Regs[REG_GP_START + 1].I64;
 
     std::string str;
-    std::getline(std::cin, str);
+    vm->Stdin.readLine(str);
     uint32_t strSize = str.size();
 
     uint64_t strPtr = vm->MMU.allocHeap(strSize);
@@ -108,22 +118,214 @@ bool syscall_console_read(UVM* vm) {
 }
 
 /**
- * Performs syscall for memory allocation
+ * Performs syscall for reading a chunk of the standard input into a buffer
  * @param vm UVM instance
+ * @return On success returns true otherwise false
  */
-void syscall_alloc(UVM* vm) {
+bool syscall_console_read_bulk(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t destination pointer
+    // r1: uint32_t buffer size
+
+    // Return values:
+    // r0: int64_t number of bytes read, less only at the end of the input,
+    //     0 once it ended, or -1
+
+    MemManager& mmu = vm->MMU;
+    uint64_t destAddr = mmu.Regs[REG_GP_START].I64;
+    uint32_t size = mmu.Regs[REG_GP_START + 1].I32;
+
+    std::vector<MemSpan> spans;
+    if (mmu.resolveRange(destAddr, size, PERM_WRITE_MASK, spans) !=
+        UVM_SUCCESS) {
+        return false;
+    }
+
+    int64_t total = 0;
+    for (const MemSpan& span : spans) {
+        int64_t res = vm->Stdin.read(span.Ptr, span.Size, true);
+        if (res < 0) {
+            total = total > 0 ? total : -1;
+            break;
+        }
+        total += res;
+        if (static_cast<size_t>(res) < span.Size) {
+            break;
+        }
+    }
+
+    if (total > 0) {
+        mmu.logWrite(destAddr, static_cast<uint32_t>(total));
+    }
+    mmu.Regs[REG_GP_START].S64 = total;
+    return true;
+}
+
+/**
+ * Performs syscall for reading whole lines of the standard input into a
+ * buffer. Returns as soon as a line is complete. Bytes after the last
+ * returned line are kept for the next read.
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+bool syscall_console_read_lines(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t destination pointer
+    // r1: uint32_t buffer size
+    // r2: uint64_t pointer to uint32_t array receiving the line offsets
+    // r3: uint32_t maximum number of lines
+
+    // Return values:
+    // r0: int64_t number of bytes holding the lines, 0 once the input
+    //     ended, or -1
+    // r1: uint64_t number of lines, each line ends with a line feed except
+    //     for the last line of the input and a line filling the buffer
+
+    MemManager& mmu = vm->MMU;
+    uint64_t destAddr = mmu.Regs[REG_GP_START].I64;
+    uint32_t size = mmu.Regs[REG_GP_START + 1].I32;
+    uint64_t offsetsAddr = mmu.Regs[REG_GP_START + 2].I64;
+    uint32_t maxLines = mmu.Regs[REG_GP_START + 3].I32;
+
+    std::vector<MemSpan> spans;
+    std::vector<MemSpan> offsetSpans;
+    if (maxLines > UINT32_MAX / sizeof(uint32_t) ||
+        mmu.resolveRange(destAddr, size, PERM_WRITE_MASK, spans) !=
+            UVM_SUCCESS ||
+        mmu.resolveRange(offsetsAddr, maxLines * sizeof(uint32_t),
+                         PERM_WRITE_MASK, offsetSpans) != UVM_SUCCESS) {
+        return false;
+    }
+
+    // Read until a line is complete, the buffer is full or the input ends
+    uint32_t total = 0;
+    bool lineEnded = false;
+    bool inputEnded = false;
+    for (const MemSpan& span : spans) {
+        size_t filled = 0;
+        while (filled < span.Size && !lineEnded) {
+            int64_t res =
+                vm->Stdin.read(span.Ptr + filled, span.Size - filled, false);
+            if (res < 0 && total + filled == 0) {
+                mmu.Regs[REG_GP_START].S64 = -1;
+                mmu.Regs[REG_GP_START + 1].I64 = 0;
+                return true;
+            }
+            if (res <= 0) {
+                inputEnded = true;
+                break;
+            }
+            lineEnded = std::memchr(span.Ptr + filled, '\n', res) != nullptr;
+            filled += static_cast<size_t>(res);
+        }
+        total += static_cast<uint32_t>(filled);
+        if (lineEnded || inputEnded) {
+            break;
+        }
+    }
+
+    // Collect the starts of complete lines and the end of the last one
+    std::vector<uint32_t> offsets;
+    uint32_t consumed = 0;
+    uint32_t spanStart = 0;
+    for (const MemSpan& span : spans) {
+        if (spanStart >= total || offsets.size() == maxLines) {
+            break;
+        }
+        const uint8_t* cursor = span.Ptr;
+        const uint8_t* end = span.Ptr + std::min(span.Size,
+                                                 size_t{total - spanStart});
+        while (offsets.size() < maxLines) {
+            const void* lineFeed = std::memchr(cursor, '\n', end - cursor);
+            if (lineFeed == nullptr) {
+                break;
+            }
+            cursor = static_cast<const uint8_t*>(lineFeed) + 1;
+            offsets.push_back(consumed);
+            consumed = spanStart + static_cast<uint32_t>(cursor - span.Ptr);
+        }
+        spanStart += static_cast<uint32_t>(span.Size);
+    }
+
+    // An unterminated rest only counts as a line if no more bytes can follow
+    bool restIsLine = inputEnded || total == size;
+    if (consumed < total && restIsLine && offsets.size() < maxLines &&
+        (offsets.empty() || inputEnded)) {
+        offsets.push_back(consumed);
+        consumed = total;
+    }
+
+    // Give the bytes after the last line back
+    std::vector<uint8_t> rest;
+    spanStart = 0;
+    for (const MemSpan& span : spans) {
+        if (spanStart >= total) {
+            break;
+        }
+        uint32_t spanEnd = std::min(spanStart + span.Size, size_t{total});
+        if (spanEnd > consumed) {
+            uint32_t from = std::max(consumed, spanStart);
+            rest.insert(rest.end(), span.Ptr + (from - spanStart),
+                        span.Ptr + (spanEnd - spanStart));
+        }
+        spanStart += static_cast<uint32_t>(span.Size);
+    }
+    vm->Stdin.unread(rest.data(), rest.size());
+
+    size_t offsetPos = 0;
+    const uint8_t* offsetBytes = reinterpret_cast<uint8_t*>(offsets.data());
+    size_t offsetSize = offsets.size() * sizeof(uint32_t);
+    for (const MemSpan& span : offsetSpans) {
+        size_t count = std::min(span.Size, offsetSize - offsetPos);
+        std::memcpy(span.Ptr, offsetBytes + offsetPos, count);
+        offsetPos += count;
+    }
+
+    // Bytes given back were written to the buffer as well
+    if (total > 0) {
+        mmu.logWrite(destAddr, total);
+    }
+    if (offsetSize > 0) {
+        mmu.logWrite(offsetsAddr, static_cast<uint32_t>(offsetSize));
+    }
+    mmu.Regs[REG_GP_START].S64 = consumed;
+    mmu.Regs[REG_GP_START + 1].I64 = offsets.size();
+    return true;
+}
+
+/**
+ * Performs syscall for memory allocation. With a garbage collector the
+ * allocation runs a collection when one is due or the memory limits are hit.
+ * @param vm UVM instance
+ * @return On success returns UVM_SUCCESS, E_MEM_QUOTA_EXCEEDED if the hard
+ * memory limit would be exceeded
+ */
+uint32_t syscall_alloc(UVM* vm) {
     // Arguments:
     // r0: uint32_t alloc size
 
     // Return values:
-    // r0: uint64_t ptr to allocated mem block
+    // r0: uint64_t ptr to allocated mem block, UVM_NULLPTR above the soft
+    //     memory limit
 
-    IntVal allocSize = vm->MMU.GP[0];
+    IntVal allocSize;
+    allocSize.I64 = vm->MMU.Regs[REG_GP_START].I64;
 
+    HeapCollector* collector = vm->MMU.Collector;
+    if (collector != nullptr && collector->isDue()) {
+        vm->collectGarbage();
+    }
+
+    uint32_t status = UVM_SUCCESS;
     IntVal allocAddr;
-    allocAddr.I64 = vm->MMU.allocHeap(allocSize.I32);
+    allocAddr.I64 = vm->MMU.allocHeap(allocSize.I32, &status);
+    if (allocAddr.I64 == UVM_NULLPTR && collector != nullptr &&
+        vm->collectGarbage() != 0) {
+        allocAddr.I64 = vm->MMU.allocHeap(allocSize.I32, &status);
+    }
 
-    vm->MMU.GP[0] = allocAddr;
+    vm->MMU.Regs[REG_GP_START].I64 = allocAddr.I64;
+    return status;
 }
 
 /**
@@ -138,7 +340,8 @@ bool syscall_dealloc(UVM* vm) {
     // Return values:
     // -
 
-    IntVal vAddr = vm->MMU.GP[0];
+    IntVal vAddr;
+    vAddr.I64 = vm->MMU.Regs[REG_GP_START].I64;
 
     uint32_t deallocRes = vm->MMU.deallocHeap(vAddr.I64);
     if (deallocRes != UVM_SUCCESS) {
@@ -148,6 +351,209 @@ bool syscall_dealloc(UVM* vm) {
     return true;
 }
 
+/**
+ * Walks two resolved ranges of equal size in lockstep and calls fn with
+ * chunks which are contiguous in both
+ * @param lhs Spans of the first range
+ * @param rhs Spans of the second range
+ * @param fn Called with both chunk pointers and the chunk size, returns false
+ * to stop
+ */
+template <typename Fn>
+static void forEachSpanPair(const std::vector<MemSpan>& lhs,
+                            const std::vector<MemSpan>& rhs,
+                            Fn fn) {
+    size_t lhsIndex = 0;
+    size_t rhsIndex = 0;
+    size_t lhsOffset = 0;
+    size_t rhsOffset = 0;
+    while (lhsIndex < lhs.size() && rhsIndex < rhs.size()) {
+        size_t chunk = std::min(lhs[lhsIndex].Size - lhsOffset,
+                                rhs[rhsIndex].Size - rhsOffset);
+        if (!fn(lhs[lhsIndex].Ptr + lhsOffset, rhs[rhsIndex].Ptr + rhsOffset,
+                chunk)) {
+            return;
+        }
+
+        lhsOffset += chunk;
+        rhsOffset += chunk;
+        if (lhsOffset == lhs[lhsIndex].Size) {
+            lhsIndex++;
+            lhsOffset = 0;
+        }
+        if (rhsOffset == rhs[rhsIndex].Size) {
+            rhsIndex++;
+            rhsOffset = 0;
+        }
+    }
+}
+
+/**
+ * Performs syscall for copying a block of memory. Overlapping blocks are
+ * copied as if through a temporary buffer.
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+bool syscall_memcpy(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t destination address
+    // r1: uint64_t source address
+    // r2: uint32_t size
+
+    // Return values:
+    // -
+
+    uint64_t destAddr = vm->MMU.Regs[REG_GP_START].I64;
+    uint64_t srcAddr = vm->MMU.Regs[REG_GP_START + 1].I64;
+    uint32_t size = vm->MMU.Regs[REG_GP_START + 2].I32;
+
+    std::vector<MemSpan> destSpans;
+    std::vector<MemSpan> srcSpans;
+    if (vm->MMU.resolveRange(destAddr, size, PERM_WRITE_MASK, destSpans) !=
+            UVM_SUCCESS ||
+        vm->MMU.resolveRange(srcAddr, size, PERM_READ_MASK, srcSpans) !=
+            UVM_SUCCESS) {
+        return false;
+    }
+
+    bool overlaps = destAddr < srcAddr + size && srcAddr < destAddr + size;
+    if (overlaps && destSpans.size() == 1 && srcSpans.size() == 1) {
+        std::memmove(destSpans[0].Ptr, srcSpans[0].Ptr, size);
+    } else if (overlaps) {
+        std::vector<uint8_t> temp(size);
+        std::vector<MemSpan> tempSpans = {{temp.data(), temp.size()}};
+        forEachSpanPair(tempSpans, srcSpans,
+                        [](uint8_t* dest, uint8_t* src, size_t chunk) {
+                            std::memcpy(dest, src, chunk);
+                            return true;
+                        });
+        forEachSpanPair(destSpans, tempSpans,
+                        [](uint8_t* dest, uint8_t* src, size_t chunk) {
+                            std::memcpy(dest, src, chunk);
+                            return true;
+                        });
+    } else {
+        forEachSpanPair(destSpans, srcSpans,
+                        [](uint8_t* dest, uint8_t* src, size_t chunk) {
+                            std::memcpy(dest, src, chunk);
+                            return true;
+                        });
+    }
+
+    vm->MMU.logWrite(destAddr, size);
+    return true;
+}
+
+/**
+ * Performs syscall for filling a block of memory with a byte value
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+bool syscall_memset(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t destination address
+    // r1: uint8_t value
+    // r2: uint32_t size
+
+    // Return values:
+    // -
+
+    uint64_t destAddr = vm->MMU.Regs[REG_GP_START].I64;
+    uint8_t value = vm->MMU.Regs[REG_GP_START + 1].I8;
+    uint32_t size = vm->MMU.Regs[REG_GP_START + 2].I32;
+
+    std::vector<MemSpan> spans;
+    if (vm->MMU.resolveRange(destAddr, size, PERM_WRITE_MASK, spans) !=
+        UVM_SUCCESS) {
+        return false;
+    }
+
+    for (const MemSpan& span : spans) {
+        std::memset(span.Ptr, value, span.Size);
+    }
+
+    vm->MMU.logWrite(destAddr, size);
+    return true;
+}
+
+/**
+ * Performs syscall for comparing two blocks of memory
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+bool syscall_memcmp(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t first address
+    // r1: uint64_t second address
+    // r2: uint32_t size
+
+    // Return values:
+    // r0: int64_t -1, 0 or 1 like the first differing byte compares
+
+    uint64_t lhsAddr = vm->MMU.Regs[REG_GP_START].I64;
+    uint64_t rhsAddr = vm->MMU.Regs[REG_GP_START + 1].I64;
+    uint32_t size = vm->MMU.Regs[REG_GP_START + 2].I32;
+
+    std::vector<MemSpan> lhsSpans;
+    std::vector<MemSpan> rhsSpans;
+    if (vm->MMU.resolveRange(lhsAddr, size, PERM_READ_MASK, lhsSpans) !=
+            UVM_SUCCESS ||
+        vm->MMU.resolveRange(rhsAddr, size, PERM_READ_MASK, rhsSpans) !=
+            UVM_SUCCESS) {
+        return false;
+    }
+
+    int result = 0;
+    forEachSpanPair(lhsSpans, rhsSpans,
+                    [&result](uint8_t* lhs, uint8_t* rhs, size_t chunk) {
+                        result = std::memcmp(lhs, rhs, chunk);
+                        return result == 0;
+                    });
+
+    vm->MMU.Regs[REG_GP_START].S64 = (result > 0) - (result < 0);
+    return true;
+}
+
+/**
+ * Performs syscall for searching a byte value in a block of memory
+ * @param vm UVM instance
+ * @return On success returns true otherwise false
+ */
+bool syscall_memchr(UVM* vm) {
+    // Arguments:
+    // r0: uint64_t address
+    // r1: uint8_t value
+    // r2: uint32_t size
+
+    // Return values:
+    // r0: uint64_t address of the first match or UVM_NULLPTR
+
+    uint64_t vAddr = vm->MMU.Regs[REG_GP_START].I64;
+    uint8_t value = vm->MMU.Regs[REG_GP_START + 1].I8;
+    uint32_t size = vm->MMU.Regs[REG_GP_START + 2].I32;
+
+    std::vector<MemSpan> spans;
+    if (vm->MMU.resolveRange(vAddr, size, PERM_READ_MASK, spans) !=
+        UVM_SUCCESS) {
+        return false;
+    }
+
+    uint64_t found = UVM_NULLPTR;
+    uint64_t spanAddr = vAddr;
+    for (const MemSpan& span : spans) {
+        auto* match =
+            static_cast<uint8_t*>(std::memchr(span.Ptr, value, span.Size));
+        if (match != nullptr) {
+            found = spanAddr + (match - span.Ptr);
+            break;
+        }
+        spanAddr += span.Size;
+    }
+
+    vm->MMU.Regs[REG_GP_START].I64 = found;
+    return true;
+}
+
 /**
  * Performs syscall for geting the current time
  * @param vm UVM instance
@@ -165,11 +571,113 @@ bool syscall_time(UVM* vm) {
         return false;
     }
 
-    vm->MMU.GP[0].I64 = static_cast<uint64_t>(currentTime);
+    vm->MMU.Regs[REG_GP_START].I64 = static_cast<uint64_t>(currentTime);
 
     return true;
 }
 
+/**
+ * Performs syscall for querying the host memory used by the VM
+ * @param vm UVM instance
+ */
+void syscall_mem_usage(UVM* vm) {
+    // Arguments:
+    // -
+
+    // Return values:
+    // r0: uint64_t bytes counted against the memory limits
+    // r1: uint64_t heap bytes
+    // r2: uint64_t stack bytes
+    // r3: uint64_t section bytes
+    // r4: uint64_t bookkeeping bytes
+    // r5: uint64_t bytes of mapped files
+    // r6: uint64_t soft limit, 0 if unlimited
+    // r7: uint64_t hard limit, 0 if unlimited
+    // r8: uint64_t bytes of pending asynchronous requests
+
+    MemManager& mmu = vm->MMU;
+    MemUsage usage = mmu.usage();
+    mmu.Regs[REG_GP_START].I64 = usage.total();
+    mmu.Regs[REG_GP_START + 1].I64 = usage.HeapBytes;
+    mmu.Regs[REG_GP_START + 2].I64 = usage.StackBytes;
+    mmu.Regs[REG_GP_START + 3].I64 = usage.SectionBytes;
+    mmu.Regs[REG_GP_START + 4].I64 = usage.MetaBytes;
+    mmu.Regs[REG_GP_START + 5].I64 = usage.MappedBytes;
+    mmu.Regs[REG_GP_START + 6].I64 = mmu.Quota.SoftLimit;
+    mmu.Regs[REG_GP_START + 7].I64 = mmu.Quota.HardLimit;
+    mmu.Regs[REG_GP_START + 8].I64 = usage.AsyncBytes;
+}
+
+/**
+ * Performs syscall for running the garbage collector
+ * @param vm UVM instance
+ */
+void syscall_gc_collect(UVM* vm) {
+    // Arguments:
+    // -
+
+    // Return values:
+    // r0: uint64_t bytes deallocated, 0 without a garbage collector
+
+    vm->MMU.Regs[REG_GP_START].I64 = vm->collectGarbage();
+}
+
+/**
+ * Performs syscall for reading the monotonic clock
+ * @param vm UVM instance
+ */
+void syscall_time_monotonic(UVM* vm) {
+    // Arguments:
+    // -
+
+    // Return values:
+    // r0: uint64_t nanoseconds since an unspecified start
+
+    vm->MMU.Regs[REG_GP_START].I64 = getMonotonicNanos();
+}
+
+/**
+ * Performs syscall for reading the CPU time of the executing thread
+ * @param vm UVM instance
+ */
+void syscall_time_thread_cpu(UVM* vm) {
+    // Arguments:
+    // -
+
+    // Return values:
+    // r0: uint64_t nanoseconds of CPU time
+
+    vm->MMU.Regs[REG_GP_START].I64 = getThreadCpuNanos();
+}
+
+/**
+ * Performs syscall for reading the cycle counter
+ * @param vm UVM instance
+ */
+void syscall_cycles(UVM* vm) {
+    // Arguments:
+    // -
+
+    // Return values:
+    // r0: uint64_t cycles, see SYSCALL_CYCLES_FREQUENCY
+
+    vm->MMU.Regs[REG_GP_START].I64 = readCycleCounter();
+}
+
+/**
+ * Performs syscall for getting the calibrated cycle counter frequency
+ * @param vm UVM instance
+ */
+void syscall_cycles_frequency(UVM* vm) {
+    // Arguments:
+    // -
+
+    // Return values:
+    // r0: uint64_t cycles per second
+
+    vm->MMU.Regs[REG_GP_START].I64 = getCycleFrequency();
+}
+
 /**
  * Selects correct syscall and executes it
  * @param vm UVM instance
@@ -193,15 +701,76 @@ uint32_t instr_syscall(UVM* vm, uint32_t width, uint32_t flag) {
     case SYSCALL_CONSOLE_READ:
         callSuccess = syscall_console_read(vm);
         break;
-    case SYSCALL_ALLOC:
-        syscall_alloc(vm);
+    case SYSCALL_CONSOLE_READ_BULK:
+        callSuccess = syscall_console_read_bulk(vm);
+        break;
+    case SYSCALL_CONSOLE_READ_LINES:
+        callSuccess = syscall_console_read_lines(vm);
+        break;
+    case SYSCALL_FILE_OPEN:
+    case SYSCALL_FILE_READ:
+    case SYSCALL_FILE_WRITE:
+    case SYSCALL_FILE_SEEK:
+    case SYSCALL_FILE_CLOSE:
+    case SYSCALL_FILE_MAP:
+    case SYSCALL_FILE_UNMAP:
+    case SYSCALL_ASYNC_SUBMIT:
+    case SYSCALL_ASYNC_POLL:
+    case SYSCALL_ASYNC_WAIT:
+        callSuccess = syscall_file_io(vm, syscallType);
         break;
+    case SYSCALL_ALLOC: {
+        uint32_t allocStatus = syscall_alloc(vm);
+        if (allocStatus != UVM_SUCCESS) {
+            return allocStatus;
+        }
+    } break;
     case SYSCALL_DEALLOC:
         callSuccess = syscall_dealloc(vm);
         break;
+    case SYSCALL_MEMCPY:
+        callSuccess = syscall_memcpy(vm);
+        break;
+    case SYSCALL_MEMSET:
+        callSuccess = syscall_memset(vm);
+        break;
+    case SYSCALL_MEMCMP:
+        callSuccess = syscall_memcmp(vm);
+        break;
+    case SYSCALL_MEMCHR:
+        callSuccess = syscall_memchr(vm);
+        break;
+    case SYSCALL_MEM_USAGE:
+        syscall_mem_usage(vm);
+        break;
+    case SYSCALL_GC_COLLECT:
+        syscall_gc_collect(vm);
+        break;
+    case SYSCALL_VEC_DOT:
+    case SYSCALL_VEC_SUM:
+    case SYSCALL_VEC_MIN:
+    case SYSCALL_VEC_MAX:
+    case SYSCALL_VEC_AXPY:
+    case SYSCALL_VEC_EXP:
+    case SYSCALL_VEC_LOG:
+    case SYSCALL_VEC_SQRT:
+        callSuccess = syscall_vec_math(vm, syscallType);
+        break;
     case SYSCALL_TIME: {
         callSuccess = syscall_time(vm);
     } break;
+    case SYSCALL_TIME_MONOTONIC:
+        syscall_time_monotonic(vm);
+        break;
+    case SYSCALL_TIME_THREAD_CPU:
+        syscall_time_thread_cpu(vm);
+        break;
+    case SYSCALL_CYCLES:
+        syscall_cycles(vm);
+        break;
+    case SYSCALL_CYCLES_FREQUENCY:
+        syscall_cycles_frequency(vm);
+        break;
     default:
         return E_SYSCALL_UNKNOWN;
     }
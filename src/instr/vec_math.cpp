@@ -0,0 +1,478 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "../error.hpp"
+#include "instructions.hpp"
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Float reductions keep one partial result per 128 bit lane (4 for f32, 2 for
+// f64) and combine them in lane order before adding the remaining elements.
+// The SSE2 path and the scalar fallback use the same order and therefore give
+// bit identical results, as long as the compiler does not fuse multiplies and
+// adds. The build turns contraction off for this file. Integer kernels work on
+// i32 elements and reduce into 64 bit results, where the order does not matter.
+
+/** Guest array used in place or through a copy if it spans memory buffers */
+struct GuestArray {
+    /** Host spans of the array */
+    std::vector<MemSpan> Spans;
+    /** Copy of an array spanning multiple buffers */
+    std::vector<uint8_t> Copy;
+    /** Contiguous host memory of the array */
+    uint8_t* Data = nullptr;
+
+    /**
+     * Maps a guest array into contiguous host memory
+     * @param mmu Memory manager
+     * @param vAddr Virtual address of the array
+     * @param size Size of the array in bytes
+     * @param perm Required permissions
+     * @return On success returns true otherwise false
+     */
+    bool map(MemManager& mmu, uint64_t vAddr, uint32_t size, uint8_t perm) {
+        if (mmu.resolveRange(vAddr, size, perm, Spans) != UVM_SUCCESS) {
+            return false;
+        }
+        if (Spans.size() <= 1) {
+            Data = Spans.empty() ? nullptr : Spans[0].Ptr;
+            return true;
+        }
+
+        Copy.resize(size);
+        size_t offset = 0;
+        for (const MemSpan& span : Spans) {
+            std::memcpy(&Copy[offset], span.Ptr, span.Size);
+            offset += span.Size;
+        }
+        Data = Copy.data();
+        return true;
+    }
+
+    /** Writes a copy back into the spans it was taken from */
+    void commit() {
+        if (Copy.empty()) {
+            return;
+        }
+        size_t offset = 0;
+        for (const MemSpan& span : Spans) {
+            std::memcpy(span.Ptr, &Copy[offset], span.Size);
+            offset += span.Size;
+        }
+    }
+};
+
+/**
+ * Loads an element of a possibly unaligned array
+ * @param data Array
+ * @param index Element index
+ * @return Element
+ */
+template <typename T>
+static inline T loadElem(const uint8_t* data, size_t index) {
+    T val;
+    std::memcpy(&val, data + index * sizeof(T), sizeof(T));
+    return val;
+}
+
+/**
+ * Stores an element of a possibly unaligned array
+ * @param data Array
+ * @param index Element index
+ * @param val Element
+ */
+template <typename T>
+static inline void storeElem(uint8_t* data, size_t index, T val) {
+    std::memcpy(data + index * sizeof(T), &val, sizeof(T));
+}
+
+/**
+ * Applies one step of a float reduction
+ * @param acc Partial result
+ * @param x Element of the first array
+ * @param y Element of the second array, only used by the dot product
+ * @return New partial result
+ */
+template <uint8_t Kernel, typename T>
+static inline T reduceStep(T acc, T x, T y) {
+    if constexpr (Kernel == SYSCALL_VEC_DOT) {
+        T prod = x * y;
+        return acc + prod;
+    } else if constexpr (Kernel == SYSCALL_VEC_SUM) {
+        return acc + x;
+    } else if constexpr (Kernel == SYSCALL_VEC_MIN) {
+        return x < acc ? x : acc;
+    } else {
+        return x > acc ? x : acc;
+    }
+}
+
+#ifdef __SSE2__
+/** SSE2 operations on a register of float lanes */
+template <typename T> struct SimdLanes;
+
+template <> struct SimdLanes<float> {
+    using V = __m128;
+    static V load(const uint8_t* p) {
+        return _mm_loadu_ps(reinterpret_cast<const float*>(p));
+    }
+    static void store(uint8_t* p, V v) {
+        _mm_storeu_ps(reinterpret_cast<float*>(p), v);
+    }
+    static V set1(float val) { return _mm_set1_ps(val); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V min(V a, V b) { return _mm_min_ps(a, b); }
+    static V max(V a, V b) { return _mm_max_ps(a, b); }
+    static V sqrt(V a) { return _mm_sqrt_ps(a); }
+};
+
+template <> struct SimdLanes<double> {
+    using V = __m128d;
+    static V load(const uint8_t* p) {
+        return _mm_loadu_pd(reinterpret_cast<const double*>(p));
+    }
+    static void store(uint8_t* p, V v) {
+        _mm_storeu_pd(reinterpret_cast<double*>(p), v);
+    }
+    static V set1(double val) { return _mm_set1_pd(val); }
+    static V add(V a, V b) { return _mm_add_pd(a, b); }
+    static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    static V min(V a, V b) { return _mm_min_pd(a, b); }
+    static V max(V a, V b) { return _mm_max_pd(a, b); }
+    static V sqrt(V a) { return _mm_sqrt_pd(a); }
+};
+#endif
+
+/**
+ * Reduces one or two float arrays
+ * @param x First array
+ * @param y Second array, only used by the dot product
+ * @param count Number of elements, at least one for min and max
+ * @return Reduced value
+ */
+template <uint8_t Kernel, typename T>
+static T reduceFloat(const uint8_t* x, const uint8_t* y, size_t count) {
+    constexpr size_t LANES = 16 / sizeof(T);
+    constexpr bool IS_MIN_MAX =
+        Kernel == SYSCALL_VEC_MIN || Kernel == SYSCALL_VEC_MAX;
+    T init = IS_MIN_MAX ? loadElem<T>(x, 0) : T{0};
+    size_t vecCount = count - count % LANES;
+
+    T acc[LANES];
+#ifdef __SSE2__
+    using L = SimdLanes<T>;
+    typename L::V accVec = L::set1(init);
+    for (size_t i = 0; i < vecCount; i += LANES) {
+        typename L::V xVec = L::load(x + i * sizeof(T));
+        if constexpr (Kernel == SYSCALL_VEC_DOT) {
+            accVec = L::add(accVec, L::mul(xVec, L::load(y + i * sizeof(T))));
+        } else if constexpr (Kernel == SYSCALL_VEC_SUM) {
+            accVec = L::add(accVec, xVec);
+        } else if constexpr (Kernel == SYSCALL_VEC_MIN) {
+            accVec = L::min(xVec, accVec);
+        } else {
+            accVec = L::max(xVec, accVec);
+        }
+    }
+    uint8_t accBytes[16];
+    L::store(accBytes, accVec);
+    std::memcpy(acc, accBytes, sizeof(acc));
+#else
+    for (size_t lane = 0; lane < LANES; lane++) {
+        acc[lane] = init;
+    }
+    for (size_t i = 0; i < vecCount; i += LANES) {
+        for (size_t lane = 0; lane < LANES; lane++) {
+            T yElem = Kernel == SYSCALL_VEC_DOT ? loadElem<T>(y, i + lane) : 0;
+            acc[lane] = reduceStep<Kernel, T>(acc[lane],
+                                              loadElem<T>(x, i + lane), yElem);
+        }
+    }
+#endif
+
+    // Partial results are combined like the elements of the array
+    T res = init;
+    for (size_t lane = 0; lane < LANES; lane++) {
+        res = IS_MIN_MAX ? reduceStep<Kernel, T>(res, acc[lane], 0)
+                         : res + acc[lane];
+    }
+    for (size_t i = vecCount; i < count; i++) {
+        T yElem = Kernel == SYSCALL_VEC_DOT ? loadElem<T>(y, i) : 0;
+        res = reduceStep<Kernel, T>(res, loadElem<T>(x, i), yElem);
+    }
+    return res;
+}
+
+/**
+ * Reduces one or two i32 arrays
+ * @param x First array
+ * @param y Second array, only used by the dot product
+ * @param count Number of elements, at least one for min and max
+ * @return Reduced value, sums wrap around at 64 bit
+ */
+template <uint8_t Kernel>
+static int64_t reduceInt(const uint8_t* x, const uint8_t* y, size_t count) {
+    if constexpr (Kernel == SYSCALL_VEC_DOT || Kernel == SYSCALL_VEC_SUM) {
+        uint64_t res = 0;
+        for (size_t i = 0; i < count; i++) {
+            int64_t xElem = loadElem<int32_t>(x, i);
+            int64_t yElem = Kernel == SYSCALL_VEC_DOT ? loadElem<int32_t>(y, i)
+                                                      : 1;
+            res += static_cast<uint64_t>(xElem * yElem);
+        }
+        return static_cast<int64_t>(res);
+    } else {
+        int32_t res = loadElem<int32_t>(x, 0);
+        for (size_t i = 1; i < count; i++) {
+            res = reduceStep<Kernel, int32_t>(res, loadElem<int32_t>(x, i), 0);
+        }
+        return res;
+    }
+}
+
+/**
+ * Computes y = alpha * x + y
+ * @param alpha Scale of x
+ * @param x First array
+ * @param y Second array, receives the result
+ * @param count Number of elements
+ */
+template <typename T>
+static void axpy(T alpha, const uint8_t* x, uint8_t* y, size_t count) {
+    size_t i = 0;
+    if constexpr (std::is_floating_point_v<T>) {
+#ifdef __SSE2__
+        using L = SimdLanes<T>;
+        constexpr size_t LANES = 16 / sizeof(T);
+        typename L::V alphaVec = L::set1(alpha);
+        for (; i + LANES <= count; i += LANES) {
+            typename L::V prod = L::mul(alphaVec, L::load(x + i * sizeof(T)));
+            L::store(y + i * sizeof(T),
+                     L::add(prod, L::load(y + i * sizeof(T))));
+        }
+#endif
+    }
+    for (; i < count; i++) {
+        if constexpr (std::is_floating_point_v<T>) {
+            T prod = alpha * loadElem<T>(x, i);
+            storeElem<T>(y, i, prod + loadElem<T>(y, i));
+        } else {
+            uint32_t prod = static_cast<uint32_t>(alpha) *
+                            static_cast<uint32_t>(loadElem<T>(x, i));
+            storeElem<T>(y, i, static_cast<T>(prod + loadElem<T>(y, i)));
+        }
+    }
+}
+
+/**
+ * Applies exp, log or sqrt to every element of a float array
+ * @param x Source array
+ * @param y Destination array, may be the source array
+ * @param count Number of elements
+ */
+template <uint8_t Kernel, typename T>
+static void mapFloat(const uint8_t* x, uint8_t* y, size_t count) {
+    size_t i = 0;
+#ifdef __SSE2__
+    if constexpr (Kernel == SYSCALL_VEC_SQRT) {
+        using L = SimdLanes<T>;
+        constexpr size_t LANES = 16 / sizeof(T);
+        for (; i + LANES <= count; i += LANES) {
+            L::store(y + i * sizeof(T), L::sqrt(L::load(x + i * sizeof(T))));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        T elem = loadElem<T>(x, i);
+        if constexpr (Kernel == SYSCALL_VEC_EXP) {
+            elem = std::exp(elem);
+        } else if constexpr (Kernel == SYSCALL_VEC_LOG) {
+            elem = std::log(elem);
+        } else {
+            elem = std::sqrt(elem);
+        }
+        storeElem<T>(y, i, elem);
+    }
+}
+
+/**
+ * Runs a math kernel on float arrays of one type
+ * @param vm UVM instance
+ * @param kernel Syscall id of the kernel
+ * @param x First array
+ * @param y Second array, may be nullptr for sum, min and max
+ * @param count Number of elements
+ * @param type Element type
+ */
+template <typename T>
+static void runFloatKernel(UVM* vm,
+                           uint8_t kernel,
+                           const uint8_t* x,
+                           uint8_t* y,
+                           size_t count,
+                           FloatType type) {
+    FloatVal res;
+    T* resField = nullptr;
+    if constexpr (std::is_same_v<T, float>) {
+        resField = &res.F32;
+    } else {
+        resField = &res.F64;
+    }
+
+    switch (kernel) {
+    case SYSCALL_VEC_DOT:
+        *resField = reduceFloat<SYSCALL_VEC_DOT, T>(x, y, count);
+        break;
+    case SYSCALL_VEC_SUM:
+        *resField = reduceFloat<SYSCALL_VEC_SUM, T>(x, y, count);
+        break;
+    case SYSCALL_VEC_MIN:
+        *resField = reduceFloat<SYSCALL_VEC_MIN, T>(x, y, count);
+        break;
+    case SYSCALL_VEC_MAX:
+        *resField = reduceFloat<SYSCALL_VEC_MAX, T>(x, y, count);
+        break;
+    case SYSCALL_VEC_AXPY: {
+        T alpha;
+        std::memcpy(&alpha, &vm->MMU.Regs[REG_FP_START], sizeof(T));
+        axpy<T>(alpha, x, y, count);
+    }
+        return;
+    case SYSCALL_VEC_EXP:
+        mapFloat<SYSCALL_VEC_EXP, T>(x, y, count);
+        return;
+    case SYSCALL_VEC_LOG:
+        mapFloat<SYSCALL_VEC_LOG, T>(x, y, count);
+        return;
+    default:
+        mapFloat<SYSCALL_VEC_SQRT, T>(x, y, count);
+        return;
+    }
+    vm->MMU.setFloatReg(REG_FP_START, res, type);
+}
+
+/**
+ * Performs the vector math syscalls
+ * @param vm UVM instance
+ * @param kernel Syscall id, one of SYSCALL_VEC_*
+ * @return On success returns true otherwise false
+ */
+bool syscall_vec_math(UVM* vm, uint8_t kernel) {
+    // Arguments:
+    // r0: uint8_t element type, i32, f32 or f64
+    // r1: uint64_t address of x
+    // r2: uint64_t address of y (dot, axpy, exp, log, sqrt)
+    // r3: uint32_t element count, at least one for min and max
+    // r4: int32_t alpha for axpy on i32
+    // f0: alpha for axpy on f32 and f64
+
+    // Return values:
+    // r0: int64_t result of dot, sum, min or max on i32
+    // f0: result of dot, sum, min or max on f32 and f64
+    // y: result of axpy, exp, log and sqrt
+
+    MemManager& mmu = vm->MMU;
+    uint8_t type = mmu.Regs[REG_GP_START].I8;
+    uint64_t xAddr = mmu.Regs[REG_GP_START + 1].I64;
+    uint64_t yAddr = mmu.Regs[REG_GP_START + 2].I64;
+    uint32_t count = mmu.Regs[REG_GP_START + 3].I32;
+
+    uint32_t elemSize = 0;
+    switch (type) {
+    case static_cast<uint8_t>(IntType::I32):
+    case static_cast<uint8_t>(FloatType::F32):
+        elemSize = 4;
+        break;
+    case static_cast<uint8_t>(FloatType::F64):
+        elemSize = 8;
+        break;
+    default:
+        return false;
+    }
+
+    bool isInt = type == static_cast<uint8_t>(IntType::I32);
+    bool isMap = kernel == SYSCALL_VEC_EXP || kernel == SYSCALL_VEC_LOG ||
+                 kernel == SYSCALL_VEC_SQRT;
+    bool writesY = kernel == SYSCALL_VEC_AXPY || isMap;
+    bool hasY = kernel == SYSCALL_VEC_DOT || writesY;
+    bool isMinMax = kernel == SYSCALL_VEC_MIN || kernel == SYSCALL_VEC_MAX;
+    if ((isInt && isMap) || (isMinMax && count == 0) ||
+        count > UINT32_MAX / elemSize) {
+        return false;
+    }
+
+    uint32_t size = count * elemSize;
+    GuestArray x;
+    GuestArray y;
+    if (!x.map(mmu, xAddr, size, PERM_READ_MASK) ||
+        (hasY && !y.map(mmu, yAddr, size,
+                        writesY ? PERM_READ_MASK | PERM_WRITE_MASK
+                                : PERM_READ_MASK))) {
+        return false;
+    }
+
+    // Partially overlapping arrays behave as if x was read before writing y
+    const uint8_t* xData = x.Data;
+    std::vector<uint8_t> xCopy;
+    if (writesY && xAddr != yAddr && xAddr < yAddr + size &&
+        yAddr < xAddr + size) {
+        xCopy.assign(xData, xData + size);
+        xData = xCopy.data();
+    }
+
+    if (isInt) {
+        switch (kernel) {
+        case SYSCALL_VEC_DOT:
+            mmu.Regs[REG_GP_START].S64 =
+                reduceInt<SYSCALL_VEC_DOT>(xData, y.Data, count);
+            break;
+        case SYSCALL_VEC_SUM:
+            mmu.Regs[REG_GP_START].S64 =
+                reduceInt<SYSCALL_VEC_SUM>(xData, y.Data, count);
+            break;
+        case SYSCALL_VEC_MIN:
+            mmu.Regs[REG_GP_START].S64 =
+                reduceInt<SYSCALL_VEC_MIN>(xData, y.Data, count);
+            break;
+        case SYSCALL_VEC_MAX:
+            mmu.Regs[REG_GP_START].S64 =
+                reduceInt<SYSCALL_VEC_MAX>(xData, y.Data, count);
+            break;
+        default:
+            axpy<int32_t>(mmu.Regs[REG_GP_START + 4].S32, xData, y.Data,
+                          count);
+            break;
+        }
+    } else if (elemSize == 4) {
+        runFloatKernel<float>(vm, kernel, xData, y.Data, count,
+                              FloatType::F32);
+    } else {
+        runFloatKernel<double>(vm, kernel, xData, y.Data, count,
+                               FloatType::F64);
+    }
+
+    if (writesY && size != 0) {
+        y.commit();
+        mmu.logWrite(yAddr, size);
+    }
+    return true;
+}
@@ -0,0 +1,423 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "../error.hpp"
+#include "instructions.hpp"
+#include <cstring>
+#include <type_traits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
+// Vector registers are 128 bit wide which every x86-64 host supports with
+// SSE2. Lane types and operations without an SSE2 (or, if enabled at compile
+// time, SSE4.1) instruction use the scalar fallback, which yields the same
+// result: integer lanes wrap around, min, max and greater than compare
+// integer lanes as signed values, float min and max return the second operand
+// if the lanes are unordered and compares set all bits of a true lane.
+
+/**
+ * Applies a lane operation to a single pair of lanes
+ * @param lhs Lane of the first operand
+ * @param rhs Lane of the second operand
+ * @return Resulting lane
+ */
+template <VecOp Op, typename T> static inline T applyLane(T lhs, T rhs) {
+    // Bit pattern of a true compare lane
+    auto mask = [](bool cond) {
+        using Bits = std::conditional_t<sizeof(T) == 8, uint64_t,
+                                        std::conditional_t<sizeof(T) == 4,
+                                                           uint32_t, T>>;
+        Bits bits = cond ? static_cast<Bits>(~Bits{0}) : Bits{0};
+        T lane;
+        std::memcpy(&lane, &bits, sizeof(T));
+        return lane;
+    };
+
+    if constexpr (std::is_integral_v<T>) {
+        using S = std::make_signed_t<T>;
+        if constexpr (Op == VecOp::ADD) {
+            return static_cast<T>(lhs + rhs);
+        } else if constexpr (Op == VecOp::SUB) {
+            return static_cast<T>(lhs - rhs);
+        } else if constexpr (Op == VecOp::MUL) {
+            // Widen first, small lanes would be promoted to signed int
+            return static_cast<T>(static_cast<uint64_t>(lhs) * rhs);
+        } else if constexpr (Op == VecOp::MIN) {
+            return static_cast<S>(lhs) < static_cast<S>(rhs) ? lhs : rhs;
+        } else if constexpr (Op == VecOp::MAX) {
+            return static_cast<S>(lhs) > static_cast<S>(rhs) ? lhs : rhs;
+        } else if constexpr (Op == VecOp::CMPEQ) {
+            return mask(lhs == rhs);
+        } else {
+            return mask(static_cast<S>(lhs) > static_cast<S>(rhs));
+        }
+    } else {
+        if constexpr (Op == VecOp::ADD) {
+            return lhs + rhs;
+        } else if constexpr (Op == VecOp::SUB) {
+            return lhs - rhs;
+        } else if constexpr (Op == VecOp::MUL) {
+            return lhs * rhs;
+        } else if constexpr (Op == VecOp::MIN) {
+            return lhs < rhs ? lhs : rhs;
+        } else if constexpr (Op == VecOp::MAX) {
+            return lhs > rhs ? lhs : rhs;
+        } else if constexpr (Op == VecOp::CMPEQ) {
+            return mask(lhs == rhs);
+        } else {
+            return mask(lhs > rhs);
+        }
+    }
+}
+
+/**
+ * Applies a lane operation with a single SSE instruction if there is one
+ * @param lhs First operand
+ * @param dest Second operand, receives the result
+ * @return True if the operation was applied
+ */
+template <VecOp Op, typename T>
+static inline bool applySimd(const VecVal& lhs, VecVal& dest) {
+#ifdef __SSE2__
+    __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(&lhs));
+    __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(&dest));
+    __m128i res;
+    if constexpr (std::is_same_v<T, float>) {
+        __m128 x = _mm_castsi128_ps(a);
+        __m128 y = _mm_castsi128_ps(b);
+        if constexpr (Op == VecOp::ADD) {
+            res = _mm_castps_si128(_mm_add_ps(x, y));
+        } else if constexpr (Op == VecOp::SUB) {
+            res = _mm_castps_si128(_mm_sub_ps(x, y));
+        } else if constexpr (Op == VecOp::MUL) {
+            res = _mm_castps_si128(_mm_mul_ps(x, y));
+        } else if constexpr (Op == VecOp::MIN) {
+            res = _mm_castps_si128(_mm_min_ps(x, y));
+        } else if constexpr (Op == VecOp::MAX) {
+            res = _mm_castps_si128(_mm_max_ps(x, y));
+        } else if constexpr (Op == VecOp::CMPEQ) {
+            res = _mm_castps_si128(_mm_cmpeq_ps(x, y));
+        } else {
+            res = _mm_castps_si128(_mm_cmpgt_ps(x, y));
+        }
+    } else if constexpr (std::is_same_v<T, double>) {
+        __m128d x = _mm_castsi128_pd(a);
+        __m128d y = _mm_castsi128_pd(b);
+        if constexpr (Op == VecOp::ADD) {
+            res = _mm_castpd_si128(_mm_add_pd(x, y));
+        } else if constexpr (Op == VecOp::SUB) {
+            res = _mm_castpd_si128(_mm_sub_pd(x, y));
+        } else if constexpr (Op == VecOp::MUL) {
+            res = _mm_castpd_si128(_mm_mul_pd(x, y));
+        } else if constexpr (Op == VecOp::MIN) {
+            res = _mm_castpd_si128(_mm_min_pd(x, y));
+        } else if constexpr (Op == VecOp::MAX) {
+            res = _mm_castpd_si128(_mm_max_pd(x, y));
+        } else if constexpr (Op == VecOp::CMPEQ) {
+            res = _mm_castpd_si128(_mm_cmpeq_pd(x, y));
+        } else {
+            res = _mm_castpd_si128(_mm_cmpgt_pd(x, y));
+        }
+    } else if constexpr (std::is_same_v<T, uint8_t>) {
+        if constexpr (Op == VecOp::ADD) {
+            res = _mm_add_epi8(a, b);
+        } else if constexpr (Op == VecOp::SUB) {
+            res = _mm_sub_epi8(a, b);
+        } else if constexpr (Op == VecOp::CMPEQ) {
+            res = _mm_cmpeq_epi8(a, b);
+        } else if constexpr (Op == VecOp::CMPGT) {
+            res = _mm_cmpgt_epi8(a, b);
+#ifdef __SSE4_1__
+        } else if constexpr (Op == VecOp::MIN) {
+            res = _mm_min_epi8(a, b);
+        } else if constexpr (Op == VecOp::MAX) {
+            res = _mm_max_epi8(a, b);
+#endif
+        } else {
+            return false;
+        }
+    } else if constexpr (std::is_same_v<T, uint16_t>) {
+        if constexpr (Op == VecOp::ADD) {
+            res = _mm_add_epi16(a, b);
+        } else if constexpr (Op == VecOp::SUB) {
+            res = _mm_sub_epi16(a, b);
+        } else if constexpr (Op == VecOp::MUL) {
+            res = _mm_mullo_epi16(a, b);
+        } else if constexpr (Op == VecOp::MIN) {
+            res = _mm_min_epi16(a, b);
+        } else if constexpr (Op == VecOp::MAX) {
+            res = _mm_max_epi16(a, b);
+        } else if constexpr (Op == VecOp::CMPEQ) {
+            res = _mm_cmpeq_epi16(a, b);
+        } else {
+            res = _mm_cmpgt_epi16(a, b);
+        }
+    } else if constexpr (std::is_same_v<T, uint32_t>) {
+        if constexpr (Op == VecOp::ADD) {
+            res = _mm_add_epi32(a, b);
+        } else if constexpr (Op == VecOp::SUB) {
+            res = _mm_sub_epi32(a, b);
+        } else if constexpr (Op == VecOp::CMPEQ) {
+            res = _mm_cmpeq_epi32(a, b);
+        } else if constexpr (Op == VecOp::CMPGT) {
+            res = _mm_cmpgt_epi32(a, b);
+#ifdef __SSE4_1__
+        } else if constexpr (Op == VecOp::MUL) {
+            res = _mm_mullo_epi32(a, b);
+        } else if constexpr (Op == VecOp::MIN) {
+            res = _mm_min_epi32(a, b);
+        } else if constexpr (Op == VecOp::MAX) {
+            res = _mm_max_epi32(a, b);
+#endif
+        } else {
+            return false;
+        }
+    } else {
+        if constexpr (Op == VecOp::ADD) {
+            res = _mm_add_epi64(a, b);
+        } else if constexpr (Op == VecOp::SUB) {
+            res = _mm_sub_epi64(a, b);
+#ifdef __SSE4_1__
+        } else if constexpr (Op == VecOp::CMPEQ) {
+            res = _mm_cmpeq_epi64(a, b);
+#endif
+        } else {
+            return false;
+        }
+    }
+    _mm_store_si128(reinterpret_cast<__m128i*>(&dest), res);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Applies a lane operation to every lane of two vector registers
+ * @param lhs First operand
+ * @param dest Second operand, receives the result
+ */
+template <VecOp Op, typename T>
+static void applyVec(const VecVal& lhs, VecVal& dest) {
+    if (applySimd<Op, T>(lhs, dest)) {
+        return;
+    }
+
+    constexpr size_t LANES = sizeof(VecVal) / sizeof(T);
+    T a[LANES];
+    T b[LANES];
+    std::memcpy(a, &lhs, sizeof(VecVal));
+    std::memcpy(b, &dest, sizeof(VecVal));
+    for (size_t i = 0; i < LANES; i++) {
+        b[i] = applyLane<Op, T>(a[i], b[i]);
+    }
+    std::memcpy(&dest, b, sizeof(VecVal));
+}
+
+/**
+ * Selects the lane type of a vector operation
+ * @param type Lane type, an IntType or a FloatType
+ * @param lhs First operand
+ * @param dest Second operand, receives the result
+ * @return On success returns UVM_SUCCESS otherwise E_INVALID_TYPE
+ */
+template <VecOp Op>
+static uint32_t applyVecType(uint8_t type, const VecVal& lhs, VecVal& dest) {
+    switch (type) {
+    case static_cast<uint8_t>(IntType::I8):
+        applyVec<Op, uint8_t>(lhs, dest);
+        break;
+    case static_cast<uint8_t>(IntType::I16):
+        applyVec<Op, uint16_t>(lhs, dest);
+        break;
+    case static_cast<uint8_t>(IntType::I32):
+        applyVec<Op, uint32_t>(lhs, dest);
+        break;
+    case static_cast<uint8_t>(IntType::I64):
+        applyVec<Op, uint64_t>(lhs, dest);
+        break;
+    case static_cast<uint8_t>(FloatType::F32):
+        applyVec<Op, float>(lhs, dest);
+        break;
+    case static_cast<uint8_t>(FloatType::F64):
+        applyVec<Op, double>(lhs, dest);
+        break;
+    default:
+        return E_INVALID_TYPE;
+    }
+    return UVM_SUCCESS;
+}
+
+/**
+ * Loads 16 bytes from address at register offset into a vector register
+ * @param vm UVM instance
+ * @param width Instruction width
+ * @param flag Unused (pass 0)
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_INVALID_SRC_REG_OFFSET, E_INVALID_READ, E_INVALID_DEST_REG]
+ */
+uint32_t instr_vload_ro_vreg(UVM* vm, uint32_t width, uint32_t flag) {
+    // Version:
+    // vload <RO> <vR>
+
+    constexpr uint32_t RO_OFFSET = 1;
+    constexpr uint32_t VREG_OFFSET = 7;
+
+    uint64_t roAddress = 0;
+    if (!vm->MMU.evalRegOffset(&vm->MMU.InstrBuffer[RO_OFFSET], &roAddress)) {
+        return E_INVALID_SRC_REG_OFFSET;
+    }
+
+    VecVal* destReg = vm->MMU.getVecReg(vm->MMU.InstrBuffer[VREG_OFFSET]);
+    if (destReg == nullptr) {
+        return E_INVALID_DEST_REG;
+    }
+
+    VecVal readBuff;
+    uint32_t readRes =
+        vm->MMU.read(roAddress, &readBuff, UVMDataSize::XMMWORD, 0);
+    if (readRes != UVM_SUCCESS) {
+        return E_INVALID_READ;
+    }
+
+    *destReg = readBuff;
+    return UVM_SUCCESS;
+}
+
+/**
+ * Stores a vector register to address at register offset
+ * @param vm UVM instance
+ * @param width Instruction width
+ * @param flag Unused (pass 0)
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_INVALID_SRC_REG, E_INVALID_DEST_REG_OFFSET, E_INVALID_WRITE]
+ */
+uint32_t instr_vstore_vreg_ro(UVM* vm, uint32_t width, uint32_t flag) {
+    // Version:
+    // vstore <vR> <RO>
+
+    constexpr uint32_t VREG_OFFSET = 1;
+    constexpr uint32_t RO_OFFSET = 2;
+
+    VecVal* srcReg = vm->MMU.getVecReg(vm->MMU.InstrBuffer[VREG_OFFSET]);
+    if (srcReg == nullptr) {
+        return E_INVALID_SRC_REG;
+    }
+
+    uint64_t roAddress = 0;
+    if (!vm->MMU.evalRegOffset(&vm->MMU.InstrBuffer[RO_OFFSET], &roAddress)) {
+        return E_INVALID_DEST_REG_OFFSET;
+    }
+
+    uint32_t writeRes =
+        vm->MMU.write(srcReg, roAddress, UVMDataSize::XMMWORD, 0);
+    if (writeRes != UVM_SUCCESS) {
+        return E_INVALID_WRITE;
+    }
+
+    return UVM_SUCCESS;
+}
+
+/**
+ * Packed arithmetic and compares of two vector registers. The result is
+ * stored in the second register.
+ * @param vm UVM instance
+ * @param width Instruction width
+ * @param flag VecOp determines the operation
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_INVALID_TYPE, E_INVALID_SRC_REG, E_INVALID_DEST_REG]
+ */
+uint32_t instr_varithm_vtype_vreg_vreg(UVM* vm, uint32_t width, uint32_t flag) {
+    // Versions:
+    // vadd <vT> <vR1> <vR2>
+    // vsub <vT> <vR1> <vR2>
+    // vmul <vT> <vR1> <vR2>
+    // vmin <vT> <vR1> <vR2>
+    // vmax <vT> <vR1> <vR2>
+    // vcmpeq <vT> <vR1> <vR2>
+    // vcmpgt <vT> <vR1> <vR2>
+
+    constexpr uint32_t TYPE_OFFSET = 1;
+    constexpr uint32_t SRC_OFFSET = 2;
+    constexpr uint32_t DEST_OFFSET = 3;
+
+    uint8_t type = vm->MMU.InstrBuffer[TYPE_OFFSET];
+    VecVal* srcReg = vm->MMU.getVecReg(vm->MMU.InstrBuffer[SRC_OFFSET]);
+    if (srcReg == nullptr) {
+        return E_INVALID_SRC_REG;
+    }
+    VecVal* destReg = vm->MMU.getVecReg(vm->MMU.InstrBuffer[DEST_OFFSET]);
+    if (destReg == nullptr) {
+        return E_INVALID_DEST_REG;
+    }
+
+    switch (static_cast<VecOp>(flag)) {
+    case VecOp::ADD:
+        return applyVecType<VecOp::ADD>(type, *srcReg, *destReg);
+    case VecOp::SUB:
+        return applyVecType<VecOp::SUB>(type, *srcReg, *destReg);
+    case VecOp::MUL:
+        return applyVecType<VecOp::MUL>(type, *srcReg, *destReg);
+    case VecOp::MIN:
+        return applyVecType<VecOp::MIN>(type, *srcReg, *destReg);
+    case VecOp::MAX:
+        return applyVecType<VecOp::MAX>(type, *srcReg, *destReg);
+    case VecOp::CMPEQ:
+        return applyVecType<VecOp::CMPEQ>(type, *srcReg, *destReg);
+    case VecOp::CMPGT:
+        return applyVecType<VecOp::CMPGT>(type, *srcReg, *destReg);
+    }
+    return E_UNKNOWN_OP_CODE;
+}
+
+/**
+ * Shuffles the 32 bit lanes of a vector register. Bits 2i and 2i + 1 of the
+ * immediate select the source lane of destination lane i.
+ * @param vm UVM instance
+ * @param width Instruction width
+ * @param flag Unused (pass 0)
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_INVALID_SRC_REG, E_INVALID_DEST_REG]
+ */
+uint32_t instr_vshuf_vreg_int_vreg(UVM* vm, uint32_t width, uint32_t flag) {
+    // Version:
+    // vshuf <vR1> <i8> <vR2>
+
+    constexpr uint32_t SRC_OFFSET = 1;
+    constexpr uint32_t IMM_OFFSET = 2;
+    constexpr uint32_t DEST_OFFSET = 3;
+
+    VecVal* srcReg = vm->MMU.getVecReg(vm->MMU.InstrBuffer[SRC_OFFSET]);
+    if (srcReg == nullptr) {
+        return E_INVALID_SRC_REG;
+    }
+    VecVal* destReg = vm->MMU.getVecReg(vm->MMU.InstrBuffer[DEST_OFFSET]);
+    if (destReg == nullptr) {
+        return E_INVALID_DEST_REG;
+    }
+
+    // Source and destination may be the same register
+    uint8_t control = vm->MMU.InstrBuffer[IMM_OFFSET];
+    VecVal src = *srcReg;
+    for (uint32_t lane = 0; lane < 4; lane++) {
+        destReg->I32[lane] = src.I32[(control >> (2 * lane)) & 0b11];
+    }
+    return UVM_SUCCESS;
+}
@@ -0,0 +1,649 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "aot.hpp"
+#include "../error.hpp"
+#include "../instr/instructions.hpp"
+#include "../uvm.hpp"
+#include "code_cache.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <system_error>
+
+// Compiled modules are C translation units. Every instruction of a read only
+// code section gets a label. Integer loads, copies, compares, arithmetic on
+// general purpose registers and jumps to statically valid targets are
+// translated into C, every other instruction calls back into the interpreter
+// through uvm_aot_ctx.step. Jumps to an address without a label, call and ret
+// go through a dispatch switch on the instruction pointer which falls back to
+// the interpreter for unknown addresses. The instruction pointer in the
+// register file is only updated before the interpreter is entered and before
+// returning. Jumps test the zero and sign bits of the last compare kept in a
+// local, which is refreshed after every compare and at the dispatch switch.
+
+/** Prelude of every generated module */
+static const char* AOT_PRELUDE = R"(#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define UVM_EXPORT __declspec(dllexport)
+#else
+#define UVM_EXPORT
+#endif
+
+typedef union {
+    uint8_t I8;
+    uint16_t I16;
+    uint32_t I32;
+    uint64_t I64;
+    float F32;
+    double F64;
+} uvm_reg;
+
+struct uvm_aot_ctx {
+    void* vm;
+    uvm_reg* regs;
+    uint64_t* cmp_lhs;
+    uint64_t* cmp_rhs;
+    uint8_t* cmp_type;
+    uint32_t (*step)(struct uvm_aot_ctx* c);
+    uint32_t exited;
+};
+
+/* Same as FlagsRegister::evalZeroSigned() */
+static inline unsigned uvm_zero_signed(const struct uvm_aot_ctx* c) {
+    static const unsigned SHIFT[] = {56, 48, 32, 0};
+    uint64_t lhs = *c->cmp_lhs;
+    uint64_t rhs = *c->cmp_rhs;
+    uint8_t type = *c->cmp_type;
+    if (type <= 3) {
+        uint64_t diff = (lhs - rhs) << SHIFT[type];
+        return (unsigned)(diff == 0) | (unsigned)(diff >> 63) << 1;
+    }
+    if (type == 4) {
+        float l, r, res;
+        uint32_t bits;
+        memcpy(&l, &lhs, 4);
+        memcpy(&r, &rhs, 4);
+        res = l - r;
+        memcpy(&bits, &res, 4);
+        return (unsigned)(bits == 0) | (bits >> 31) << 1;
+    }
+    {
+        double l, r, res;
+        uint64_t bits;
+        memcpy(&l, &lhs, 8);
+        memcpy(&r, &rhs, 8);
+        res = l - r;
+        memcpy(&bits, &res, 8);
+        return (unsigned)(res == 0) | (unsigned)(bits >> 63) << 1;
+    }
+}
+
+)";
+
+/** Decoded instruction of a read only code section */
+struct AotInstr {
+    /** Virtual address of the instruction */
+    uint64_t VAddr = 0;
+    /** Opcode of the instruction */
+    uint8_t Opcode = 0;
+    /** Handler, width and flag of the opcode */
+    DecodedInstr Decoded;
+    /** Raw instruction bytes */
+    std::array<uint8_t, MAX_INSTR_SIZE> Bytes{};
+};
+
+/** Names of the register file fields indexed by IntType - 1 */
+static const char* INT_FIELDS[] = {"I8", "I16", "I32", "I64"};
+/** C types indexed by IntType - 1 */
+static const char* INT_CTYPES[] = {"uint8_t", "uint16_t", "uint32_t",
+                                   "uint64_t"};
+
+/**
+ * Finds the first buffer holding the given range, like the interpreter does
+ * @param mmu Memory manager
+ * @param vAddr Virtual start address
+ * @param size Size of the range
+ * @return Buffer or nullptr
+ */
+static const MemBuffer*
+findBuffer(const MemManager& mmu, uint64_t vAddr, uint64_t size) {
+    for (const MemBuffer& buff : mmu.Buffers) {
+        if (vAddr >= buff.VStartAddr &&
+            vAddr + size <= buff.VStartAddr + buff.Size) {
+            return &buff;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Decodes the instruction at the given address. Fails for addresses the
+ * interpreter cannot execute and for code which may be modified.
+ * @param mmu Memory manager
+ * @param vAddr Virtual address of the instruction
+ * @param instr Output instruction
+ * @return On success returns true otherwise false
+ */
+static bool decodeAt(const MemManager& mmu, uint64_t vAddr, AotInstr& instr) {
+    constexpr uint8_t CODE_PERM = PERM_READ_MASK | PERM_EXE_MASK;
+
+    const MemBuffer* opBuffer = findBuffer(mmu, vAddr, 1);
+    if (opBuffer == nullptr || (opBuffer->Perm & CODE_PERM) != CODE_PERM ||
+        (opBuffer->Perm & PERM_WRITE_MASK) != 0) {
+        return false;
+    }
+
+    instr.VAddr = vAddr;
+    instr.Opcode = opBuffer->Buffer[vAddr - opBuffer->VStartAddr];
+    if (instr.Opcode == OP_EXIT) {
+        return true;
+    }
+    if (UVM::decodeInstr(instr.Opcode, instr.Decoded) != UVM_SUCCESS) {
+        return false;
+    }
+
+    // The interpreter fetches the whole instruction from the first buffer
+    // holding it, which has to be the same buffer
+    const MemBuffer* buffer = findBuffer(mmu, vAddr, instr.Decoded.Width);
+    if (buffer != opBuffer) {
+        return false;
+    }
+    std::memcpy(instr.Bytes.data(), &buffer->Buffer[vAddr - buffer->VStartAddr],
+                instr.Decoded.Width);
+    return true;
+}
+
+/**
+ * Decodes every read only code buffer from its start until the first
+ * instruction which cannot be decoded
+ * @param mmu Memory manager
+ * @param code Output instructions by address
+ */
+static void sweepCode(const MemManager& mmu,
+                      std::map<uint64_t, AotInstr>& code) {
+    for (const MemBuffer& buff : mmu.Buffers) {
+        uint64_t vAddr = buff.VStartAddr;
+        uint64_t end = buff.VStartAddr + buff.Size;
+        AotInstr instr;
+        while (vAddr < end && decodeAt(mmu, vAddr, instr)) {
+            code[vAddr] = instr;
+            vAddr += instr.Decoded.Width;
+        }
+    }
+}
+
+/**
+ * Checks if a register id refers to a general purpose register
+ * @param id Register id
+ * @return True for general purpose registers
+ */
+static bool isGPReg(uint8_t id) {
+    return id >= REG_GP_START && id <= REG_GP_END;
+}
+
+/**
+ * Parses the operation and width of an <ireg> <int> arithmetic instruction
+ * @param opcode Opcode
+ * @param op Output operation
+ * @param typeIndex Output IntType - 1
+ * @return True for <ireg> <int> arithmetic instructions
+ */
+static bool
+parseArithmIregInt(uint8_t opcode, ArithmOp& op, uint32_t& typeIndex) {
+    constexpr std::pair<uint8_t, ArithmOp> FIRST_OPCODES[] = {
+        {OP_ADD_IR_I8, ArithmOp::ADD},   {OP_SUB_IR_I8, ArithmOp::SUB},
+        {OP_MUL_IR_I8, ArithmOp::MUL},   {OP_MULS_IR_I8, ArithmOp::MULS},
+        {OP_DIV_IR_I8, ArithmOp::DIV},   {OP_DIVS_IR_I8, ArithmOp::DIVS},
+    };
+    for (const auto& first : FIRST_OPCODES) {
+        if (opcode >= first.first && opcode < first.first + INT_TYPE_COUNT) {
+            op = first.second;
+            typeIndex = opcode - first.first;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Emits lhs <op> rhs truncated to the given width. Signed division is left
+ * to the interpreter.
+ * @param out Output stream
+ * @param op Arithmetic operation except DIVS
+ * @param typeIndex IntType - 1
+ * @param lhs Left operand expression
+ * @param rhs Right operand expression
+ */
+static void emitArithmExpr(std::ostream& out,
+                           ArithmOp op,
+                           uint32_t typeIndex,
+                           const std::string& lhs,
+                           const std::string& rhs) {
+    out << '(' << INT_CTYPES[typeIndex] << ")(";
+    switch (op) {
+    case ArithmOp::ADD:
+        out << lhs << " + " << rhs;
+        break;
+    case ArithmOp::SUB:
+        out << lhs << " - " << rhs;
+        break;
+    case ArithmOp::MUL:
+    case ArithmOp::MULS:
+        // The lower bits of signed and unsigned products are equal. Narrow
+        // operands are widened so that they are not promoted to int.
+        if (typeIndex < 2) {
+            out << "(uint32_t)" << lhs << " * (uint32_t)" << rhs;
+        } else {
+            out << lhs << " * " << rhs;
+        }
+        break;
+    case ArithmOp::DIV:
+    case ArithmOp::DIVS:
+        out << lhs << " / " << rhs;
+        break;
+    }
+    out << ')';
+}
+
+/**
+ * Emits the native code of an instruction if it is supported
+ * @param out Output stream
+ * @param instr Instruction
+ * @param code Every decoded instruction
+ * @param mmu Memory manager used to validate jump targets
+ * @return True if native code was emitted
+ */
+static bool emitNative(std::ostream& out,
+                       const AotInstr& instr,
+                       const std::map<uint64_t, AotInstr>& code,
+                       const MemManager& mmu) {
+    const uint8_t* bytes = instr.Bytes.data();
+    uint64_t next = instr.VAddr + instr.Decoded.Width;
+
+    if (instr.Opcode == OP_NOP) {
+        return true;
+    }
+
+    if (instr.Opcode == OP_EXIT) {
+        out << "    r[" << +REG_INSTR_PTR << "].I64 = UINT64_C(0x" << std::hex
+            << instr.VAddr << std::dec << ");\n"
+            << "    c->exited = 1;\n"
+            << "    return 0;\n";
+        return true;
+    }
+
+    // load <int> <iR>
+    if (instr.Opcode >= OP_LOAD_I8_IR && instr.Opcode <= OP_LOAD_I64_IR) {
+        uint32_t typeIndex = instr.Opcode - OP_LOAD_I8_IR;
+        uint32_t size = 1u << typeIndex;
+        uint8_t regId = bytes[size + 1];
+        if (!isGPReg(regId)) {
+            return false;
+        }
+        uint64_t imm = 0;
+        std::memcpy(&imm, &bytes[1], size);
+        out << "    r[" << +regId << "]." << INT_FIELDS[typeIndex]
+            << " = UINT64_C(0x" << std::hex << imm << std::dec << ");\n";
+        return true;
+    }
+
+    // copy <iT> <iR1> <iR2>, cmp <iT> <iR1> <iR2>, op <iT> <iR1> <iR2>
+    uint8_t type = bytes[1];
+    bool regsValid = type >= 1 && type <= INT_TYPE_COUNT &&
+                     isGPReg(bytes[2]) && isGPReg(bytes[3]);
+    uint32_t typeIndex = type - 1u;
+    if (instr.Opcode == OP_COPY_IT_IR_IR && regsValid) {
+        out << "    r[" << +bytes[3] << "]." << INT_FIELDS[typeIndex] << " = r["
+            << +bytes[2] << "]." << INT_FIELDS[typeIndex] << ";\n";
+        return true;
+    }
+    if (instr.Opcode == OP_CMP_IT_IR_IR && regsValid) {
+        out << "    *c->cmp_lhs = r[" << +bytes[2] << "].I64;\n"
+            << "    *c->cmp_rhs = r[" << +bytes[3] << "].I64;\n"
+            << "    *c->cmp_type = " << typeIndex << ";\n"
+            << "    d = (r[" << +bytes[2] << "].I64 - r[" << +bytes[3]
+            << "].I64) << " << 64 - (8u << typeIndex) << ";\n"
+            << "    zs = (unsigned)(d == 0) | (unsigned)(d >> 63) << 1;\n";
+        return true;
+    }
+    if (instr.Decoded.Handler == instr_arithm_common_ireg_ireg && regsValid) {
+        auto op = static_cast<ArithmOp>(instr.Decoded.Flag);
+        if (op == ArithmOp::DIVS) {
+            return false;
+        }
+        const char* field = INT_FIELDS[typeIndex];
+        std::string src = "r[" + std::to_string(bytes[2]) + "]." + field;
+        std::string dest = "r[" + std::to_string(bytes[3]) + "]." + field;
+        if (op == ArithmOp::DIV) {
+            out << "    if (" << dest << " == 0) {\n"
+                << "        r[" << +REG_INSTR_PTR << "].I64 = UINT64_C(0x"
+                << std::hex << next << std::dec << ");\n"
+                << "        return " << E_DIVISON_ZERO << "u;\n"
+                << "    }\n";
+        }
+        out << "    " << dest << " = ";
+        emitArithmExpr(out, op, typeIndex, src, dest);
+        out << ";\n";
+        return true;
+    }
+
+    // op <iR> <int>
+    ArithmOp op = ArithmOp::ADD;
+    if (parseArithmIregInt(instr.Opcode, op, typeIndex)) {
+        uint64_t imm = 0;
+        std::memcpy(&imm, &bytes[2], size_t{1} << typeIndex);
+        if (!isGPReg(bytes[1]) || op == ArithmOp::DIVS ||
+            (op == ArithmOp::DIV && imm == 0)) {
+            return false;
+        }
+        std::string reg =
+            "r[" + std::to_string(bytes[1]) + "]." + INT_FIELDS[typeIndex];
+        std::ostringstream immExpr;
+        immExpr << "UINT64_C(0x" << std::hex << imm << ')';
+        out << "    " << reg << " = ";
+        emitArithmExpr(out, op, typeIndex, reg,
+                       "(" + std::string(INT_CTYPES[typeIndex]) + ")" +
+                           immExpr.str());
+        out << ";\n";
+        return true;
+    }
+
+    // jmp <addr> and conditional jumps
+    if (instr.Opcode >= OP_JMP && instr.Opcode <= OP_JLE) {
+        uint64_t target = 0;
+        std::memcpy(&target, &bytes[1], sizeof(target));
+        if (mmu.checkJumpTarget(target) != UVM_SUCCESS) {
+            return false;
+        }
+
+        std::ostringstream jump;
+        if (code.count(target) != 0) {
+            jump << "goto L_" << std::hex << target << ';';
+        } else {
+            jump << "{ r[" << +REG_INSTR_PTR << "].I64 = UINT64_C(0x"
+                 << std::hex << target << "); goto dispatch; }";
+        }
+
+        auto cond = static_cast<JumpCondition>(instr.Decoded.Flag);
+        if (cond == JumpCondition::UNCONDITIONAL) {
+            out << "    " << jump.str() << '\n';
+        } else {
+            out << "    if ((" << +JUMP_TRUTH_TABLE[instr.Decoded.Flag]
+                << "u >> zs) & 1) " << jump.str() << '\n';
+        }
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Collects the addresses the dispatch switch has to know about. These are the
+ * start address, every jump and call target and every return address. Any
+ * other address reaching the switch is interpreted.
+ * @param code Every decoded instruction
+ * @param mmu Memory manager holding the start address
+ * @param entries Output dispatch addresses
+ */
+static void collectEntries(const std::map<uint64_t, AotInstr>& code,
+                           const MemManager& mmu,
+                           std::set<uint64_t>& entries) {
+    entries.insert(mmu.Regs[REG_INSTR_PTR].I64);
+    for (const auto& [vAddr, instr] : code) {
+        if ((instr.Opcode >= OP_JMP && instr.Opcode <= OP_JLE) ||
+            instr.Opcode == OP_CALL) {
+            uint64_t target = 0;
+            std::memcpy(&target, &instr.Bytes[1], sizeof(target));
+            entries.insert(target);
+        }
+        if (instr.Opcode == OP_CALL) {
+            entries.insert(vAddr + instr.Decoded.Width);
+        }
+    }
+}
+
+/**
+ * Emits the C translation unit of a module
+ * @param out Output stream
+ * @param code Every decoded instruction
+ * @param mmu Memory manager used to validate jump targets
+ * @param contentHash Content hash of the UX file
+ */
+static void emitModule(std::ostream& out,
+                       const std::map<uint64_t, AotInstr>& code,
+                       const MemManager& mmu,
+                       uint64_t contentHash) {
+    out << AOT_PRELUDE;
+    out << "UVM_EXPORT const uint32_t uvm_aot_abi = " << AOT_ABI_VERSION
+        << "u;\n"
+        << "UVM_EXPORT const uint64_t uvm_aot_hash = UINT64_C(0x" << std::hex
+        << contentHash << std::dec << ");\n\n"
+        << "UVM_EXPORT uint32_t uvm_aot_run(struct uvm_aot_ctx* c) {\n"
+        << "    uvm_reg* r = c->regs;\n"
+        << "    uint32_t st;\n"
+        << "    uint64_t d;\n"
+        << "    unsigned zs;\n"
+        << "    goto dispatch;\n\n";
+
+    for (auto it = code.begin(); it != code.end(); ++it) {
+        const AotInstr& instr = it->second;
+        uint64_t next = instr.VAddr + instr.Decoded.Width;
+        out << "L_" << std::hex << instr.VAddr << std::dec << ":\n";
+
+        bool isBranch = (instr.Opcode >= OP_JMP && instr.Opcode <= OP_JLE) ||
+                        instr.Opcode == OP_CALL || instr.Opcode == OP_RET;
+        bool fallsThrough =
+            instr.Opcode != OP_EXIT && instr.Opcode != OP_JMP;
+        if (!emitNative(out, instr, code, mmu)) {
+            out << "    r[" << +REG_INSTR_PTR << "].I64 = UINT64_C(0x"
+                << std::hex << instr.VAddr << std::dec << ");\n"
+                << "    if ((st = c->step(c)) != 0) return st;\n";
+            if (instr.Opcode == OP_CMP_IT_IR_IR ||
+                instr.Opcode == OP_CMPF_FT_FR_FR) {
+                out << "    zs = uvm_zero_signed(c);\n";
+            }
+            // Branching instructions continue at an unknown address
+            if (isBranch) {
+                out << "    goto dispatch;\n";
+                fallsThrough = false;
+            }
+        }
+
+        auto following = std::next(it);
+        if (fallsThrough &&
+            (following == code.end() || following->first != next)) {
+            out << "    r[" << +REG_INSTR_PTR << "].I64 = UINT64_C(0x"
+                << std::hex << next << std::dec << ");\n"
+                << "    goto dispatch;\n";
+        }
+    }
+
+    std::set<uint64_t> entries;
+    collectEntries(code, mmu, entries);
+    out << "\ndispatch:\n"
+        << "    zs = uvm_zero_signed(c);\n"
+        << "    switch (r[" << +REG_INSTR_PTR << "].I64) {\n";
+    for (uint64_t entry : entries) {
+        if (code.count(entry) != 0) {
+            out << "    case UINT64_C(0x" << std::hex << entry << "): goto L_"
+                << entry << ";\n"
+                << std::dec;
+        }
+    }
+    out << "    default: break;\n"
+        << "    }\n"
+        << "    if ((st = c->step(c)) != 0) return st;\n"
+        << "    if (c->exited) return 0;\n"
+        << "    goto dispatch;\n"
+        << "}\n";
+}
+
+/**
+ * Gets the path of the cached module of an UX file
+ * @param contentHash Content hash of the UX file
+ * @return On success returns the module path otherwise an empty path
+ */
+std::filesystem::path getAotCachePath(uint64_t contentHash) {
+    std::filesystem::path dir = getCacheDir();
+    if (dir.empty()) {
+        return {};
+    }
+
+    std::ostringstream name;
+    name << std::hex << contentHash << "-aot" << std::dec << AOT_ABI_VERSION
+#ifdef _WIN32
+         << ".dll";
+#else
+         << ".so";
+#endif
+    return dir / name.str();
+}
+
+/**
+ * Translates the loaded UX file into a native module. Modules are cached per
+ * content hash, an already cached module is only copied to the output path.
+ * @param vm Loaded and initialized UVM instance
+ * @param contentHash Content hash of the loaded UX file
+ * @param output Path of the module to write
+ * @return On success returns true otherwise false
+ */
+bool compileAot(UVM& vm,
+                uint64_t contentHash,
+                const std::filesystem::path& output) {
+    std::filesystem::path cached = getAotCachePath(contentHash);
+    if (cached.empty()) {
+        std::cerr << "[AOT] Could not create the cache directory\n";
+        return false;
+    }
+
+    std::error_code ec;
+    if (!std::filesystem::exists(cached, ec)) {
+        std::map<uint64_t, AotInstr> code;
+        sweepCode(vm.MMU, code);
+
+        std::filesystem::path source = getCacheTempPath(cached);
+        source.replace_extension(".c");
+        std::filesystem::path building = getCacheTempPath(cached);
+        {
+            std::ofstream sourceFile(source);
+            emitModule(sourceFile, code, vm.MMU, contentHash);
+            if (!sourceFile) {
+                std::cerr << "[AOT] Could not write '" << source.string()
+                          << "'\n";
+                return false;
+            }
+        }
+
+        bool compiled = compileNativeLibrary(source, building);
+        std::filesystem::remove(source, ec);
+        if (!compiled) {
+            std::filesystem::remove(building, ec);
+            std::cerr << "[AOT] Compilation failed\n";
+            return false;
+        }
+
+        // Concurrent compilations of the same file write the same module
+        std::filesystem::rename(building, cached, ec);
+        if (ec) {
+            std::cerr << "[AOT] Could not store '" << cached.string() << "'\n";
+            return false;
+        }
+    }
+
+    if (std::filesystem::equivalent(cached, output, ec)) {
+        return true;
+    }
+    std::filesystem::copy_file(
+        cached, output, std::filesystem::copy_options::overwrite_existing, ec);
+    if (ec) {
+        std::cerr << "[AOT] Could not write '" << output.string() << "'\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Interprets the instruction at the instruction pointer on behalf of a module
+ * @param ctx Module context
+ * @return On success returns UVM_SUCCESS otherwise error code
+ */
+static uint32_t aotStep(AotContext* ctx) {
+    uint32_t status = ctx->VM->nextInstr();
+    if (ctx->VM->Opcode == OP_EXIT) {
+        ctx->Exited = 1;
+    }
+    return status;
+}
+
+AotModule::~AotModule() {
+    if (Library != nullptr) {
+        closeNativeLibrary(Library);
+    }
+}
+
+/**
+ * Loads a module built by compileAot(). Modules built for another UX file or
+ * another ABI version are rejected.
+ * @param path Path of the module
+ * @param contentHash Content hash of the loaded UX file
+ * @return On success returns true otherwise false
+ */
+bool AotModule::load(const std::filesystem::path& path, uint64_t contentHash) {
+    void* library = openNativeLibrary(path);
+    if (library == nullptr) {
+        return false;
+    }
+
+    auto* abi = static_cast<const uint32_t*>(
+        findNativeSymbol(library, "uvm_aot_abi"));
+    auto* hash = static_cast<const uint64_t*>(
+        findNativeSymbol(library, "uvm_aot_hash"));
+    void* entry = findNativeSymbol(library, "uvm_aot_run");
+    if (abi == nullptr || hash == nullptr || entry == nullptr ||
+        *abi != AOT_ABI_VERSION || *hash != contentHash) {
+        closeNativeLibrary(library);
+        return false;
+    }
+
+    if (Library != nullptr) {
+        closeNativeLibrary(Library);
+    }
+    Library = library;
+    Entry = reinterpret_cast<uint32_t (*)(AotContext*)>(entry);
+    return true;
+}
+
+/**
+ * Runs the loaded module until execution is stopped or an error occures
+ * @param vm Initialized UVM instance of the UX file the module was built for
+ * @return On success returns UVM_SUCCESS otherwise error code
+ */
+uint32_t AotModule::run(UVM* vm) {
+    AotContext ctx;
+    ctx.VM = vm;
+    ctx.Regs = vm->MMU.Regs.data();
+    ctx.CmpLhs = &vm->MMU.Flags.CmpLhs;
+    ctx.CmpRhs = &vm->MMU.Flags.CmpRhs;
+    ctx.Type = &vm->MMU.Flags.Type;
+    ctx.Step = aotStep;
+    return Entry(&ctx);
+}
@@ -0,0 +1,78 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#pragma once
+#include "../memory.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <type_traits>
+
+class UVM;
+
+/** Version of AotContext and of the symbols exported by compiled modules */
+constexpr uint32_t AOT_ABI_VERSION = 1;
+
+/**
+ * Execution state shared with a compiled module. The layout is mirrored by
+ * struct uvm_aot_ctx in the generated C code.
+ */
+struct AotContext {
+    /** UVM instance executing the module */
+    UVM* VM = nullptr;
+    /** Register file of the UVM instance */
+    RegVal* Regs = nullptr;
+    /** Operands and type of the last compare */
+    uint64_t* CmpLhs = nullptr;
+    uint64_t* CmpRhs = nullptr;
+    CmpType* Type = nullptr;
+    /** Interprets the instruction at the instruction pointer, used for every
+     * instruction without native code */
+    uint32_t (*Step)(AotContext* ctx) = nullptr;
+    /** Set once the exit instruction has been reached */
+    uint32_t Exited = 0;
+};
+static_assert(std::is_standard_layout<AotContext>::value,
+              "AotContext is shared with C code");
+
+/** Native module built by compileAot() */
+class AotModule {
+  public:
+    AotModule() = default;
+    AotModule(const AotModule&) = delete;
+    AotModule& operator=(const AotModule&) = delete;
+    ~AotModule();
+
+    bool load(const std::filesystem::path& path, uint64_t contentHash);
+    uint32_t run(UVM* vm);
+
+  private:
+    /** Handle of the loaded shared library */
+    void* Library = nullptr;
+    /** Exported entry point uvm_aot_run */
+    uint32_t (*Entry)(AotContext* ctx) = nullptr;
+};
+
+std::filesystem::path getAotCachePath(uint64_t contentHash);
+bool compileAot(UVM& vm,
+                uint64_t contentHash,
+                const std::filesystem::path& output);
+
+// Platform specific, implemented in platform/*_native.cpp
+void* openNativeLibrary(const std::filesystem::path& path);
+void* findNativeSymbol(void* library, const char* name);
+void closeNativeLibrary(void* library);
+bool compileNativeLibrary(const std::filesystem::path& source,
+                          const std::filesystem::path& output);
@@ -0,0 +1,352 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "code_cache.hpp"
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <system_error>
+
+/** Magic bytes at the start of a cached image */
+static constexpr char IMAGE_MAGIC[4] = {'U', 'V', 'M', 'I'};
+/** Upper bound of counts read from a cached image, guards against garbage */
+static constexpr uint32_t MAX_IMAGE_COUNT = 1 << 16;
+
+/**
+ * Hashes the content of an UX file with 64 bit FNV-1a. Native modules are
+ * keyed by this hash.
+ * @param buff Pointer to file buffer
+ * @param size Size of file buffer
+ * @return Content hash
+ */
+uint64_t hashContent(const uint8_t* buff, size_t size) {
+    constexpr uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325;
+    constexpr uint64_t FNV_PRIME = 0x100000001B3;
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= buff[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/** Round constants of SHA-256 */
+static constexpr uint32_t SHA256_ROUND[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1,
+    0x923F82A4, 0xAB1C5ED5, 0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174, 0xE49B69C1, 0xEFBE4786,
+    0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147,
+    0x06CA6351, 0x14292967, 0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85, 0xA2BFE8A1, 0xA81A664B,
+    0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A,
+    0x5B9CCA4F, 0x682E6FF3, 0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2};
+
+/**
+ * Rotates a 32 bit value to the right
+ * @param val Value to rotate
+ * @param bits Number of bits, between 1 and 31
+ * @return Rotated value
+ */
+static uint32_t rotateRight(uint32_t val, uint32_t bits) {
+    return (val >> bits) | (val << (32 - bits));
+}
+
+/**
+ * Processes one 64 byte block of SHA-256
+ * @param state Hash state, updated in place
+ * @param block Block to process
+ */
+static void digestBlock(uint32_t state[8], const uint8_t* block) {
+    uint32_t w[64];
+    for (uint32_t i = 0; i < 16; i++) {
+        w[i] = static_cast<uint32_t>(block[i * 4]) << 24 |
+               static_cast<uint32_t>(block[i * 4 + 1]) << 16 |
+               static_cast<uint32_t>(block[i * 4 + 2]) << 8 |
+               static_cast<uint32_t>(block[i * 4 + 3]);
+    }
+    for (uint32_t i = 16; i < 64; i++) {
+        uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^
+                      (w[i - 15] >> 3);
+        uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^
+                      (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (uint32_t i = 0; i < 64; i++) {
+        uint32_t s1 =
+            rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + SHA256_ROUND[i] + w[i];
+        uint32_t s0 =
+            rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+/**
+ * Computes the SHA-256 digest of an UX file. Unlike hashContent() the digest
+ * is strong enough to trust a cached image without comparing the file.
+ * @param buff Pointer to file buffer
+ * @param size Size of file buffer
+ * @return Content digest
+ */
+ContentDigest digestContent(const uint8_t* buff, size_t size) {
+    uint32_t state[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+                         0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+
+    size_t offset = 0;
+    for (; size - offset >= 64; offset += 64) {
+        digestBlock(state, buff + offset);
+    }
+
+    // Padding: a single one bit, zeros and the message length in bits
+    uint8_t tail[128] = {};
+    size_t tailSize = size - offset;
+    std::memcpy(tail, buff + offset, tailSize);
+    tail[tailSize] = 0x80;
+    size_t paddedSize = tailSize < 56 ? 64 : 128;
+    uint64_t bits = static_cast<uint64_t>(size) * 8;
+    for (size_t i = 0; i < 8; i++) {
+        tail[paddedSize - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+    digestBlock(state, tail);
+    if (paddedSize == 128) {
+        digestBlock(state, tail + 64);
+    }
+
+    ContentDigest digest;
+    for (size_t i = 0; i < digest.size(); i++) {
+        digest[i] = static_cast<uint8_t>(state[i / 4] >> (24 - (i % 4) * 8));
+    }
+    return digest;
+}
+
+/**
+ * Gets the cache directory of the UVM and creates it if it does not exist yet
+ * @return On success returns the cache directory otherwise an empty path
+ */
+std::filesystem::path getCacheDir() {
+    std::filesystem::path home = getCacheHome();
+    if (home.empty()) {
+        return {};
+    }
+
+    std::filesystem::path dir = home / "uvm";
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        return {};
+    }
+    return dir;
+}
+
+/**
+ * Gets a temporary path next to a cache entry. Entries are written to a
+ * temporary path and renamed so that concurrent runs never see partial
+ * entries.
+ * @param path Path of the cache entry
+ * @return Temporary path unique to the caller
+ */
+std::filesystem::path getCacheTempPath(const std::filesystem::path& path) {
+    std::ostringstream suffix;
+    suffix << '.' << std::hex << std::random_device{}() << ".tmp";
+    std::filesystem::path temp = path;
+    temp += suffix.str();
+    return temp;
+}
+
+/**
+ * Gets the path of the cached image of an UX file
+ * @param digest Content digest of the UX file
+ * @return On success returns the image path otherwise an empty path
+ */
+static std::filesystem::path getImagePath(const ContentDigest& digest) {
+    std::filesystem::path dir = getCacheDir();
+    if (dir.empty()) {
+        return {};
+    }
+
+    std::ostringstream name;
+    name << std::hex << std::setfill('0');
+    for (size_t i = 0; i < 8; i++) {
+        name << std::setw(2) << static_cast<uint32_t>(digest[i]);
+    }
+    name << "-image" << std::dec << IMAGE_CACHE_VERSION << ".bin";
+    return dir / name.str();
+}
+
+/**
+ * Writes a trivially copyable value to a stream
+ * @param out Output stream
+ * @param val Value to write
+ */
+template <typename T> static void writeValue(std::ostream& out, const T& val) {
+    out.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+/**
+ * Reads a trivially copyable value from a stream
+ * @param in Input stream
+ * @param val Output value
+ * @return On success returns true otherwise false
+ */
+template <typename T> static bool readValue(std::istream& in, T& val) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&val), sizeof(T)));
+}
+
+/**
+ * Reads the cached image of an UX file. Only an image which was stored for the
+ * same digest and file size is returned. The image only describes the file,
+ * it is up to the caller to validate it against the loaded sections.
+ * @param digest Content digest of the UX file
+ * @param fileSize Size of the UX file
+ * @param image Output image
+ * @return On success returns true otherwise false
+ */
+bool readCachedImage(const ContentDigest& digest,
+                     uint64_t fileSize,
+                     CachedImage& image) {
+    std::filesystem::path path = getImagePath(digest);
+    std::ifstream in(path, std::ios::binary);
+    if (path.empty() || !in) {
+        return false;
+    }
+
+    char magic[sizeof(IMAGE_MAGIC)] = {};
+    ContentDigest storedDigest = {};
+    uint64_t storedSize = 0;
+    uint32_t sectionCount = 0;
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, IMAGE_MAGIC, sizeof(magic)) != 0 ||
+        !readValue(in, storedDigest) || storedDigest != digest ||
+        !readValue(in, storedSize) || storedSize != fileSize ||
+        !readValue(in, image.Version) || !readValue(in, image.Mode) ||
+        !readValue(in, image.StartAddress) || !readValue(in, sectionCount) ||
+        sectionCount > MAX_IMAGE_COUNT) {
+        return false;
+    }
+
+    image.Sections.resize(sectionCount);
+    for (CachedSection& sec : image.Sections) {
+        if (!readValue(in, sec.Type) || !readValue(in, sec.Perm) ||
+            !readValue(in, sec.VStartAddr) || !readValue(in, sec.Size)) {
+            return false;
+        }
+    }
+
+    uint32_t loopCount = 0;
+    if (!readValue(in, loopCount) || loopCount > MAX_IMAGE_COUNT) {
+        return false;
+    }
+    image.Loops.resize(loopCount);
+    for (CachedLoop& loop : image.Loops) {
+        uint32_t pathSize = 0;
+        if (!readValue(in, loop.HeadIP) || !readValue(in, pathSize) ||
+            pathSize > MAX_IMAGE_COUNT) {
+            return false;
+        }
+        loop.Path.resize(pathSize);
+        for (uint64_t& ip : loop.Path) {
+            if (!readValue(in, ip)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Writes the cached image of an UX file
+ * @param digest Content digest of the UX file
+ * @param fileSize Size of the UX file
+ * @param image Image to write
+ * @return On success returns true otherwise false
+ */
+bool writeCachedImage(const ContentDigest& digest,
+                      uint64_t fileSize,
+                      const CachedImage& image) {
+    std::filesystem::path path = getImagePath(digest);
+    if (path.empty()) {
+        return false;
+    }
+
+    std::filesystem::path writing = getCacheTempPath(path);
+    bool written = false;
+    {
+        std::ofstream out(writing, std::ios::binary);
+        out.write(IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+        writeValue(out, digest);
+        writeValue(out, fileSize);
+        writeValue(out, image.Version);
+        writeValue(out, image.Mode);
+        writeValue(out, image.StartAddress);
+        writeValue(out, static_cast<uint32_t>(image.Sections.size()));
+        for (const CachedSection& sec : image.Sections) {
+            writeValue(out, sec.Type);
+            writeValue(out, sec.Perm);
+            writeValue(out, sec.VStartAddr);
+            writeValue(out, sec.Size);
+        }
+        writeValue(out, static_cast<uint32_t>(image.Loops.size()));
+        for (const CachedLoop& loop : image.Loops) {
+            writeValue(out, loop.HeadIP);
+            writeValue(out, static_cast<uint32_t>(loop.Path.size()));
+            for (uint64_t ip : loop.Path) {
+                writeValue(out, ip);
+            }
+        }
+        out.close();
+        written = static_cast<bool>(out);
+    }
+
+    std::error_code ec;
+    if (!written) {
+        std::filesystem::remove(writing, ec);
+        return false;
+    }
+    std::filesystem::rename(writing, path, ec);
+    if (ec) {
+        std::filesystem::remove(writing, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+/** Version of the cached image format, part of the file name */
+constexpr uint32_t IMAGE_CACHE_VERSION = 2;
+
+/** SHA-256 digest of an UX file, cache entries are keyed by it */
+using ContentDigest = std::array<uint8_t, 32>;
+
+/** Validated section table entry */
+struct CachedSection {
+    /** Section type */
+    uint8_t Type = 0;
+    /** Section permissions */
+    uint8_t Perm = 0;
+    /** Virtual start address of section */
+    uint64_t VStartAddr = 0;
+    /** Size of section in bytes */
+    uint32_t Size = 0;
+};
+
+/** Recorded path of a hot loop */
+struct CachedLoop {
+    /** Virtual address of the loop head */
+    uint64_t HeadIP = 0;
+    /** Instruction pointer after every instruction of one iteration */
+    std::vector<uint64_t> Path;
+};
+
+/** Load-time results and recorded loops of an UX file */
+struct CachedImage {
+    /** Header version */
+    uint8_t Version = 0;
+    /** Header mode */
+    uint8_t Mode = 0;
+    /** Validated start address */
+    uint64_t StartAddress = 0;
+    /** Validated section table */
+    std::vector<CachedSection> Sections;
+    /** Recorded loops */
+    std::vector<CachedLoop> Loops;
+};
+
+uint64_t hashContent(const uint8_t* buff, size_t size);
+std::filesystem::path getCacheDir();
+std::filesystem::path getCacheTempPath(const std::filesystem::path& path);
+ContentDigest digestContent(const uint8_t* buff, size_t size);
+bool readCachedImage(const ContentDigest& digest,
+                     uint64_t fileSize,
+                     CachedImage& image);
+bool writeCachedImage(const ContentDigest& digest,
+                      uint64_t fileSize,
+                      const CachedImage& image);
+
+// Platform specific, implemented in platform/*_native.cpp
+std::filesystem::path getCacheHome();
@@ -0,0 +1,195 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "loop_trace.hpp"
+#include "../error.hpp"
+#include "../instr/instructions.hpp"
+#include "../uvm.hpp"
+#include "peephole.hpp"
+#include <cstring>
+
+/**
+ * Called after a taken backward jump. Executes the trace of the loop if one
+ * exists, otherwise counts the back edge and records the loop once it is hot.
+ * @param vm UVM instance
+ * @param headIP Jump target, the head of the loop
+ * @return On success returns UVM_SUCCESS otherwise error code
+ */
+uint32_t LoopTraceCache::onBackEdge(UVM* vm, uint64_t headIP) {
+    LoopInfo& loop = Loops[headIP];
+    if (!loop.Trace.Entries.empty()) {
+        return execute(vm, loop.Trace);
+    }
+
+    if (loop.Blacklisted || ++loop.BackEdges < HOT_LOOP_THRESHOLD) {
+        return UVM_SUCCESS;
+    }
+
+    return record(vm, loop, headIP);
+}
+
+/**
+ * Interprets one iteration of the loop and records every executed instruction.
+ * Recording succeeds once execution returns to the loop head.
+ * @param vm UVM instance
+ * @param loop Loop to record
+ * @param headIP Head of the loop, equal to the current instruction pointer
+ * @return On success returns UVM_SUCCESS otherwise error code
+ */
+uint32_t LoopTraceCache::record(UVM* vm, LoopInfo& loop, uint64_t headIP) {
+    MemManager& mmu = vm->MMU;
+    LoopTrace trace;
+    trace.HeadIP = headIP;
+
+    // Count the attempt as failed unless the loop is recorded completely. An
+    // iteration may leave the loop on a path which is rarely taken, so the
+    // loop has to get hot again before the next attempt.
+    loop.BackEdges = 0;
+    loop.RecordFailures++;
+    loop.Blacklisted = loop.RecordFailures >= MAX_LOOP_RECORD_FAILURES;
+
+    while (trace.Entries.size() < MAX_LOOP_TRACE_SIZE) {
+        uint64_t ip = mmu.Regs[REG_INSTR_PTR].I64;
+
+        // Code which may be modified cannot be recorded
+        if (ip >= mmu.SectionPerms.size() ||
+            (mmu.SectionPerms[ip] & PERM_WRITE_MASK) != 0) {
+            loop.Blacklisted = true;
+            return UVM_SUCCESS;
+        }
+
+        uint32_t status = vm->nextInstr();
+        if (status != UVM_SUCCESS || vm->Opcode == OP_EXIT) {
+            return status;
+        }
+
+        DecodedInstr instr;
+        UVM::decodeInstr(vm->Opcode, instr);
+
+        TraceEntry entry;
+        entry.Handler = instr.Handler;
+        entry.Flag = instr.Flag;
+        entry.Width = instr.Width;
+        entry.Advance = instr.Width;
+        entry.FailAdvance = instr.Width;
+        entry.Opcode = vm->Opcode;
+        entry.NextIP = mmu.Regs[REG_INSTR_PTR].I64;
+        entry.Bytes = mmu.InstrBuffer;
+        trace.Entries.push_back(entry);
+        trace.Path.push_back(entry.NextIP);
+
+        if (mmu.Regs[REG_INSTR_PTR].I64 == headIP) {
+            optimizeTrace(trace);
+            loop.Trace = std::move(trace);
+            loop.RecordFailures = 0;
+            loop.Blacklisted = false;
+            return UVM_SUCCESS;
+        }
+    }
+
+    return UVM_SUCCESS;
+}
+
+/**
+ * Rebuilds the trace of a loop from a previously recorded path without
+ * executing it. Every instruction on the path is decoded from the code, which
+ * has to be executable and not writable just like during recording.
+ * @param vm UVM instance with loaded sections
+ * @param headIP Head of the loop
+ * @param path Instruction pointer after every instruction of one iteration
+ * @return On success returns true otherwise false
+ */
+bool LoopTraceCache::restore(UVM* vm,
+                             uint64_t headIP,
+                             const std::vector<uint64_t>& path) {
+    MemManager& mmu = vm->MMU;
+    if (path.empty() || path.size() > MAX_LOOP_TRACE_SIZE ||
+        path.back() != headIP) {
+        return false;
+    }
+
+    LoopTrace trace;
+    trace.HeadIP = headIP;
+    trace.Path = path;
+    uint64_t ip = headIP;
+    for (uint64_t nextIP : path) {
+        if (ip >= mmu.SectionPerms.size() ||
+            (mmu.SectionPerms[ip] & PERM_WRITE_MASK) != 0) {
+            return false;
+        }
+
+        TraceEntry entry;
+        DecodedInstr instr;
+        if (mmu.fetchInstruction(ip, &entry.Opcode, 1) != UVM_SUCCESS ||
+            entry.Opcode == OP_EXIT ||
+            UVM::decodeInstr(entry.Opcode, instr) != UVM_SUCCESS ||
+            mmu.fetchInstruction(ip, entry.Bytes.data(), instr.Width) !=
+                UVM_SUCCESS) {
+            return false;
+        }
+
+        entry.Handler = instr.Handler;
+        entry.Flag = instr.Flag;
+        entry.Width = instr.Width;
+        entry.Advance = instr.Width;
+        entry.FailAdvance = instr.Width;
+        entry.NextIP = nextIP;
+        trace.Entries.push_back(entry);
+        ip = nextIP;
+    }
+
+    optimizeTrace(trace);
+    LoopInfo& loop = Loops[headIP];
+    loop.Trace = std::move(trace);
+    loop.Blacklisted = false;
+    return true;
+}
+
+/**
+ * Replays a loop trace until execution leaves the recorded path
+ * @param vm UVM instance
+ * @param trace Trace starting at the current instruction pointer
+ * @return On success returns UVM_SUCCESS otherwise error code
+ */
+uint32_t LoopTraceCache::execute(UVM* vm, const LoopTrace& trace) {
+    MemManager& mmu = vm->MMU;
+    uint64_t& ip = mmu.Regs[REG_INSTR_PTR].I64;
+    while (true) {
+        for (const TraceEntry& entry : trace.Entries) {
+            std::memcpy(mmu.InstrBuffer.data(), entry.Bytes.data(),
+                        MAX_INSTR_SIZE);
+            vm->Opcode = entry.Opcode;
+
+            uint32_t status = UVM_SUCCESS;
+            if (entry.Handler != nullptr) {
+                status = entry.Handler(vm, entry.Width, entry.Flag);
+            }
+
+            if (status != UVM_SUCCESS_JUMPED) {
+                if (status != UVM_SUCCESS) {
+                    ip += entry.FailAdvance;
+                    return status;
+                }
+                ip += entry.Advance;
+            }
+
+            // Guard: leave the trace once execution diverges from it
+            if (ip != entry.NextIP) {
+                return UVM_SUCCESS;
+            }
+        }
+    }
+}
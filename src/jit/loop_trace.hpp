@@ -0,0 +1,87 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#pragma once
+#include "../memory.hpp"
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class UVM;
+
+/** Number of taken back edges after which a loop gets recorded */
+constexpr uint32_t HOT_LOOP_THRESHOLD = 64;
+/** Longest trace which gets recorded, longer loops stay interpreted */
+constexpr size_t MAX_LOOP_TRACE_SIZE = 256;
+/** Failed recordings after which a loop stays interpreted. Every failure
+ * waits for another HOT_LOOP_THRESHOLD back edges. */
+constexpr uint32_t MAX_LOOP_RECORD_FAILURES = 4;
+
+/** Pre-decoded instruction of a loop trace */
+struct TraceEntry {
+    /** Instruction handler, nullptr for nop */
+    uint32_t (*Handler)(UVM* vm, uint32_t width, uint32_t flag) = nullptr;
+    /** Flag passed to the handler */
+    uint32_t Flag = 0;
+    /** Instruction width passed to the handler */
+    uint32_t Width = 1;
+    /** Added to the instruction pointer unless the handler jumped */
+    uint32_t Advance = 1;
+    /** Added to the instruction pointer instead of Advance if the handler
+     * failed, lets fused entries report the failing instruction */
+    uint32_t FailAdvance = 1;
+    /** Opcode of the instruction */
+    uint8_t Opcode = 0;
+    /** Instruction pointer the recorded path continued at. Leaving the trace
+     * whenever execution differs from it is the only guard needed. */
+    uint64_t NextIP = 0;
+    /** Raw instruction bytes copied into the instruction buffer */
+    std::array<uint8_t, MAX_INSTR_SIZE> Bytes{};
+};
+
+/** Straight-line trace of one iteration of a loop */
+struct LoopTrace {
+    /** Virtual address of the loop head */
+    uint64_t HeadIP = 0;
+    /** Instructions of one iteration starting at the loop head */
+    std::vector<TraceEntry> Entries;
+    /** Instruction pointer after every recorded instruction, enough to
+     * record the trace again from the code */
+    std::vector<uint64_t> Path;
+};
+
+/** Back edge statistics and trace of a loop head */
+struct LoopInfo {
+    /** Number of taken back edges to the loop head */
+    uint32_t BackEdges = 0;
+    /** Number of failed recordings since the last successful one */
+    uint32_t RecordFailures = 0;
+    /** Recording failed too often or cannot succeed, never try again */
+    bool Blacklisted = false;
+    /** Recorded trace, empty until the loop got hot */
+    LoopTrace Trace;
+};
+
+struct LoopTraceCache {
+    /** Loop information per loop head */
+    std::unordered_map<uint64_t, LoopInfo> Loops;
+
+    uint32_t onBackEdge(UVM* vm, uint64_t headIP);
+    uint32_t record(UVM* vm, LoopInfo& loop, uint64_t headIP);
+    uint32_t execute(UVM* vm, const LoopTrace& trace);
+    bool restore(UVM* vm, uint64_t headIP, const std::vector<uint64_t>& path);
+};
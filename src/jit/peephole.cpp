@@ -0,0 +1,248 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "peephole.hpp"
+#include "../instr/instructions.hpp"
+#include "../uvm.hpp"
+#include <cstring>
+#include <utility>
+
+// Every rewrite only applies to operands which cannot make the original
+// instructions fail, or keeps the failing part and its error code. Fused
+// entries set FailAdvance so that a failure leaves the instruction pointer
+// where the unfused instructions would have left it.
+
+/**
+ * Builds the fused load and arithmetic handlers of all integer widths for a
+ * single operation
+ * @return Handlers indexed by IntType - 1
+ */
+template <ArithmOp Op, size_t... TypeIndex>
+static constexpr std::array<InstrHandler, INT_TYPE_COUNT>
+makeLoadArithmRow(std::index_sequence<TypeIndex...>) {
+    return {{instr_load_arithm_ireg_ireg<
+        Op, static_cast<IntType>(TypeIndex + 1)>...}};
+}
+
+/**
+ * Builds the fused load and arithmetic handlers of all operations
+ * @return Handlers indexed by ArithmOp and IntType - 1
+ */
+template <size_t... OpIndex>
+static constexpr std::array<std::array<InstrHandler, INT_TYPE_COUNT>,
+                            ARITHM_OP_COUNT>
+makeLoadArithmTable(std::index_sequence<OpIndex...>) {
+    return {{makeLoadArithmRow<static_cast<ArithmOp>(OpIndex)>(
+        std::make_index_sequence<INT_TYPE_COUNT>())...}};
+}
+
+static constexpr auto LOAD_ARITHM_HANDLERS =
+    makeLoadArithmTable(std::make_index_sequence<ARITHM_OP_COUNT>());
+
+static constexpr std::array<InstrHandler, INT_TYPE_COUNT> LSH_HANDLERS = {
+    instr_lsh_ireg_int<IntType::I8>, instr_lsh_ireg_int<IntType::I16>,
+    instr_lsh_ireg_int<IntType::I32>, instr_lsh_ireg_int<IntType::I64>};
+
+/**
+ * Checks if a register id refers to a general purpose register, writing to it
+ * cannot fail
+ * @param id Register id
+ * @return True for general purpose registers
+ */
+static bool isGPReg(uint8_t id) {
+    return id >= REG_GP_START && id <= REG_GP_END;
+}
+
+/**
+ * Checks if an integer register type byte is valid
+ * @param type Type byte
+ * @return True for valid IntType values
+ */
+static bool isIntType(uint8_t type) {
+    return type >= static_cast<uint8_t>(IntType::I8) &&
+           type <= static_cast<uint8_t>(IntType::I64);
+}
+
+/**
+ * Checks if the instruction may continue anywhere else than after itself
+ * @param opcode Opcode of the instruction
+ * @return True for jumps, call and ret
+ */
+static bool isBranch(uint8_t opcode) {
+    return (opcode >= OP_JMP && opcode <= OP_JLE) || opcode == OP_CALL ||
+           opcode == OP_RET;
+}
+
+/**
+ * Rewrites a single entry. Copies of a general purpose register to itself
+ * become nops and multiplications by a power of two become shifts.
+ * @param entry Entry to rewrite
+ */
+static void rewriteEntry(TraceEntry& entry) {
+    switch (entry.Opcode) {
+    case OP_COPY_IT_IR_IR: {
+        // copy <iT> <iR1> <iR2>
+        uint8_t type = entry.Bytes[1];
+        uint8_t srcRegId = entry.Bytes[2];
+        uint8_t destRegId = entry.Bytes[3];
+        if (isIntType(type) && srcRegId == destRegId && isGPReg(srcRegId)) {
+            entry.Handler = nullptr;
+        }
+    } break;
+    case OP_MUL_IR_I8:
+    case OP_MUL_IR_I16:
+    case OP_MUL_IR_I32:
+    case OP_MUL_IR_I64:
+    case OP_MULS_IR_I8:
+    case OP_MULS_IR_I16:
+    case OP_MULS_IR_I32:
+    case OP_MULS_IR_I64: {
+        // mul <iR> <int>, the lower bits of a signed and an unsigned product
+        // are the same
+        uint32_t typeIndex = entry.Opcode <= OP_MUL_IR_I64
+                                 ? entry.Opcode - OP_MUL_IR_I8
+                                 : entry.Opcode - OP_MULS_IR_I8;
+        uint64_t multiplier = 0;
+        std::memcpy(&multiplier, &entry.Bytes[2], size_t{1} << typeIndex);
+        if (!isGPReg(entry.Bytes[1]) || multiplier == 0 ||
+            (multiplier & (multiplier - 1)) != 0) {
+            break;
+        }
+
+        uint32_t shift = 0;
+        while ((multiplier >>= 1) != 0) {
+            shift++;
+        }
+        entry.Handler = LSH_HANDLERS[typeIndex];
+        entry.Flag = shift;
+    } break;
+    }
+}
+
+/**
+ * Fuses load <int> <iR1> followed by an arithmetic instruction with arguments
+ * <iT> <iR1> <iR2>. The loaded bytes have to cover iT.
+ * @param load Load entry
+ * @param arithm Following entry
+ * @param fused Output fused entry
+ * @return True if the entries were fused
+ */
+static bool
+fuseLoadArithm(const TraceEntry& load, const TraceEntry& arithm,
+               TraceEntry& fused) {
+    if (load.Opcode < OP_LOAD_I8_IR || load.Opcode > OP_LOAD_I64_IR ||
+        arithm.Handler != instr_arithm_common_ireg_ireg) {
+        return false;
+    }
+
+    // load <int> <iR>
+    uint32_t loadSize = 1u << (load.Opcode - OP_LOAD_I8_IR);
+    uint8_t loadRegId = load.Bytes[loadSize + 1];
+
+    // op <iT> <iR1> <iR2>
+    uint8_t type = arithm.Bytes[1];
+    if (!isIntType(type) || (1u << (type - 1)) > loadSize ||
+        arithm.Bytes[2] != loadRegId || !isGPReg(loadRegId) ||
+        !isGPReg(arithm.Bytes[3])) {
+        return false;
+    }
+
+    uint64_t imm = 0;
+    std::memcpy(&imm, &load.Bytes[1], loadSize);
+
+    fused = arithm;
+    fused.Handler = LOAD_ARITHM_HANDLERS[arithm.Flag][type - 1];
+    fused.Flag = loadSize;
+    fused.Advance = load.Advance + arithm.Advance;
+    fused.FailAdvance = load.Advance + arithm.FailAdvance;
+    std::memcpy(&fused.Bytes[4], &imm, sizeof(imm));
+    return true;
+}
+
+/**
+ * Fuses push <iT> <iR1> followed by pop <iT> <iR2> into a register copy which
+ * still writes the pushed value to the stack
+ * @param push Push entry
+ * @param pop Following entry
+ * @param fused Output fused entry
+ * @return True if the entries were fused
+ */
+static bool
+fusePushPop(const TraceEntry& push, const TraceEntry& pop, TraceEntry& fused) {
+    if (push.Opcode != OP_PUSH_IT_IR || pop.Opcode != OP_POP_IT_IR) {
+        return false;
+    }
+
+    // push <iT> <iR1>, pop <iT> <iR2>
+    uint8_t type = push.Bytes[1];
+    uint8_t srcRegId = push.Bytes[2];
+    uint8_t destRegId = pop.Bytes[2];
+    bool srcReadable = isGPReg(srcRegId) || (srcRegId >= REG_INSTR_PTR &&
+                                             srcRegId <= REG_BASE_PTR);
+    if (!isIntType(type) || pop.Bytes[1] != type || !srcReadable ||
+        !isGPReg(destRegId)) {
+        return false;
+    }
+
+    fused = push;
+    fused.Handler = instr_push_pop_ireg;
+    fused.Flag = 1u << (type - 1);
+    fused.Opcode = pop.Opcode;
+    fused.NextIP = pop.NextIP;
+    fused.Advance = push.Advance + pop.Advance;
+    fused.FailAdvance = push.FailAdvance;
+    fused.Bytes[3] = destRegId;
+    return true;
+}
+
+/**
+ * Optimizes a recorded loop trace. Rewrites single instructions, fuses
+ * instruction pairs and folds nops into the entry before them.
+ * @param trace Recorded trace
+ */
+void optimizeTrace(LoopTrace& trace) {
+    std::vector<TraceEntry>& entries = trace.Entries;
+    for (TraceEntry& entry : entries) {
+        rewriteEntry(entry);
+    }
+
+    std::vector<TraceEntry> fusedEntries;
+    fusedEntries.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        TraceEntry fused;
+        if (i + 1 < entries.size() &&
+            (fuseLoadArithm(entries[i], entries[i + 1], fused) ||
+             fusePushPop(entries[i], entries[i + 1], fused))) {
+            fusedEntries.push_back(fused);
+            i++;
+        } else {
+            fusedEntries.push_back(entries[i]);
+        }
+    }
+
+    // Nops only advance the instruction pointer, which the entry before them
+    // can do as well unless it may branch
+    entries.clear();
+    for (const TraceEntry& entry : fusedEntries) {
+        if (entry.Handler == nullptr && !entries.empty() &&
+            !isBranch(entries.back().Opcode)) {
+            entries.back().Advance += entry.Advance;
+            entries.back().NextIP = entry.NextIP;
+        } else {
+            entries.push_back(entry);
+        }
+    }
+}
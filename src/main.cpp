@@ -15,16 +15,87 @@
 // ======================================================================== //
 
 #include "debug/debugger.hpp"
+#include "debug/tracer.hpp"
 #include "error.hpp"
+#include "jit/aot.hpp"
 #include "uvm.hpp"
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <thread>
 
 void printCLIUsage() {
-    std::cout
-        << "usage: uvm <source file> [--debug-server]\n";
+    std::cout << "usage: uvm <source file> [--trace <trace file>] "
+                 "[--native <module>] [--native-cached]\n"
+                 "           [--heap-profile <report file>] "
+                 "[--image-cache]\n"
+                 "           [--mem-soft-limit <bytes>] "
+                 "[--mem-hard-limit <bytes>] [--gc]\n"
+                 "       uvm --aot <source file> -o <module>\n"
+                 "       uvm --debug-server\n";
+}
+
+/**
+ * Parses a byte count with an optional K, M or G suffix
+ * @param str Byte count
+ * @param bytes [out] Parsed byte count
+ * @return On success returns true otherwise false
+ */
+static bool parseByteCount(const char* str, uint64_t* bytes) {
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = std::strtoull(str, &end, 10);
+    if (end == str || errno != 0 || str[0] == '-') {
+        return false;
+    }
+
+    uint32_t shift = 0;
+    if (*end == 'K' || *end == 'k') {
+        shift = 10;
+    } else if (*end == 'M' || *end == 'm') {
+        shift = 20;
+    } else if (*end == 'G' || *end == 'g') {
+        shift = 30;
+    }
+    if (shift != 0) {
+        end++;
+    }
+    if (*end != '\0' || value > (UINT64_MAX >> shift)) {
+        return false;
+    }
+
+    *bytes = static_cast<uint64_t>(value) << shift;
+    return true;
+}
+
+/**
+ * Runs the UVM instance and writes the execution trace into a file. The trace
+ * is written on its own thread while the UVM executes.
+ * @param vm Initialized UVM instance
+ * @param traceFile Opened trace file
+ * @return On success returns UVM_SUCCESS otherwise error code
+ */
+static uint32_t runWithTrace(UVM& vm, std::ofstream& traceFile) {
+    traceFile.write(reinterpret_cast<const char*>(&TRACE_FILE_MAGIC), 8);
+    traceFile.put(static_cast<char>(TRACE_VERSION));
+
+    auto tracer = std::make_unique<Tracer>();
+    std::thread writer([&]() {
+        tracer->drain([&](const uint8_t* data, size_t size) {
+            traceFile.write(reinterpret_cast<const char*>(data), size);
+            return traceFile.good();
+        });
+    });
+
+    uint32_t status = vm.runTraced(*tracer);
+    tracer->close();
+    writer.join();
+
+    return status;
 }
 
 int main(int argc, char* argv[]) {
@@ -41,8 +112,60 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
-    // Check if target UX file exists
+    // Ahead of time compilation into a native module
+    bool compileOnly = strcmp(argv[1], "--aot") == 0;
     char* sourcePath = argv[1];
+    const char* outputPath = nullptr;
+    if (compileOnly) {
+        if (argc != 5 || strcmp(argv[3], "-o") != 0) {
+            printCLIUsage();
+            return -1;
+        }
+        sourcePath = argv[2];
+        outputPath = argv[4];
+    }
+
+    // Optional trace file, native module, heap profile report, memory limits,
+    // garbage collection and image cache
+    const char* tracePath = nullptr;
+    const char* nativePath = nullptr;
+    const char* heapProfilePath = nullptr;
+    MemQuota quota;
+    bool garbageCollect = false;
+    bool nativeCached = false;
+    bool imageCache = false;
+    for (int i = 2; !compileOnly && i < argc; i++) {
+        if (strcmp(argv[i], "--gc") == 0) {
+            garbageCollect = true;
+        } else if (strcmp(argv[i], "--native-cached") == 0) {
+            nativeCached = true;
+        } else if (strcmp(argv[i], "--image-cache") == 0) {
+            imageCache = true;
+        } else if (i + 1 < argc && strcmp(argv[i], "--trace") == 0) {
+            tracePath = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--native") == 0) {
+            nativePath = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--heap-profile") == 0) {
+            heapProfilePath = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--mem-soft-limit") == 0) {
+            if (!parseByteCount(argv[++i], &quota.SoftLimit)) {
+                printCLIUsage();
+                return -1;
+            }
+        } else if (i + 1 < argc && strcmp(argv[i], "--mem-hard-limit") == 0) {
+            // Heap profile and garbage collector bookkeeping is not counted
+            // against the limits, see MemQuota
+            if (!parseByteCount(argv[++i], &quota.HardLimit)) {
+                printCLIUsage();
+                return -1;
+            }
+        } else {
+            printCLIUsage();
+            return -1;
+        }
+    }
+
+    // Check if target UX file exists
     std::filesystem::path p{sourcePath};
     if (!std::filesystem::exists(p)) {
         std::cout << "Target file '" << p.string() << "' does not exist\n";
@@ -50,6 +173,8 @@ int main(int argc, char* argv[]) {
     }
 
     UVM vmInstance;
+    vmInstance.MMU.Quota = quota;
+    vmInstance.UseImageCache = imageCache;
     vmInstance.setFilePath(p);
     size_t fileSize = 0;
     uint8_t* buffer = vmInstance.readSource(p, &fileSize);
@@ -60,6 +185,12 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
+    // Native modules are matched to the file by its content hash
+    uint64_t contentHash = 0;
+    if (compileOnly || nativePath != nullptr || nativeCached) {
+        contentHash = hashContent(buffer, fileSize);
+    }
+
     // Deallocate buffer because it has no use after loading the file sections
     if (buffer != nullptr) {
         delete[] buffer;
@@ -71,7 +202,66 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
-    uint32_t status = vmInstance.run();
+    if (compileOnly) {
+        return compileAot(vmInstance, contentHash, outputPath) ? 0 : -1;
+    }
+
+    // Native code only runs on request. Cached modules are found by a content
+    // hash which does not prove that the module was built from this file.
+    AotModule module;
+    bool native = false;
+    if (nativePath != nullptr) {
+        native = module.load(nativePath, contentHash);
+        if (!native) {
+            std::cerr << "Could not load native module '" << nativePath
+                      << "'\n";
+            return -1;
+        }
+    } else if (nativeCached && tracePath == nullptr) {
+        std::filesystem::path cached = getAotCachePath(contentHash);
+        std::error_code ec;
+        native = !cached.empty() && std::filesystem::exists(cached, ec) &&
+                 module.load(cached, contentHash);
+    }
+
+    // Open the report file up front so that a bad path does not waste a run
+    std::ofstream heapProfileFile;
+    if (heapProfilePath != nullptr) {
+        heapProfileFile.open(heapProfilePath);
+        if (!heapProfileFile) {
+            std::cerr << "Could not open heap profile file '"
+                      << heapProfilePath << "'\n";
+            return -1;
+        }
+        vmInstance.enableHeapProfile();
+    }
+
+    if (garbageCollect) {
+        vmInstance.enableGarbageCollector();
+    }
+
+    uint32_t status = UVM_SUCCESS;
+    if (tracePath != nullptr) {
+        std::ofstream traceFile(tracePath, std::ios::binary);
+        if (!traceFile) {
+            std::cerr << "Could not open trace file '" << tracePath << "'\n";
+            return -1;
+        }
+        status = runWithTrace(vmInstance, traceFile);
+    } else if (native) {
+        status = module.run(&vmInstance);
+    } else {
+        status = vmInstance.run();
+    }
+    // Only a successful run updates the image cache
+    if (status == UVM_SUCCESS) {
+        vmInstance.storeCache();
+    }
+    // Blocks still allocated after a failed run are reported as well, they
+    // show what filled the heap
+    if (heapProfilePath != nullptr) {
+        heapProfileFile << vmInstance.HeapProfile->report(true);
+    }
     if (status != UVM_SUCCESS) {
         std::cerr << "[RUNTIME ERROR] " << translateError(status)
                   << "\nVM exited with an error\n";
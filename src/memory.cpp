@@ -15,9 +15,14 @@
 // ======================================================================== //
 
 #include "memory.hpp"
+#include "debug/heap_profiler.hpp"
 #include "error.hpp"
+#include "gc.hpp"
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <iterator>
+#include <utility>
 #include <vector>
 
 /**
@@ -34,6 +39,16 @@ MemBuffer::MemBuffer(uint64_t startAddr,
     : VStartAddr(startAddr), Size(size), Type(type), Perm(perm), Capacity(size),
       Buffer(new uint8_t[size]) {}
 
+/**
+ * Constructs a read only MemBuffer backed by a host file view
+ * @param startAddr Virtual start address
+ * @param mapping Host file view of at most UINT32_MAX bytes
+ */
+MemBuffer::MemBuffer(uint64_t startAddr, const FileMapping& mapping)
+    : VStartAddr(startAddr), Size(static_cast<uint32_t>(mapping.Size)),
+      Type(MemType::FILE_MAPPING), Perm(PERM_READ_MASK), Buffer(mapping.Data),
+      Mapping(mapping) {}
+
 /** Move assignment operator */
 MemBuffer& MemBuffer::operator=(MemBuffer&& memBuffer) noexcept {
     VStartAddr = memBuffer.VStartAddr;
@@ -42,8 +57,11 @@ MemBuffer& MemBuffer::operator=(MemBuffer&& memBuffer) noexcept {
     Perm = memBuffer.Perm;
     Capacity = memBuffer.Capacity;
     Freed = memBuffer.Freed;
+    Holes = std::move(memBuffer.Holes);
     Buffer = memBuffer.Buffer;
+    Mapping = memBuffer.Mapping;
     memBuffer.Buffer = nullptr;
+    memBuffer.Mapping = {};
     return *this;
 }
 
@@ -53,13 +71,20 @@ MemBuffer& MemBuffer::operator=(MemBuffer&& memBuffer) noexcept {
  */
 MemBuffer::MemBuffer(MemBuffer&& memBuffer) noexcept
     : VStartAddr(memBuffer.VStartAddr), Size(memBuffer.Size),
-      Type(memBuffer.Type), Perm(memBuffer.Perm), Buffer(memBuffer.Buffer) {
+      Type(memBuffer.Type), Perm(memBuffer.Perm), Capacity(memBuffer.Capacity),
+      Freed(memBuffer.Freed), Holes(std::move(memBuffer.Holes)),
+      Buffer(memBuffer.Buffer), Mapping(memBuffer.Mapping) {
     memBuffer.Buffer = nullptr;
+    memBuffer.Mapping = {};
 }
 
 /** Destructor */
 MemBuffer::~MemBuffer() {
-    delete[] Buffer;
+    if (Mapping.Base != nullptr) {
+        unmapHostFile(Mapping);
+    } else {
+        delete[] Buffer;
+    }
 }
 
 /**
@@ -70,6 +95,69 @@ void MemBuffer::read(void* source) {
     memcpy(Buffer, source, Size);
 }
 
+/**
+ * Marks a freed range of a heap buffer as reusable and merges it with the
+ * adjacent free ranges
+ * @param offset Offset of the range inside the buffer
+ * @param size Size of the range in bytes
+ */
+void MemBuffer::addHole(uint32_t offset, uint32_t size) {
+    Freed += size;
+
+    auto next = Holes.lower_bound(offset);
+    if (next != Holes.end() && offset + size == next->first) {
+        size += next->second;
+        next = Holes.erase(next);
+    }
+    if (next != Holes.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+    Holes.emplace_hint(next, offset, size);
+}
+
+/**
+ * Takes a range out of the first free range of a heap buffer which is large
+ * enough
+ * @param size Size of the range in bytes
+ * @param offset [out] Offset of the taken range inside the buffer
+ * @return True if a free range was large enough
+ */
+bool MemBuffer::takeHole(uint32_t size, uint32_t* offset) {
+    for (auto it = Holes.begin(); it != Holes.end(); ++it) {
+        if (it->second < size) {
+            continue;
+        }
+
+        *offset = it->first;
+        uint32_t rest = it->second - size;
+        Holes.erase(it);
+        if (rest != 0) {
+            Holes.emplace(*offset + size, rest);
+        }
+        Freed -= size;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Checks if an offset of a heap buffer lies inside of a free range
+ * @param offset Offset inside the buffer
+ * @return True if the offset has been freed and not reused yet
+ */
+bool MemBuffer::isHole(uint32_t offset) const {
+    auto it = Holes.upper_bound(offset);
+    if (it == Holes.begin()) {
+        return false;
+    }
+    --it;
+    return offset < it->first + it->second;
+}
+
 /**
  * Constructs a new MemSection
  * @param type Section type
@@ -111,7 +199,7 @@ uint32_t MemManager::setStackPtr(uint64_t vAddr) {
         return E_INVALID_STACK_OP;
     }
 
-    SP = vAddr;
+    Regs[REG_STACK_PTR].I64 = vAddr;
     return UVM_SUCCESS;
 }
 
@@ -125,7 +213,7 @@ uint32_t MemManager::setBasePtr(uint64_t vAddr) {
         return E_INVALID_BASE_PTR;
     }
 
-    BP = vAddr;
+    Regs[REG_BASE_PTR].I64 = vAddr;
     return UVM_SUCCESS;
 }
 
@@ -137,8 +225,8 @@ uint32_t MemManager::setBasePtr(uint64_t vAddr) {
  */
 uint32_t MemManager::stackPush(void* val, UVMDataSize size) {
     // Check if the stack increase invalidates the stack pointer
-    uint64_t oldSP = SP;
-    uint64_t newSP = SP + static_cast<uint32_t>(size);
+    uint64_t oldSP = Regs[REG_STACK_PTR].I64;
+    uint64_t newSP = Regs[REG_STACK_PTR].I64 + static_cast<uint32_t>(size);
     if (setStackPtr(newSP) != 0) {
         return E_INVALID_STACK_OP;
     }
@@ -147,6 +235,7 @@ uint32_t MemManager::stackPush(void* val, UVMDataSize size) {
     const uint8_t* stackBuffer = Buffers[StackBufferIndex].Buffer;
     memcpy(const_cast<uint8_t*>(&stackBuffer[bufferOffset]), val,
            static_cast<uint32_t>(size));
+    logWrite(oldSP, static_cast<uint32_t>(size));
 
     return UVM_SUCCESS;
 }
@@ -160,7 +249,7 @@ uint32_t MemManager::stackPush(void* val, UVMDataSize size) {
  */
 uint32_t MemManager::stackPop(uint64_t* out, UVMDataSize size) {
     // Check if the stack increase invalidates the stack pointer
-    uint64_t newSP = SP - static_cast<uint32_t>(size);
+    uint64_t newSP = Regs[REG_STACK_PTR].I64 - static_cast<uint32_t>(size);
     if (setStackPtr(newSP) != 0) {
         return E_INVALID_STACK_OP;
     }
@@ -171,10 +260,84 @@ uint32_t MemManager::stackPop(uint64_t* out, UVMDataSize size) {
         memcpy(out, &stackBuffer[bufferOffset], static_cast<uint32_t>(size));
     }
 
-    SP = newSP;
+    Regs[REG_STACK_PTR].I64 = newSP;
+    return UVM_SUCCESS;
+}
+
+/**
+ * Pushes the return address of a call onto the stack and records the frame on
+ * the shadow return stack
+ * @param returnIP Address of the instruction following the call
+ * @return On success returns UVM_SUCCESS otherwise E_INVALID_STACK_OP
+ */
+uint32_t MemManager::pushReturnAddr(uint64_t returnIP) {
+    uint64_t slot = Regs[REG_STACK_PTR].I64;
+    if (slot + sizeof(returnIP) > VStackEnd) {
+        return E_INVALID_STACK_OP;
+    }
+
+    uint8_t* stackBuffer = Buffers[StackBufferIndex].Buffer;
+    memcpy(&stackBuffer[slot - VStackStart], &returnIP, sizeof(returnIP));
+    Regs[REG_STACK_PTR].I64 = slot + sizeof(returnIP);
+    logWrite(slot, sizeof(returnIP));
+
+    // Frames at or above the new slot were left without a ret
+    while (ShadowDepth != 0 &&
+           ShadowStack[(ShadowTop - 1) & (SHADOW_STACK_SIZE - 1)].Slot >=
+               slot) {
+        ShadowTop--;
+        ShadowDepth--;
+    }
+
+    ShadowFrame& frame = ShadowStack[ShadowTop & (SHADOW_STACK_SIZE - 1)];
+    frame.ReturnIP = returnIP;
+    frame.Slot = slot;
+    frame.TargetStatus = checkJumpTarget(returnIP);
+    ShadowTop++;
+    if (ShadowDepth < SHADOW_STACK_SIZE) {
+        ShadowDepth++;
+    }
+
     return UVM_SUCCESS;
 }
 
+/**
+ * Pops a return address from the stack and validates it as jump target. If
+ * the frame still matches the shadow return stack the validation done by
+ * pushReturnAddr() is reused.
+ * @param returnIP Output return address
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_INVALID_STACK_OP, E_INVALID_JUMP_DEST, E_MISSING_PERM]
+ */
+uint32_t MemManager::popReturnAddr(uint64_t* returnIP) {
+    if (Regs[REG_STACK_PTR].I64 < VStackStart + sizeof(*returnIP)) {
+        return E_INVALID_STACK_OP;
+    }
+
+    uint64_t slot = Regs[REG_STACK_PTR].I64 - sizeof(*returnIP);
+    const uint8_t* stackBuffer = Buffers[StackBufferIndex].Buffer;
+    memcpy(returnIP, &stackBuffer[slot - VStackStart], sizeof(*returnIP));
+    Regs[REG_STACK_PTR].I64 = slot;
+
+    // Drop frames which were popped without a ret
+    while (ShadowDepth != 0) {
+        ShadowFrame& frame =
+            ShadowStack[(ShadowTop - 1) & (SHADOW_STACK_SIZE - 1)];
+        if (frame.Slot < slot) {
+            break;
+        }
+
+        ShadowTop--;
+        ShadowDepth--;
+        if (frame.Slot == slot && frame.ReturnIP == *returnIP) {
+            return frame.TargetStatus;
+        }
+    }
+
+    // Return address was not pushed by a call or has been overwritten
+    return checkJumpTarget(*returnIP);
+}
+
 /**
  * Adds new MemBuffer to memory manager
  * @param vAddr Virtual start address of buffer
@@ -189,6 +352,15 @@ uint32_t MemManager::addBuffer(uint64_t vAddr,
                                uint8_t perm) {
     uint32_t buffIndex = Buffers.size();
     Buffers.emplace_back(vAddr, size, type, perm);
+    flushTLB();
+
+    if (type == MemType::HEAP) {
+        Usage.HeapBytes += size;
+    } else if (type == MemType::STACK) {
+        Usage.StackBytes += size;
+    } else {
+        Usage.SectionBytes += size;
+    }
     return buffIndex;
 }
 
@@ -199,7 +371,7 @@ uint32_t MemManager::addBuffer(uint64_t vAddr,
 void MemManager::initStack() {
     StackBufferIndex = addBuffer(VStackStart, UVM_STACK_SIZE, MemType::STACK,
                                  PERM_READ_MASK | PERM_WRITE_MASK);
-    SP = VStackStart;
+    Regs[REG_STACK_PTR].I64 = VStackStart;
     VStackEnd = VStackStart + UVM_STACK_SIZE;
 }
 
@@ -232,19 +404,18 @@ uint32_t MemManager::setIntReg(uint8_t id, IntVal val, IntType type) {
         break;
     default: {
         if (id >= REG_GP_START && id <= REG_GP_END) {
-            uint32_t regIndex = id - REG_GP_START;
             switch (type) {
             case IntType::I8:
-                GP[regIndex].I8 = val.I8;
+                Regs[id].I8 = val.I8;
                 break;
             case IntType::I16:
-                GP[regIndex].I16 = val.I16;
+                Regs[id].I16 = val.I16;
                 break;
             case IntType::I32:
-                GP[regIndex].I32 = val.I32;
+                Regs[id].I32 = val.I32;
                 break;
             case IntType::I64:
-                GP[regIndex].I64 = val.I64;
+                Regs[id].I64 = val.I64;
                 break;
             }
         } else if (id >= REG_FP_START && id <= REG_FP_END) {
@@ -268,13 +439,12 @@ uint32_t MemManager::setIntReg(uint8_t id, IntVal val, IntType type) {
  */
 uint32_t MemManager::setFloatReg(uint8_t id, FloatVal val, FloatType type) {
     if (id >= REG_FP_START && id <= REG_FP_END) {
-        uint32_t regIndex = id - REG_FP_START;
         switch (type) {
         case FloatType::F32:
-            FP[regIndex].F32 = val.F32;
+            Regs[id].F32 = val.F32;
             break;
         case FloatType::F64:
-            FP[regIndex].F64 = val.F64;
+            Regs[id].F64 = val.F64;
             break;
         }
     } else if (id == REG_INSTR_PTR || id == REG_STACK_PTR ||
@@ -289,63 +459,6 @@ uint32_t MemManager::setFloatReg(uint8_t id, FloatVal val, FloatType type) {
     return UVM_SUCCESS;
 }
 
-/**
- * Gets an integer register value if input is valid
- * @param id Target register id
- * @param val [out] Integer value
- * @return On success returns UVM_SUCCESS otherwise error code
- */
-uint32_t MemManager::getIntReg(uint8_t id, IntVal& val) {
-    switch (id) {
-    case REG_INSTR_PTR:
-        val.I64 = IP;
-        break;
-    case REG_STACK_PTR:
-        val.I64 = SP;
-        break;
-    case REG_BASE_PTR:
-        val.I64 = BP;
-        break;
-    case REG_FLAGS:
-        return E_INVALID_SRC_REG;
-        break;
-    default: {
-        if (id >= REG_GP_START && id <= REG_GP_END) {
-            uint32_t regIndex = id - REG_GP_START;
-            val.I64 = GP[regIndex].I64;
-        } else if (id >= REG_FP_START && id <= REG_FP_END) {
-            return E_INVALID_TYPE;
-        } else {
-            return E_INVALID_SRC_REG;
-        }
-    } break;
-    }
-
-    return UVM_SUCCESS;
-}
-
-/**
- * Gets a float register value if input is valid
- * @param id Target register id
- * @param val [out] Float value
- * @return On success returns UVM_SUCCESS otherwise error code
- */
-uint32_t MemManager::getFloatReg(uint8_t id, FloatVal& val) {
-    if (id >= REG_FP_START && id <= REG_FP_END) {
-        uint32_t regIndex = id - REG_FP_START;
-        val.F64 = FP[regIndex].F64;
-    } else if (id == REG_INSTR_PTR || id == REG_STACK_PTR ||
-               id == REG_BASE_PTR || (id >= REG_GP_START && id <= REG_GP_END)) {
-        return E_INVALID_TYPE;
-    } else if (id == REG_FLAGS) {
-        return E_INVALID_SRC_REG;
-    } else {
-        return E_INVALID_SRC_REG;
-    }
-
-    return UVM_SUCCESS;
-}
-
 /**
  * Turns a valid type byte into a IntType
  * @param type Byte containg the unvalidated type
@@ -453,21 +566,39 @@ bool MemManager::evalRegOffset(uint8_t* buff, uint64_t* address) {
 }
 
 /**
- * Allocates a new HeapBlock of given size at the current HeapPointer address
+ * Allocates a new HeapBlock of given size at the current HeapPointer address.
+ * Adding heap buffers is subject to the memory quota.
  * @param size HeapBlock size
+ * @param status [out] Optional, set to E_MEM_QUOTA_EXCEEDED if the hard limit
+ * would be exceeded otherwise UVM_SUCCESS
  * @return On success virtual address of allocated heap block otherwise
  * UVM_NULLPTR
  */
-uint64_t MemManager::allocHeap(size_t size) {
+uint64_t MemManager::allocHeap(size_t size, uint32_t* status) {
+    if (status != nullptr) {
+        *status = UVM_SUCCESS;
+    }
+
     // Actually allocated size is <32-bit size> + <requested_size>
     size_t actualSize = size + 4;
 
     // Only try to allocate in existing buffer if it can fit into a single
-    // MemBuffer
+    // MemBuffer. Freed blocks are reused first fit before the rest of the
+    // capacity.
     MemBuffer* hb = nullptr;
+    uint32_t hbOffset = 0;
     if (actualSize <= HEAP_BLOCK_SIZE) {
         for (MemBuffer& buff : Buffers) {
-            if (buff.Type == MemType::HEAP && buff.Capacity >= actualSize) {
+            if (buff.Type != MemType::HEAP) {
+                continue;
+            }
+            if (buff.takeHole(actualSize, &hbOffset)) {
+                hb = &buff;
+                break;
+            }
+            if (buff.Capacity >= actualSize) {
+                hbOffset = buff.Size - buff.Capacity;
+                buff.Capacity -= actualSize;
                 hb = &buff;
                 break;
             }
@@ -476,9 +607,24 @@ uint64_t MemManager::allocHeap(size_t size) {
 
     // If no heap block was found allocate new ones until the size requirment is
     // met
+    uint64_t allocAddr = UVM_NULLPTR;
     if (hb == nullptr) {
+        // Every new buffer costs its block and its entry in Buffers
+        uint64_t blocks = (actualSize + HEAP_BLOCK_SIZE - 1) / HEAP_BLOCK_SIZE;
+        uint64_t used = usage().total() +
+                        blocks * (HEAP_BLOCK_SIZE + sizeof(MemBuffer));
+        if (Quota.HardLimit != 0 && used > Quota.HardLimit) {
+            if (status != nullptr) {
+                *status = E_MEM_QUOTA_EXCEEDED;
+            }
+            return UVM_NULLPTR;
+        }
+        if (Quota.SoftLimit != 0 && used > Quota.SoftLimit) {
+            return UVM_NULLPTR;
+        }
+
         uint32_t sizeLeft = actualSize;
-        uint64_t allocVAddr = VHeapStart + 4;
+        allocAddr = VHeapStart + 4;
 
         size_t i = 0;
         while (sizeLeft > 0) {
@@ -487,6 +633,11 @@ uint64_t MemManager::allocHeap(size_t size) {
                           PERM_READ_MASK | PERM_WRITE_MASK);
             VHeapStart += HEAP_BLOCK_SIZE;
 
+            // Stale bytes would keep blocks alive during a collection
+            if (Collector != nullptr) {
+                std::memset(Buffers[hpId].Buffer, 0, HEAP_BLOCK_SIZE);
+            }
+
             if (i == 0) {
                 uint32_t* hpAllocSizeTarget =
                     reinterpret_cast<uint32_t*>(Buffers[hpId].Buffer);
@@ -503,24 +654,26 @@ uint64_t MemManager::allocHeap(size_t size) {
 
             i++;
         }
-
-        return allocVAddr;
     } else {
-        size_t hbOffset = hb->Size - hb->Capacity;
-
         // write 32 bit size
         uint8_t* hbBuffer = hb->Buffer;
         uint32_t* hpAllocSizeTarget =
             reinterpret_cast<uint32_t*>(&hbBuffer[hbOffset]);
         *hpAllocSizeTarget = size;
+        if (Collector != nullptr) {
+            std::memset(&hbBuffer[hbOffset + 4], 0, size);
+        }
 
-        uint64_t allocAddr = hb->VStartAddr + hbOffset + 4;
-
-        hb->Capacity -= actualSize;
-        return allocAddr;
+        allocAddr = hb->VStartAddr + hbOffset + 4;
     }
 
-    return UVM_NULLPTR;
+    if (Profiler != nullptr) {
+        Profiler->onAlloc(*this, allocAddr, size);
+    }
+    if (Collector != nullptr) {
+        Collector->onAlloc(allocAddr, size);
+    }
+    return allocAddr;
 }
 
 /**
@@ -535,7 +688,7 @@ uint32_t MemManager::deallocHeap(uint64_t vAddr) {
     for (MemBuffer& buff : Buffers) {
         // Has to start at offset 4 to be a valid address which was previously
         // allocated
-        if (vAddr >= buff.VStartAddr + 4 &&
+        if (buff.Type == MemType::HEAP && vAddr >= buff.VStartAddr + 4 &&
             vAddr <= buff.VStartAddr + buff.Size) {
             hb = &buff;
             break;
@@ -550,31 +703,54 @@ uint32_t MemManager::deallocHeap(uint64_t vAddr) {
     uint32_t blockSize = 0;
     uint32_t readRes = read(vAddr - 4, &blockSize, UVMDataSize::DWORD, 0);
 
-    if (readRes != UVM_SUCCESS || blockSize == 0) {
+    // A header inside of a free range belongs to an already freed block
+    uint32_t offset = static_cast<uint32_t>(vAddr - 4 - hb->VStartAddr);
+    if (readRes != UVM_SUCCESS || blockSize == 0 || hb->isHole(offset)) {
         return E_DEALLOC_INVALID_ADDR;
     }
 
+    // The collector knows every allocated block and catches double frees
+    if (Collector != nullptr) {
+        if (!Collector->contains(vAddr)) {
+            return E_DEALLOC_INVALID_ADDR;
+        }
+        Collector->onFree(vAddr);
+    }
+    if (Profiler != nullptr) {
+        Profiler->onFree(vAddr);
+    }
+
+    // Blocks spanning multiple buffers start at the beginning of a buffer
     uint32_t actualBlockSize = blockSize + 4;
     uint32_t sizeLeft = actualBlockSize;
     while (sizeLeft > 0) {
-        if (sizeLeft > HEAP_BLOCK_SIZE) {
-            sizeLeft -= HEAP_BLOCK_SIZE;
-            hb->Freed = hb->Size;
-        } else {
-            hb->Freed += sizeLeft;
-            sizeLeft = 0;
-        }
-
-        if (hb->Freed >= hb->Size) {
+        uint32_t holeSize = std::min(sizeLeft, hb->Size - offset);
+        hb->addHole(offset, holeSize);
+        sizeLeft -= holeSize;
+        offset = 0;
+
+        // Release the buffer once every block allocated in it is freed
+        bool released = hb->Freed >= hb->Size - hb->Capacity;
+        if (released) {
             // Note: we have to delete the array because std::vectors erase
             // function should but for some reason does not call the destructor
             // of the element to be erased.
             delete[] hb->Buffer;
+            hb->Buffer = nullptr;
+            Usage.HeapBytes -= hb->Size;
             Buffers.erase(Buffers.begin() + hbIndex);
+            flushTLB();
+        }
+
+        if (sizeLeft == 0) {
+            break;
         }
 
         // Because the vector shift one to the left the hbIndex now points to
         // the MemBuffer after the deallocated one
+        if (!released) {
+            hbIndex++;
+        }
         if (hbIndex < Buffers.size()) {
             hb = &Buffers[hbIndex];
         } else {
@@ -585,6 +761,51 @@ uint32_t MemManager::deallocHeap(uint64_t vAddr) {
     return UVM_SUCCESS;
 }
 
+/**
+ * Adds a read only host file view at the top of the heap
+ * @param mapping Host file view
+ * @return On success returns the virtual address of the view otherwise
+ * UVM_NULLPTR
+ */
+uint64_t MemManager::addFileMapping(const FileMapping& mapping) {
+    if (mapping.Size == 0 || mapping.Size > UINT32_MAX) {
+        return UVM_NULLPTR;
+    }
+
+    // Following heap blocks start at the next block boundary
+    uint64_t vAddr = VHeapStart;
+    uint64_t blocks = (mapping.Size + HEAP_BLOCK_SIZE - 1) / HEAP_BLOCK_SIZE;
+    VHeapStart += blocks * HEAP_BLOCK_SIZE;
+    Buffers.emplace_back(vAddr, mapping);
+    Usage.MappedBytes += mapping.Size;
+    return vAddr;
+}
+
+/**
+ * Removes a host file view added by addFileMapping() and unmaps it
+ * @param vAddr Virtual start address of the view
+ * @return On success returns UVM_SUCCESS otherwise E_VADDR_NOT_FOUND
+ */
+uint32_t MemManager::removeFileMapping(uint64_t vAddr) {
+    for (size_t i = 0; i < Buffers.size(); i++) {
+        MemBuffer& buff = Buffers[i];
+        if (buff.Type != MemType::FILE_MAPPING || buff.VStartAddr != vAddr) {
+            continue;
+        }
+
+        // Erasing moves the following buffers onto this one, which does not
+        // release it
+        unmapHostFile(buff.Mapping);
+        Usage.MappedBytes -= buff.Mapping.Size;
+        buff.Mapping = {};
+        buff.Buffer = nullptr;
+        Buffers.erase(Buffers.begin() + i);
+        flushTLB();
+        return UVM_SUCCESS;
+    }
+    return E_VADDR_NOT_FOUND;
+}
+
 /**
  * Loads sections from source buffer into memory buffers and sets stack start
  * address
@@ -592,6 +813,18 @@ uint32_t MemManager::deallocHeap(uint64_t vAddr) {
  * @param size Size of source buffer
  */
 void MemManager::loadSections(uint8_t* buff, size_t size) {
+    flushTLB();
+
+    // Sections never exceed the file, so neither does the permission map.
+    // Later sections win like in findSection().
+    SectionPerms.assign(size, 0);
+    for (const auto& sec : Sections) {
+        uint64_t end = std::min<uint64_t>(sec.VStartAddr + sec.Size, size);
+        for (uint64_t vAddr = sec.VStartAddr; vAddr < end; vAddr++) {
+            SectionPerms[vAddr] = sec.Perm | SECTION_PRESENT_MASK;
+        }
+    }
+
     uint64_t Cursor = 0;
     for (const auto& sec : Sections) {
         uint32_t buffIndex =
@@ -603,6 +836,66 @@ void MemManager::loadSections(uint8_t* buff, size_t size) {
     VStackStart = Cursor + 1;
 }
 
+/**
+ * Gets the host memory used by this memory manager
+ * @return Usage including the current size of the bookkeeping structures
+ */
+MemUsage MemManager::usage() const {
+    MemUsage current = Usage;
+    current.MetaBytes = sizeof(MemManager) +
+                        Buffers.capacity() * sizeof(MemBuffer) +
+                        Sections.capacity() * sizeof(MemSection) +
+                        SectionPerms.capacity();
+    return current;
+}
+
+/**
+ * Finds the memory buffer which holds the whole given virtual memory range
+ * @param vAddr Virtual start address of the range
+ * @param size Size of the range in bytes
+ * @return On success returns the buffer otherwise nullptr
+ */
+MemBuffer* MemManager::findBuffer(uint64_t vAddr, uint32_t size) {
+    for (MemBuffer& buff : Buffers) {
+        if (vAddr >= buff.VStartAddr &&
+            vAddr + size <= buff.VStartAddr + buff.Size) {
+            return &buff;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Searches the buffer of a virtual memory range and caches it for the page of
+ * the start address
+ * @param vAddr Virtual start address of the range
+ * @param size Size of the range in bytes
+ * @return On success returns the filled entry otherwise nullptr
+ */
+const TLBEntry* MemManager::fillTLB(uint64_t vAddr, uint32_t size) {
+    MemBuffer* buffer = findBuffer(vAddr, size);
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+
+    uint64_t page = vAddr >> TLB_PAGE_SHIFT;
+    TLBEntry& entry = TLB[page & (TLB_SIZE - 1)];
+    entry.Page = page;
+    entry.VStartAddr = buffer->VStartAddr;
+    entry.VEndAddr = buffer->VStartAddr + buffer->Size;
+    entry.Host = buffer->Buffer;
+    entry.Perm = buffer->Perm;
+    return &entry;
+}
+
+/**
+ * Drops every cached translation. Has to be called whenever a buffer is added,
+ * removed or moved to another host address.
+ */
+void MemManager::flushTLB() {
+    TLB.fill(TLBEntry{});
+}
+
 /**
  * Reads from virtual memory at given address with at least read permission into
  * destination buffer
@@ -619,136 +912,145 @@ MemManager::read(uint64_t vAddr, void* dest, UVMDataSize size, uint8_t perm) {
     uint32_t sizeBytes = static_cast<uint32_t>(size);
 
     // TODO: Across multiple buffers
-    // Find the buffer of vAddr
-    MemBuffer* buffer = nullptr;
-    for (MemBuffer& buff : Buffers) {
-        if (vAddr >= buff.VStartAddr &&
-            vAddr + sizeBytes <= buff.VStartAddr + buff.Size) {
-            buffer = &buff;
-            break;
-        }
-    }
-
-    if (buffer == nullptr) {
+    const TLBEntry* entry = translate(vAddr, sizeBytes);
+    if (entry == nullptr) {
         return E_VADDR_NOT_FOUND;
     }
 
-    if ((buffer->Perm & perm) != perm) {
+    if ((entry->Perm & perm) != perm) {
         return E_MISSING_PERM;
     }
 
-    size_t buffIndex = vAddr - buffer->VStartAddr;
-    memcpy(dest, &buffer->Buffer[buffIndex], sizeBytes);
+    memcpy(dest, entry->Host + (vAddr - entry->VStartAddr), sizeBytes);
 
     return UVM_SUCCESS;
 }
 
 /**
  * Reads from virtual memory at given address with at least read permission into
- * destination buffer
+ * destination buffer. The range may span multiple memory buffers.
  * @param vAddr Source virtual address
  * @param dest Pointer to destination buffer of at least given size
  * @param size Size of read
  * @param perm Required permissions of memory section
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_VADDR_NOT_FOUND, E_MISSING_PERM]
  */
 uint32_t
 MemManager::readLarge(uint64_t vAddr, void* dest, uint32_t size, uint8_t perm) {
-    // Add the read permission
-    perm |= PERM_READ_MASK;
-
-    // If memory range which should be read spans accross multiple memory
-    // buffers it has to perform multiple memcpy's. readLeft contains the size
-    // of how much memory is left to be copied and readIndex contains the
-    // virtual address of the start of the left memory to be copied.
-    int64_t readLeft = size;
-    uint64_t readIndex = vAddr;
-    while (readLeft > 0) {
-        // Find the buffer of vAddr
-        MemBuffer* buffer = nullptr;
-        for (MemBuffer& buff : Buffers) {
-            if (readIndex >= buff.VStartAddr &&
-                readIndex < buff.VStartAddr + buff.Size) {
-                buffer = &buff;
-                break;
-            }
-        }
-
-        if (buffer == nullptr) {
-            return E_VADDR_NOT_FOUND;
-        }
-
-        if ((buffer->Perm & perm) != perm) {
-            return E_MISSING_PERM;
-        }
-
-        uint32_t actualReadSize = size;
-        uint64_t buffVEnd = buffer->VStartAddr + buffer->Size;
-        if (readIndex + readLeft > buffVEnd) {
-            actualReadSize = buffVEnd - readIndex;
-        }
-
-        size_t buffIndex = vAddr - buffer->VStartAddr;
-        memcpy(dest, &buffer->Buffer[buffIndex], actualReadSize);
-
-        readLeft -= actualReadSize;
-        readIndex += actualReadSize;
+    MemSpanIterator it(*this, vAddr, size, perm | PERM_READ_MASK);
+    uint8_t* out = static_cast<uint8_t*>(dest);
+    MemSpan span;
+    while (it.next(span)) {
+        memcpy(out, span.Ptr, span.Size);
+        out += span.Size;
     }
-
-    return UVM_SUCCESS;
+    return it.Status;
 }
 
 /**
  * Writes to virtual memory at given address from source buffer with at least
- * write permission
+ * write permission. The range may span multiple memory buffers, it is checked
+ * before anything is written so a failing write leaves memory unchanged.
  * @param src Pointer to source buffer of at least given size
- * @param vAddr Source virtual address
- * @param size Size of read
+ * @param vAddr Destination virtual address
+ * @param size Size of write
  * @param perm Required permissions of memory section
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_VADDR_NOT_FOUND, E_MISSING_PERM]
  */
 uint32_t
 MemManager::writeLarge(void* src, uint64_t vAddr, uint32_t size, uint8_t perm) {
-    // Add the write permission
     perm |= PERM_WRITE_MASK;
+    MemSpan span;
+    MemSpanIterator check(*this, vAddr, size, perm);
+    while (check.next(span)) {
+    }
+    if (check.Status != UVM_SUCCESS) {
+        return check.Status;
+    }
 
-    // If memory range which should be read spans accross multiple memory
-    // buffers it has to perform multiple memcpy's. writeLeft contains the size
-    // of how much memory is left to be copied and writeIndex contains the
-    // virtual address of the start of the left memory to be copied.
-    int64_t writeLeft = size;
-    uint64_t writeIndex = vAddr;
-    while (writeLeft > 0) {
-        // Find the buffer of vAddr
-        MemBuffer* buffer = nullptr;
-        for (MemBuffer& buff : Buffers) {
-            if (writeIndex >= buff.VStartAddr &&
-                writeIndex < buff.VStartAddr + buff.Size) {
-                buffer = &buff;
-                break;
-            }
-        }
+    MemSpanIterator it(*this, vAddr, size, perm);
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    while (it.next(span)) {
+        memcpy(span.Ptr, in, span.Size);
+        in += span.Size;
+    }
 
-        if (buffer == nullptr) {
-            return E_VADDR_NOT_FOUND;
-        }
+    logWrite(vAddr, size);
+    return UVM_SUCCESS;
+}
 
-        if ((buffer->Perm & perm) != perm) {
-            return E_MISSING_PERM;
-        }
+/**
+ * Resolves a virtual memory range which may span multiple memory buffers into
+ * host memory spans. The whole range is checked before anything is returned,
+ * so callers either get every span or none.
+ * @param vAddr Virtual start address of the range
+ * @param size Size of the range in bytes
+ * @param perm Required permissions of every memory buffer in the range
+ * @param spans [out] Host spans in address order
+ * @return On success returns UVM_SUCCESS otherwise error state
+ * [E_VADDR_NOT_FOUND, E_MISSING_PERM]
+ */
+uint32_t MemManager::resolveRange(uint64_t vAddr,
+                                  uint32_t size,
+                                  uint8_t perm,
+                                  std::vector<MemSpan>& spans) {
+    spans.clear();
+    MemSpanIterator it(*this, vAddr, size, perm);
+    MemSpan span;
+    while (it.next(span)) {
+        spans.push_back(span);
+    }
+    if (it.Status != UVM_SUCCESS) {
+        spans.clear();
+    }
+    return it.Status;
+}
 
-        uint32_t actualWriteSize = size;
-        uint64_t buffVEnd = buffer->VStartAddr + buffer->Size;
-        if (writeIndex + writeLeft > buffVEnd) {
-            actualWriteSize = buffVEnd - writeIndex;
-        }
+/**
+ * Starts walking a virtual memory range
+ * @param mmu Memory manager of the range
+ * @param vAddr Virtual start address of the range
+ * @param size Size of the range in bytes
+ * @param perm Required permissions of every memory buffer in the range
+ */
+MemSpanIterator::MemSpanIterator(MemManager& mmu,
+                                 uint64_t vAddr,
+                                 uint64_t size,
+                                 uint8_t perm)
+    : MMU(mmu), Cursor(vAddr), End(vAddr + size), Perm(perm) {
+    if (End < Cursor) {
+        Status = E_VADDR_NOT_FOUND;
+    }
+}
 
-        size_t buffIndex = vAddr - buffer->VStartAddr;
-        memcpy(&buffer->Buffer[buffIndex], src, actualWriteSize);
+/**
+ * Gets the next host span of the range
+ * @param span [out] Host span following the previous one
+ * @return True if a span was returned, false at the end of the range or on
+ * error
+ */
+bool MemSpanIterator::next(MemSpan& span) {
+    if (Status != UVM_SUCCESS || Cursor >= End) {
+        return false;
+    }
 
-        writeLeft -= actualWriteSize;
-        writeIndex += actualWriteSize;
+    const TLBEntry* entry = MMU.translate(Cursor, 1);
+    if (entry == nullptr) {
+        Status = E_VADDR_NOT_FOUND;
+        return false;
+    }
+    if ((entry->Perm & Perm) != Perm) {
+        Status = E_MISSING_PERM;
+        return false;
     }
 
-    return UVM_SUCCESS;
+    uint64_t spanEnd = std::min<uint64_t>(End, entry->VEndAddr);
+    span.Ptr = entry->Host + (Cursor - entry->VStartAddr);
+    span.Size = static_cast<size_t>(spanEnd - Cursor);
+    Cursor = spanEnd;
+    return true;
 }
 
 /**
@@ -767,26 +1069,17 @@ MemManager::write(void* src, uint64_t vAddr, UVMDataSize size, uint8_t perm) {
     uint32_t sizeBytes = static_cast<uint32_t>(size);
 
     // TODO: Across multiple buffers
-    // Find the buffer of vAddr
-    MemBuffer* buffer = nullptr;
-    for (MemBuffer& buff : Buffers) {
-        if (vAddr >= buff.VStartAddr &&
-            vAddr + sizeBytes <= buff.VStartAddr + buff.Size) {
-            buffer = &buff;
-            break;
-        }
-    }
-
-    if (buffer == nullptr) {
+    const TLBEntry* entry = translate(vAddr, sizeBytes);
+    if (entry == nullptr) {
         return E_VADDR_NOT_FOUND;
     }
 
-    if ((buffer->Perm & perm) != perm) {
+    if ((entry->Perm & perm) != perm) {
         return E_MISSING_PERM;
     }
 
-    size_t buffIndex = vAddr - buffer->VStartAddr;
-    memcpy(&buffer->Buffer[buffIndex], src, sizeBytes);
+    memcpy(entry->Host + (vAddr - entry->VStartAddr), src, sizeBytes);
+    logWrite(vAddr, sizeBytes);
 
     return UVM_SUCCESS;
 }
@@ -798,29 +1091,32 @@ MemManager::write(void* src, uint64_t vAddr, UVMDataSize size, uint8_t perm) {
  * @param size Size of read
  */
 uint32_t MemManager::fetchInstruction(uint8_t* dest, size_t size) {
+    return fetchInstruction(Regs[REG_INSTR_PTR].I64, dest, size);
+}
+
+/**
+ * Fetches an instruction at given address and writes it into dest buffer of
+ * size
+ * @param vAddr Virtual address of the instruction
+ * @param dest Pointer to destination buffer of at least given size
+ * @param size Size of read
+ */
+uint32_t
+MemManager::fetchInstruction(uint64_t vAddr, uint8_t* dest, size_t size) {
     // Add the execute permission
     uint8_t perm = PERM_EXE_MASK;
 
     // TODO: Across multiple buffers
-    // Find the buffer of vAddr
-    MemBuffer* buffer = nullptr;
-    for (MemBuffer& buff : Buffers) {
-        if (IP >= buff.VStartAddr && IP + size <= buff.VStartAddr + buff.Size) {
-            buffer = &buff;
-            break;
-        }
-    }
-
-    if (buffer == nullptr) {
+    const TLBEntry* entry = translate(vAddr, size);
+    if (entry == nullptr) {
         return E_VADDR_NOT_FOUND;
     }
 
-    if ((buffer->Perm & perm) != perm) {
+    if ((entry->Perm & perm) != perm) {
         return E_MISSING_PERM;
     }
 
-    size_t buffIndex = IP - buffer->VStartAddr;
-    memcpy(dest, &buffer->Buffer[buffIndex], size);
+    memcpy(dest, entry->Host + (vAddr - entry->VStartAddr), size);
 
     return UVM_SUCCESS;
 }
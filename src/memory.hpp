@@ -15,8 +15,12 @@
 // ======================================================================== //
 
 #pragma once
+#include "error.hpp"
+#include "file_io.hpp"
 #include <array>
 #include <cstdint>
+#include <cstring>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -24,10 +28,22 @@ constexpr uint64_t UVM_NULLPTR = 0;
 constexpr uint64_t UVM_STACK_SIZE = 4096;
 constexpr size_t HEAP_BLOCK_SIZE = 1024;
 constexpr size_t MAX_INSTR_SIZE = 15;
+/** Number of call frames mirrored by the shadow return stack, power of two */
+constexpr size_t SHADOW_STACK_SIZE = 64;
+/** Number of entries of the translation cache, power of two */
+constexpr size_t TLB_SIZE = 64;
+/** Guest pages of the translation cache are 1 << TLB_PAGE_SHIFT bytes */
+constexpr uint32_t TLB_PAGE_SHIFT = 10;
+/** Page number of unused translation cache entries */
+constexpr uint64_t TLB_INVALID_PAGE = UINT64_MAX;
+/** Number of memory writes of a single instruction kept for the tracer */
+constexpr size_t WRITE_LOG_SIZE = 8;
 
 constexpr uint8_t PERM_READ_MASK = 0b1000'0000;
 constexpr uint8_t PERM_WRITE_MASK = 0b0100'0000;
 constexpr uint8_t PERM_EXE_MASK = 0b0010'0000;
+/** Marks an address of SectionPerms which belongs to a section */
+constexpr uint8_t SECTION_PRESENT_MASK = 0b0000'0001;
 
 constexpr uint8_t REG_INSTR_PTR = 0x1;
 constexpr uint8_t REG_STACK_PTR = 0x2;
@@ -37,12 +53,19 @@ constexpr uint8_t REG_GP_START = 0x5;
 constexpr uint8_t REG_GP_END = 0x15;
 constexpr uint8_t REG_FP_START = 0x16;
 constexpr uint8_t REG_FP_END = 0x26;
+/** Number of entries in the register file, which is indexed by register id */
+constexpr size_t REG_FILE_SIZE = REG_FP_END + 1;
+/** Vector registers v0 - v15 follow the register file ids */
+constexpr uint8_t REG_VEC_START = 0x27;
+constexpr uint8_t REG_VEC_END = 0x36;
+constexpr size_t VEC_REG_COUNT = REG_VEC_END - REG_VEC_START + 1;
 
 enum class UVMDataSize {
-    BYTE = 1,  // i8
-    WORD = 2,  // i16
-    DWORD = 4, // i32 / f32
-    QWORD = 8, // i64 / f64
+    BYTE = 1,     // i8
+    WORD = 2,     // i16
+    DWORD = 4,    // i32 / f32
+    QWORD = 8,    // i64 / f64
+    XMMWORD = 16, // v128
 };
 
 enum class IntType {
@@ -73,6 +96,32 @@ union FloatVal {
     double F64 = 0.0f;
 };
 
+/** Register file entry, holds an integer or a float register */
+union RegVal {
+    uint8_t I8;
+    uint16_t I16;
+    uint32_t I32;
+    uint64_t I64;
+    int8_t S8;
+    int16_t S16;
+    int32_t S32;
+    int64_t S64 = 0;
+    float F32;
+    double F64;
+};
+static_assert(sizeof(RegVal) == 8, "register file entries must be 64 bit");
+
+/** 128 bit vector register, holds packed integer or float lanes */
+union alignas(16) VecVal {
+    uint8_t I8[16];
+    uint16_t I16[8];
+    uint32_t I32[4];
+    uint64_t I64[2] = {};
+    float F32[4];
+    double F64[2];
+};
+static_assert(sizeof(VecVal) == 16, "vector registers must be 128 bit");
+
 struct UVMInt {
     UVMInt(IntType type, IntVal val);
     IntType Type;
@@ -94,10 +143,12 @@ enum class MemType {
     CODE = 0x6,
     STACK = 0x7,
     HEAP = 0x8,
+    FILE_MAPPING = 0x9,
 };
 
 struct MemBuffer {
     MemBuffer(uint64_t startAddr, uint32_t size, MemType type, uint8_t perm);
+    MemBuffer(uint64_t startAddr, const FileMapping& mapping);
     MemBuffer(MemBuffer&& memBuffer) noexcept;
     MemBuffer& operator=(MemBuffer&& memBuffer) noexcept;
     ~MemBuffer();
@@ -113,11 +164,19 @@ struct MemBuffer {
     uint32_t Capacity = 0;
     /** How much has been freed **/
     uint32_t Freed = 0;
+    /** Freed ranges of a heap buffer which are not reused yet, maps the
+     * offset to the size. Adjacent ranges are merged, Freed is their sum. */
+    std::map<uint32_t, uint32_t> Holes;
 
     void read(void* source);
+    void addHole(uint32_t offset, uint32_t size);
+    bool takeHole(uint32_t size, uint32_t* offset);
+    bool isHole(uint32_t offset) const;
 
     /** Physical buffer */
     uint8_t* Buffer = nullptr;
+    /** Host file view backing Buffer, empty for owned buffers */
+    FileMapping Mapping;
 };
 
 struct MemSection {
@@ -131,10 +190,151 @@ struct MemSection {
     const uint32_t Size = 0;
 };
 
+/** Operand type of the last compare */
+enum class CmpType : uint8_t {
+    I8,
+    I16,
+    I32,
+    I64,
+    F32,
+    F64,
+};
+
+/**
+ * Flags register. Compares only record their operands, the zero and signed
+ * flags are derived from them when a conditional jump or the debugger reads
+ * them.
+ */
 struct FlagsRegister {
     bool Carry = false;
-    bool Zero = false;
-    bool Signed = false;
+    /** Raw bits of the left operand of the last compare */
+    uint64_t CmpLhs = 1;
+    /** Raw bits of the right operand of the last compare */
+    uint64_t CmpRhs = 0;
+    /** Operand type of the last compare */
+    CmpType Type = CmpType::I64;
+
+    /**
+     * Evaluates the zero and signed flags of the last compare
+     * @return Bit 0 holds the zero flag and bit 1 the signed flag
+     */
+    inline uint32_t evalZeroSigned() const {
+        if (Type <= CmpType::I64) {
+            // Move the compared width to the top so that the sign bit of the
+            // difference becomes bit 63
+            constexpr uint32_t SHIFT[] = {56, 48, 32, 0};
+            uint64_t diff = (CmpLhs - CmpRhs) << SHIFT[static_cast<int>(Type)];
+            return static_cast<uint32_t>(diff == 0) |
+                   static_cast<uint32_t>(diff >> 63) << 1;
+        }
+
+        if (Type == CmpType::F32) {
+            float lhs;
+            float rhs;
+            std::memcpy(&lhs, &CmpLhs, 4);
+            std::memcpy(&rhs, &CmpRhs, 4);
+            float result = lhs - rhs;
+            uint32_t bits;
+            std::memcpy(&bits, &result, 4);
+            // Only +0.0 counts as zero for floats
+            return static_cast<uint32_t>(bits == 0) | (bits >> 31) << 1;
+        }
+
+        double lhs;
+        double rhs;
+        std::memcpy(&lhs, &CmpLhs, 8);
+        std::memcpy(&rhs, &CmpRhs, 8);
+        double result = lhs - rhs;
+        uint64_t bits;
+        std::memcpy(&bits, &result, 8);
+        return static_cast<uint32_t>(result == 0) |
+               static_cast<uint32_t>(bits >> 63) << 1;
+    }
+
+    bool isZero() const { return (evalZeroSigned() & 0b01) != 0; }
+    bool isSigned() const { return (evalZeroSigned() & 0b10) != 0; }
+};
+
+struct HeapCollector;
+struct HeapProfiler;
+
+/** Host memory used by a MemManager in bytes */
+struct MemUsage {
+    /** Buffers of the loaded sections */
+    uint64_t SectionBytes = 0;
+    /** Stack buffer */
+    uint64_t StackBytes = 0;
+    /** Heap blocks */
+    uint64_t HeapBytes = 0;
+    /** Buffer and section tables and the memory manager itself */
+    uint64_t MetaBytes = 0;
+    /** Host file views, backed by the page cache and not part of total() */
+    uint64_t MappedBytes = 0;
+    /** Host copies of the data of pending asynchronous reads and writes */
+    uint64_t AsyncBytes = 0;
+
+    /**
+     * Sums up the memory counted against the quota
+     * @return Used bytes without file views
+     */
+    inline uint64_t total() const {
+        return SectionBytes + StackBytes + HeapBytes + MetaBytes + AsyncBytes;
+    }
+};
+
+/**
+ * Limits of MemUsage::total(), zero disables a limit. Heap allocations which
+ * would exceed the soft limit return UVM_NULLPTR so that the program can
+ * recover, exceeding the hard limit is a runtime error. Asynchronous requests
+ * which would exceed either limit fail. The heap profiler and the garbage
+ * collector are debugging aids, their host memory is not counted.
+ */
+struct MemQuota {
+    uint64_t SoftLimit = 0;
+    uint64_t HardLimit = 0;
+};
+
+/** Host memory backing a part of a guest memory range */
+struct MemSpan {
+    /** Host pointer to the first byte */
+    uint8_t* Ptr = nullptr;
+    /** Number of bytes */
+    size_t Size = 0;
+};
+
+/**
+ * Translation cache entry, maps a guest page to the memory buffer which was
+ * found for an access inside of it
+ */
+struct TLBEntry {
+    /** Guest page number, TLB_INVALID_PAGE if unused */
+    uint64_t Page = TLB_INVALID_PAGE;
+    /** Virtual start address of the buffer */
+    uint64_t VStartAddr = 0;
+    /** Virtual end address of the buffer (exclusive) */
+    uint64_t VEndAddr = 0;
+    /** Host pointer to the first byte of the buffer */
+    uint8_t* Host = nullptr;
+    /** Permissions of the buffer */
+    uint8_t Perm = 0;
+};
+
+/** Guest memory range written by an instruction */
+struct MemWrite {
+    /** Virtual start address */
+    uint64_t VAddr = 0;
+    /** Size in bytes */
+    uint32_t Size = 0;
+};
+
+/** Host side copy of a call frame pushed by the call instruction */
+struct ShadowFrame {
+    /** Pushed return address */
+    uint64_t ReturnIP = 0;
+    /** Virtual address of the stack slot holding the return address */
+    uint64_t Slot = 0;
+    /** Result of checkJumpTarget(ReturnIP) */
+    uint32_t TargetStatus = 0;
 };
 
 struct MemManager {
@@ -142,6 +342,9 @@ struct MemManager {
     std::vector<MemSection> Sections;
     /** list of memory buffers */
     std::vector<MemBuffer> Buffers;
+    /** Permissions of the section owning each virtual address below its size,
+     * combined with SECTION_PRESENT_MASK. Built by loadSections(). */
+    std::vector<uint8_t> SectionPerms;
     /** index to stack buffer inside buffers array */
     uint32_t StackBufferIndex = 0;
     /** virtual address of stack start */
@@ -150,27 +353,144 @@ struct MemManager {
     uint64_t VStackEnd = 0;
     /** Pointer to top of heap */
     uint64_t VHeapStart = 0;
-    /** Instruction pointer */
-    uint64_t IP = 0;
-    /** Stack pointer */
-    uint64_t SP = 0;
-    /** Base pointer */
-    uint64_t BP = 0;
+    /**
+     * Register file indexed by register id. Holds IP, SP, BP, the general
+     * purpose registers r0 - r15 and the floating point registers f0 - f15.
+     * Entry 0 and the REG_FLAGS entry are unused, flags live in Flags.
+     */
+    std::array<RegVal, REG_FILE_SIZE> Regs = {};
+    /** Vector registers indexed by register id - REG_VEC_START */
+    std::array<VecVal, VEC_REG_COUNT> VecRegs = {};
     /** Flags register */
     FlagsRegister Flags;
-    /** General purpose registers r0 - r15 */
-    std::array<IntVal, 16> GP = {0};
-    /** Floating point registers f0 - f15 */
-    std::array<FloatVal, 16> FP = {0};
     /** Current instruction buffer */
     std::array<uint8_t, MAX_INSTR_SIZE> InstrBuffer;
+    /** Ring of the most recent call frames, mirrors the guest stack */
+    std::array<ShadowFrame, SHADOW_STACK_SIZE> ShadowStack;
+    /** Total number of frames pushed onto ShadowStack, wraps around */
+    size_t ShadowTop = 0;
+    /** Number of valid frames in ShadowStack */
+    size_t ShadowDepth = 0;
+    /** Direct mapped translation cache indexed by the low guest page bits */
+    std::array<TLBEntry, TLB_SIZE> TLB;
+    /** First WRITE_LOG_SIZE memory writes since WriteCount was reset */
+    std::array<MemWrite, WRITE_LOG_SIZE> WriteLog;
+    /** Number of memory writes including the ones not kept in WriteLog,
+     * reset by the tracer */
+    uint32_t WriteCount = 0;
+    /** Records heap allocations if set, owned by the UVM instance */
+    HeapProfiler* Profiler = nullptr;
+    /** Garbage collector of the heap if set, owned by the UVM instance */
+    HeapCollector* Collector = nullptr;
+    /** Host memory used by the buffers, MetaBytes is filled in by usage() */
+    MemUsage Usage;
+    /** Host memory limits */
+    MemQuota Quota;
 
     MemSection* findSection(uint64_t vAddr, uint32_t size) const;
+
+    /**
+     * Checks if the instruction pointer may be set to the given address. Same
+     * result as checking the permissions of findSection(vAddr, 1).
+     * @param vAddr Target virtual address
+     * @return On success returns UVM_SUCCESS otherwise error state
+     * [E_INVALID_JUMP_DEST, E_MISSING_PERM]
+     */
+    inline uint32_t checkJumpTarget(uint64_t vAddr) const {
+        uint8_t perm = vAddr < SectionPerms.size() ? SectionPerms[vAddr] : 0;
+        if ((perm & SECTION_PRESENT_MASK) == 0) {
+            return E_INVALID_JUMP_DEST;
+        }
+        if ((perm & PERM_EXE_MASK) == 0) {
+            return E_MISSING_PERM;
+        }
+        return UVM_SUCCESS;
+    }
+
+    MemBuffer* findBuffer(uint64_t vAddr, uint32_t size);
+    const TLBEntry* fillTLB(uint64_t vAddr, uint32_t size);
+    void flushTLB();
+
+    /**
+     * Translates a virtual memory range through the translation cache, only
+     * searches the buffers on a miss
+     * @param vAddr Virtual start address of the range
+     * @param size Size of the range in bytes
+     * @return On success returns the entry of the buffer holding the whole
+     * range otherwise nullptr
+     */
+    inline const TLBEntry* translate(uint64_t vAddr, uint32_t size) {
+        uint64_t page = vAddr >> TLB_PAGE_SHIFT;
+        const TLBEntry& entry = TLB[page & (TLB_SIZE - 1)];
+        if (entry.Page == page && vAddr >= entry.VStartAddr &&
+            vAddr + size <= entry.VEndAddr) {
+            return &entry;
+        }
+        return fillTLB(vAddr, size);
+    }
+
     uint32_t read(uint64_t vAddr, void* dest, UVMDataSize size, uint8_t perm);
     uint32_t write(void* src, uint64_t vAddr, UVMDataSize size, uint8_t perm);
+
+    /**
+     * Reads a value of a fixed size from virtual memory with at least read
+     * permission. The value has to lie inside a single memory buffer and is
+     * moved with a single fixed size copy.
+     * @param vAddr Source virtual address
+     * @param val [out] Read value
+     * @param perm Required permissions of memory section
+     * @return On success returns UVM_SUCCESS otherwise error state
+     * [E_VADDR_NOT_FOUND, E_MISSING_PERM]
+     */
+    template <typename T>
+    inline uint32_t load(uint64_t vAddr, T& val, uint8_t perm = 0) {
+        perm |= PERM_READ_MASK;
+        const TLBEntry* entry = translate(vAddr, sizeof(T));
+        if (entry == nullptr) {
+            return E_VADDR_NOT_FOUND;
+        }
+        if ((entry->Perm & perm) != perm) {
+            return E_MISSING_PERM;
+        }
+
+        std::memcpy(&val, entry->Host + (vAddr - entry->VStartAddr), sizeof(T));
+        return UVM_SUCCESS;
+    }
+
+    /**
+     * Writes a value of a fixed size to virtual memory with at least write
+     * permission. The value has to lie inside a single memory buffer and is
+     * moved with a single fixed size copy.
+     * @param vAddr Destination virtual address
+     * @param val Value to write
+     * @param perm Required permissions of memory section
+     * @return On success returns UVM_SUCCESS otherwise error state
+     * [E_VADDR_NOT_FOUND, E_MISSING_PERM]
+     */
+    template <typename T>
+    inline uint32_t store(uint64_t vAddr, T val, uint8_t perm = 0) {
+        perm |= PERM_WRITE_MASK;
+        const TLBEntry* entry = translate(vAddr, sizeof(T));
+        if (entry == nullptr) {
+            return E_VADDR_NOT_FOUND;
+        }
+        if ((entry->Perm & perm) != perm) {
+            return E_MISSING_PERM;
+        }
+
+        std::memcpy(entry->Host + (vAddr - entry->VStartAddr), &val, sizeof(T));
+        logWrite(vAddr, sizeof(T));
+        return UVM_SUCCESS;
+    }
+
     uint32_t readLarge(uint64_t vAddr, void* dest, uint32_t size, uint8_t perm);
     uint32_t writeLarge(void* src, uint64_t vAddr, uint32_t size, uint8_t perm);
+    uint32_t resolveRange(uint64_t vAddr,
+                          uint32_t size,
+                          uint8_t perm,
+                          std::vector<MemSpan>& spans);
     uint32_t fetchInstruction(uint8_t* dest, size_t size);
+    uint32_t fetchInstruction(uint64_t vAddr, uint8_t* dest, size_t size);
     uint32_t
     addBuffer(uint64_t vAddr, uint32_t size, MemType type, uint8_t perm);
     void initStack();
@@ -178,14 +498,105 @@ struct MemManager {
     uint32_t setBasePtr(uint64_t vAddr);
     uint32_t stackPush(void* val, UVMDataSize size);
     uint32_t stackPop(uint64_t* out, UVMDataSize size);
+    uint32_t pushReturnAddr(uint64_t returnIP);
+    uint32_t popReturnAddr(uint64_t* returnIP);
     uint32_t setIntReg(uint8_t id, IntVal val, IntType type);
     uint32_t setFloatReg(uint8_t id, FloatVal val, FloatType type);
-    uint32_t getIntReg(uint8_t id, IntVal& val);
-    uint32_t getFloatReg(uint8_t id, FloatVal& val);
+
+    /**
+     * Gets an integer register value if input is valid
+     * @param id Target register id
+     * @param val [out] Integer value
+     * @return On success returns UVM_SUCCESS otherwise error code
+     */
+    inline uint32_t getIntReg(uint8_t id, IntVal& val) const {
+        if (id == 0 || id == REG_FLAGS || id >= REG_FILE_SIZE) {
+            return E_INVALID_SRC_REG;
+        }
+        if (id >= REG_FP_START) {
+            return E_INVALID_TYPE;
+        }
+        val.I64 = Regs[id].I64;
+        return UVM_SUCCESS;
+    }
+
+    /**
+     * Gets a float register value if input is valid
+     * @param id Target register id
+     * @param val [out] Float value
+     * @return On success returns UVM_SUCCESS otherwise error code
+     */
+    inline uint32_t getFloatReg(uint8_t id, FloatVal& val) const {
+        if (id == 0 || id == REG_FLAGS || id >= REG_FILE_SIZE) {
+            return E_INVALID_SRC_REG;
+        }
+        if (id < REG_FP_START) {
+            return E_INVALID_TYPE;
+        }
+        val.F64 = Regs[id].F64;
+        return UVM_SUCCESS;
+    }
+
+    /**
+     * Records a successful memory write for the tracer, empty ranges are
+     * ignored
+     * @param vAddr Virtual start address of the written range
+     * @param size Size of the written range in bytes
+     */
+    inline void logWrite(uint64_t vAddr, uint32_t size) {
+        if (size == 0) {
+            return;
+        }
+        if (WriteCount < WRITE_LOG_SIZE) {
+            WriteLog[WriteCount] = {vAddr, size};
+        }
+        WriteCount++;
+    }
+
+    /**
+     * Gets a vector register if input is valid
+     * @param id Target register id
+     * @return On success returns the register otherwise nullptr
+     */
+    inline VecVal* getVecReg(uint8_t id) {
+        if (id < REG_VEC_START || id > REG_VEC_END) {
+            return nullptr;
+        }
+        return &VecRegs[id - REG_VEC_START];
+    }
     bool evalRegOffset(uint8_t* buff, uint64_t* address);
-    uint64_t allocHeap(size_t size);
+    uint64_t allocHeap(size_t size, uint32_t* status = nullptr);
     uint32_t deallocHeap(uint64_t vAddr);
+    uint64_t addFileMapping(const FileMapping& mapping);
+    uint32_t removeFileMapping(uint64_t vAddr);
     void loadSections(uint8_t* buff, size_t size);
+    MemUsage usage() const;
+};
+
+/**
+ * Walks a virtual memory range which may span multiple memory buffers as host
+ * memory spans in address order. Every span covers as much of a single buffer
+ * as possible. Iteration stops at the end of the range or at the first
+ * address which is not mapped or misses a permission, Status tells both apart.
+ */
+struct MemSpanIterator {
+    /** Memory manager of the range */
+    MemManager& MMU;
+    /** Virtual address of the next span */
+    uint64_t Cursor = 0;
+    /** Virtual end address of the range (exclusive) */
+    uint64_t End = 0;
+    /** Required permissions of every memory buffer in the range */
+    uint8_t Perm = 0;
+    /** UVM_SUCCESS or the error which stopped the iteration
+     * [E_VADDR_NOT_FOUND, E_MISSING_PERM] */
+    uint32_t Status = UVM_SUCCESS;
+
+    MemSpanIterator(MemManager& mmu,
+                    uint64_t vAddr,
+                    uint64_t size,
+                    uint8_t perm);
+    bool next(MemSpan& span);
 };
 
 bool parseIntType(uint8_t type, IntType* intType);
@@ -0,0 +1,284 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "../async_io.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+// The ring is driven through the raw system calls, so there is no dependency
+// on liburing. Kernels without io_uring or without IORING_OP_READ and
+// IORING_OP_WRITE make openAsyncRing() fail and the thread pool is used.
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+
+/** Mapped submission and completion queues of an io_uring instance */
+struct AsyncRing {
+    /** Ring file descriptor */
+    int Fd = -1;
+    /** Submission queue ring */
+    void* SqRing = MAP_FAILED;
+    size_t SqRingSize = 0;
+    /** Completion queue ring */
+    void* CqRing = MAP_FAILED;
+    size_t CqRingSize = 0;
+    /** Submission queue entries */
+    void* Sqes = MAP_FAILED;
+    size_t SqesSize = 0;
+    /** Fields of the submission queue ring */
+    unsigned* SqTail = nullptr;
+    unsigned* SqMask = nullptr;
+    unsigned* SqArray = nullptr;
+    /** Fields of the completion queue ring */
+    unsigned* CqHead = nullptr;
+    unsigned* CqTail = nullptr;
+    unsigned* CqMask = nullptr;
+    io_uring_cqe* Cqes = nullptr;
+};
+
+/**
+ * Submits and waits for ring entries
+ * @param fd Ring file descriptor
+ * @param toSubmit Number of new submission queue entries
+ * @param minComplete Number of completions to wait for
+ * @param flags IORING_ENTER_* flags
+ * @return Number of consumed entries or -1
+ */
+static int
+enterRing(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit,
+                                    minComplete, flags, nullptr, 0));
+}
+
+/**
+ * Checks if the kernel supports the read and write operations
+ * @param fd Ring file descriptor
+ * @return True if both operations are supported
+ */
+static bool probeRing(int fd) {
+    constexpr size_t PROBE_OPS = 256;
+    std::vector<uint8_t> buffer(sizeof(io_uring_probe) +
+                                PROBE_OPS * sizeof(io_uring_probe_op));
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe,
+                PROBE_OPS) < 0) {
+        return false;
+    }
+
+    for (uint8_t op : {IORING_OP_READ, IORING_OP_WRITE}) {
+        if (op > probe->last_op ||
+            (probe->ops[op].flags & IO_URING_OP_SUPPORTED) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Sets up an io_uring instance
+ * @param entries Number of submission queue entries
+ * @return On success returns the ring otherwise nullptr
+ */
+AsyncRing* openAsyncRing(uint32_t entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    AsyncRing* ring = new AsyncRing();
+    ring->Fd = fd;
+    if (!probeRing(fd)) {
+        closeAsyncRing(ring);
+        return nullptr;
+    }
+
+    ring->SqRingSize =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->CqRingSize =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    ring->SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    ring->SqRing = mmap(nullptr, ring->SqRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    ring->CqRing = mmap(nullptr, ring->CqRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    ring->Sqes = mmap(nullptr, ring->SqesSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->SqRing == MAP_FAILED || ring->CqRing == MAP_FAILED ||
+        ring->Sqes == MAP_FAILED) {
+        closeAsyncRing(ring);
+        return nullptr;
+    }
+
+    uint8_t* sq = static_cast<uint8_t*>(ring->SqRing);
+    uint8_t* cq = static_cast<uint8_t*>(ring->CqRing);
+    ring->SqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->SqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->SqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring->CqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->CqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->CqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return ring;
+}
+
+/**
+ * Submits a request to the ring
+ * @param ring Ring
+ * @param request Request, its address is returned by reapAsyncRing()
+ * @return On success returns true otherwise false
+ */
+bool submitAsyncRing(AsyncRing* ring, AsyncRequest* request) {
+    unsigned tail = *ring->SqTail;
+    unsigned index = tail & *ring->SqMask;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(ring->Sqes) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = request->Write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = static_cast<int>(request->File);
+    sqe->addr =
+        reinterpret_cast<uint64_t>(request->Data.data() + request->Transferred);
+    sqe->len =
+        static_cast<uint32_t>(request->Data.size() - request->Transferred);
+    sqe->off = request->Offset + request->Transferred;
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+    ring->SqArray[index] = index;
+    __atomic_store_n(ring->SqTail, tail + 1, __ATOMIC_RELEASE);
+
+    int res = 0;
+    do {
+        res = enterRing(ring->Fd, 1, 0, 0);
+    } while (res < 0 && errno == EINTR);
+    if (res == 1) {
+        return true;
+    }
+
+    // The kernel did not take the entry
+    __atomic_store_n(ring->SqTail, tail, __ATOMIC_RELEASE);
+    return false;
+}
+
+/**
+ * Accounts a completion of a request. Short transfers are submitted again for
+ * the rest, like readHostFileAt() and writeHostFileAt() loop until done.
+ * @param ring Ring
+ * @param request Request of the completion
+ * @param res Result of the completion
+ * @return True if the request is done and Result is set
+ */
+static bool
+finishRingTransfer(AsyncRing* ring, AsyncRequest* request, int res) {
+    if (res < 0 && res != -EINTR && res != -EAGAIN) {
+        request->Result = -1;
+        return true;
+    }
+
+    if (res > 0) {
+        request->Transferred += static_cast<size_t>(res);
+    }
+    if (request->Transferred >= request->Data.size() || res == 0) {
+        // Reads end at the end of the file, writes cannot make progress
+        bool failed =
+            request->Write && request->Transferred < request->Data.size();
+        request->Result =
+            failed ? -1 : static_cast<int64_t>(request->Transferred);
+        return true;
+    }
+
+    if (!submitAsyncRing(ring, request)) {
+        request->Result = -1;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Takes a completed request from the ring
+ * @param ring Ring
+ * @param block Wait until a request completes
+ * @return Completed request or nullptr if there is none or the ring failed
+ */
+AsyncRequest* reapAsyncRing(AsyncRing* ring, bool block) {
+    while (true) {
+        unsigned head = *ring->CqHead;
+        if (head == __atomic_load_n(ring->CqTail, __ATOMIC_ACQUIRE)) {
+            if (!block) {
+                return nullptr;
+            }
+            if (enterRing(ring->Fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+                errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return nullptr;
+            }
+            continue;
+        }
+
+        io_uring_cqe* cqe = &ring->Cqes[head & *ring->CqMask];
+        AsyncRequest* request = reinterpret_cast<AsyncRequest*>(cqe->user_data);
+        int res = cqe->res;
+        __atomic_store_n(ring->CqHead, head + 1, __ATOMIC_RELEASE);
+        if (finishRingTransfer(ring, request, res)) {
+            return request;
+        }
+    }
+}
+
+/**
+ * Unmaps the queues and closes the ring
+ * @param ring Ring
+ */
+void closeAsyncRing(AsyncRing* ring) {
+    if (ring->Sqes != MAP_FAILED) {
+        munmap(ring->Sqes, ring->SqesSize);
+    }
+    if (ring->CqRing != MAP_FAILED) {
+        munmap(ring->CqRing, ring->CqRingSize);
+    }
+    if (ring->SqRing != MAP_FAILED) {
+        munmap(ring->SqRing, ring->SqRingSize);
+    }
+    close(ring->Fd);
+    delete ring;
+}
+
+#else
+
+// The system headers lack the io_uring system calls, AsyncIO always uses its
+// thread pool
+
+struct AsyncRing {};
+
+AsyncRing* openAsyncRing(uint32_t entries) {
+    return nullptr;
+}
+
+bool submitAsyncRing(AsyncRing* ring, AsyncRequest* request) {
+    return false;
+}
+
+AsyncRequest* reapAsyncRing(AsyncRing* ring, bool block) {
+    return nullptr;
+}
+
+void closeAsyncRing(AsyncRing* ring) {
+    delete ring;
+}
+
+#endif
@@ -0,0 +1,278 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "../file_io.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Gets the standard input
+ * @return Host file of the standard input
+ */
+HostFile getStdinFile() {
+    return STDIN_FILENO;
+}
+
+/**
+ * Performs a single read, which may return less than size bytes before the
+ * file ends
+ * @param file Host file
+ * @param dest Destination buffer of at least size bytes
+ * @param size Maximum number of bytes to read
+ * @return On success returns the number of bytes read otherwise -1
+ */
+int64_t readHostFileOnce(HostFile file, void* dest, size_t size) {
+    ssize_t res = 0;
+    do {
+        res = read(static_cast<int>(file), dest, size);
+    } while (res < 0 && errno == EINTR);
+    return res;
+}
+
+/**
+ * Opens a host file
+ * @param path Path of the file
+ * @param mode Combination of FILE_MODE_* flags
+ * @return On success returns the host file otherwise INVALID_HOST_FILE
+ */
+HostFile openHostFile(const std::filesystem::path& path, uint32_t mode) {
+    int flags = 0;
+    bool canRead = (mode & FILE_MODE_READ) != 0;
+    bool canWrite = (mode & (FILE_MODE_WRITE | FILE_MODE_APPEND)) != 0;
+    if (canRead && canWrite) {
+        flags = O_RDWR;
+    } else if (canWrite) {
+        flags = O_WRONLY;
+    } else if (canRead) {
+        flags = O_RDONLY;
+    } else {
+        return INVALID_HOST_FILE;
+    }
+
+    if ((mode & FILE_MODE_CREATE) != 0) {
+        flags |= O_CREAT;
+    }
+    if ((mode & FILE_MODE_TRUNCATE) != 0) {
+        flags |= O_TRUNC;
+    }
+    if ((mode & FILE_MODE_APPEND) != 0) {
+        flags |= O_APPEND;
+    }
+
+    int fd = open(path.c_str(), flags | O_CLOEXEC, 0644);
+    return fd < 0 ? INVALID_HOST_FILE : fd;
+}
+
+/**
+ * Reads from a host file until the size is reached or the file ends
+ * @param file Host file
+ * @param dest Destination buffer of at least size bytes
+ * @param size Number of bytes to read
+ * @return On success returns the number of bytes read otherwise -1
+ */
+int64_t readHostFile(HostFile file, void* dest, size_t size) {
+    int fd = static_cast<int>(file);
+    uint8_t* cursor = static_cast<uint8_t*>(dest);
+    size_t total = 0;
+    while (total < size) {
+        ssize_t res = read(fd, cursor + total, size - total);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res < 0) {
+            return -1;
+        }
+        if (res == 0) {
+            break;
+        }
+        total += static_cast<size_t>(res);
+    }
+    return static_cast<int64_t>(total);
+}
+
+/**
+ * Writes a buffer to a host file
+ * @param file Host file
+ * @param src Source buffer of at least size bytes
+ * @param size Number of bytes to write
+ * @return On success returns the number of bytes written otherwise -1
+ */
+int64_t writeHostFile(HostFile file, const void* src, size_t size) {
+    int fd = static_cast<int>(file);
+    const uint8_t* cursor = static_cast<const uint8_t*>(src);
+    size_t total = 0;
+    while (total < size) {
+        ssize_t res = write(fd, cursor + total, size - total);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return -1;
+        }
+        total += static_cast<size_t>(res);
+    }
+    return static_cast<int64_t>(total);
+}
+
+/**
+ * Reads from a host file at an offset until the size is reached or the file
+ * ends. The file position is not changed.
+ * @param file Host file
+ * @param dest Destination buffer of at least size bytes
+ * @param size Number of bytes to read
+ * @param offset File offset
+ * @return On success returns the number of bytes read otherwise -1
+ */
+int64_t
+readHostFileAt(HostFile file, void* dest, size_t size, uint64_t offset) {
+    int fd = static_cast<int>(file);
+    uint8_t* cursor = static_cast<uint8_t*>(dest);
+    size_t total = 0;
+    while (total < size) {
+        ssize_t res = pread(fd, cursor + total, size - total,
+                            static_cast<off_t>(offset + total));
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res < 0) {
+            return -1;
+        }
+        if (res == 0) {
+            break;
+        }
+        total += static_cast<size_t>(res);
+    }
+    return static_cast<int64_t>(total);
+}
+
+/**
+ * Writes a buffer to a host file at an offset. The file position is not
+ * changed.
+ * @param file Host file
+ * @param src Source buffer of at least size bytes
+ * @param size Number of bytes to write
+ * @param offset File offset
+ * @return On success returns the number of bytes written otherwise -1
+ */
+int64_t
+writeHostFileAt(HostFile file, const void* src, size_t size, uint64_t offset) {
+    int fd = static_cast<int>(file);
+    const uint8_t* cursor = static_cast<const uint8_t*>(src);
+    size_t total = 0;
+    while (total < size) {
+        ssize_t res = pwrite(fd, cursor + total, size - total,
+                             static_cast<off_t>(offset + total));
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return -1;
+        }
+        total += static_cast<size_t>(res);
+    }
+    return static_cast<int64_t>(total);
+}
+
+/**
+ * Moves the position of a host file
+ * @param file Host file
+ * @param offset Offset relative to the origin
+ * @param origin One of FILE_SEEK_*
+ * @return On success returns the new position otherwise -1
+ */
+int64_t seekHostFile(HostFile file, int64_t offset, uint32_t origin) {
+    int whence = 0;
+    switch (origin) {
+    case FILE_SEEK_SET:
+        whence = SEEK_SET;
+        break;
+    case FILE_SEEK_CUR:
+        whence = SEEK_CUR;
+        break;
+    case FILE_SEEK_END:
+        whence = SEEK_END;
+        break;
+    default:
+        return -1;
+    }
+    return lseek(static_cast<int>(file), offset, whence);
+}
+
+/**
+ * Closes a host file
+ * @param file Host file
+ * @return On success returns true otherwise false
+ */
+bool closeHostFile(HostFile file) {
+    return close(static_cast<int>(file)) == 0;
+}
+
+/**
+ * Maps a range of a host file read only into memory. The range has to lie
+ * inside of the file.
+ * @param file Host file
+ * @param offset File offset of the range
+ * @param size Size of the range, 0 maps until the end of the file
+ * @param mapping Output mapping
+ * @return On success returns true otherwise false
+ */
+bool mapHostFile(HostFile file,
+                 uint64_t offset,
+                 uint64_t size,
+                 FileMapping& mapping) {
+    int fd = static_cast<int>(file);
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        return false;
+    }
+
+    uint64_t fileSize = static_cast<uint64_t>(info.st_size);
+    if (offset > fileSize) {
+        return false;
+    }
+    if (size == 0) {
+        size = fileSize - offset;
+    }
+    if (size == 0 || size > fileSize - offset) {
+        return false;
+    }
+
+    uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t alignedOffset = offset - offset % pageSize;
+    size_t baseSize = static_cast<size_t>(size + (offset - alignedOffset));
+    void* base = mmap(nullptr, baseSize, PROT_READ, MAP_PRIVATE, fd,
+                      static_cast<off_t>(alignedOffset));
+    if (base == MAP_FAILED) {
+        return false;
+    }
+
+    mapping.Base = base;
+    mapping.BaseSize = baseSize;
+    mapping.Data = static_cast<uint8_t*>(base) + (offset - alignedOffset);
+    mapping.Size = size;
+    return true;
+}
+
+/**
+ * Unmaps a host file mapping
+ * @param mapping Mapping created by mapHostFile()
+ */
+void unmapHostFile(const FileMapping& mapping) {
+    munmap(mapping.Base, mapping.BaseSize);
+}
@@ -15,9 +15,12 @@
 // ======================================================================== //
 
 #include "../debug/http.hpp"
+#include <csignal>
+#include <cstdio>
 #include <iostream>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 /**
@@ -27,6 +30,9 @@
 bool HTTPServer::startup() {
     uint16_t portNr = atoi(PORT);
 
+    // A client closing its connection early must not terminate the server
+    signal(SIGPIPE, SIG_IGN);
+
     sockaddr_in sin;
     memset(&sin, 0, sizeof(sin));
 
@@ -89,20 +95,127 @@ void HTTPServer::listenLoop(RequestParser& rq) {
 }
 
 /**
- * Sends a request to the current client socket
- * @param stream Message content
+ * Writes all given buffers to a socket, retrying after partial writes
+ * @param sock Target socket
+ * @param parts Buffers to send, modified while sending
+ * @param count Number of buffers
+ * @return On success returns true otherwise false
  */
-void HTTPServer::sendReq(std::ostream& stream) {
-    std::stringstream ss;
-    ss << stream.rdbuf();
-    std::string string = ss.str();
-
-    uint32_t sendResult = 0;
-    sendResult = write(UnixClientSock, string.c_str(), string.length());
-    if (sendResult < 0) {
-        std::cout << "Error sending failed\n";
-        return;
+static bool writeAll(uint32_t sock, iovec* parts, size_t count) {
+    size_t partIndex = 0;
+    while (partIndex < count) {
+        ssize_t sendResult = writev(sock, &parts[partIndex],
+                                    static_cast<int>(count - partIndex));
+        if (sendResult < 0) {
+            std::cout << "Error sending failed\n";
+            return false;
+        }
+
+        // Advance past everything the kernel accepted in case of a partial
+        // write
+        size_t sent = static_cast<size_t>(sendResult);
+        while (partIndex < count && sent >= parts[partIndex].iov_len) {
+            sent -= parts[partIndex].iov_len;
+            partIndex++;
+        }
+        if (partIndex < count) {
+            parts[partIndex].iov_base =
+                static_cast<uint8_t*>(parts[partIndex].iov_base) + sent;
+            parts[partIndex].iov_len -= sent;
+        }
     }
+
+    return true;
+}
+
+/**
+ * Sends a response to a client socket. Header and body are handed to the
+ * kernel together with a single writev call.
+ * @param sock Target client socket
+ * @param res Response with already filled header buffer
+ */
+static void sendToSock(uint32_t sock, const Response& res) {
+    iovec parts[2];
+    parts[0].iov_base = const_cast<char*>(res.Head.data());
+    parts[0].iov_len = res.Head.size();
+    parts[1].iov_base = const_cast<uint8_t*>(res.Body.data());
+    parts[1].iov_len = res.Body.size();
+    writeAll(sock, parts, 2);
+}
+
+/**
+ * Sends a response to the current client socket
+ * @param res Response with already filled header buffer
+ */
+void HTTPServer::sendRes(const Response& res) {
+    sendToSock(UnixClientSock, res);
+}
+
+/**
+ * Keeps the current client socket open so it can be answered later with
+ * sendParked() while new requests are accepted
+ */
+void HTTPServer::parkClient() {
+    UnixParkedSock = UnixClientSock;
+    UnixClientSock = -1;
+}
+
+/**
+ * Sends a response to the parked client socket and closes it
+ * @param res Response with already filled header buffer
+ */
+void HTTPServer::sendParked(const Response& res) {
+    sendToSock(UnixParkedSock, res);
+    close(UnixParkedSock);
+    UnixParkedSock = -1;
+}
+
+/**
+ * Turns the current client socket into a stream socket. The response header
+ * is sent immediately and its body becomes the first chunk of the stream.
+ * @param res Response with Chunked set and already filled header buffer
+ */
+void HTTPServer::beginStream(const Response& res) {
+    UnixStreamSock = UnixClientSock;
+    UnixClientSock = -1;
+
+    iovec head;
+    head.iov_base = const_cast<char*>(res.Head.data());
+    head.iov_len = res.Head.size();
+    writeAll(UnixStreamSock, &head, 1);
+    sendChunk(res.Body.data(), res.Body.size());
+}
+
+/**
+ * Sends a chunk of data to the stream socket
+ * @param data Pointer to chunk data
+ * @param size Size of chunk in bytes, must not be 0
+ * @return On success returns true otherwise false
+ */
+bool HTTPServer::sendChunk(const void* data, size_t size) {
+    char sizeLine[20];
+    int sizeLineLen = snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", size);
+
+    iovec parts[3];
+    parts[0].iov_base = sizeLine;
+    parts[0].iov_len = static_cast<size_t>(sizeLineLen);
+    parts[1].iov_base = const_cast<void*>(data);
+    parts[1].iov_len = size;
+    parts[2].iov_base = const_cast<char*>("\r\n");
+    parts[2].iov_len = 2;
+    return writeAll(UnixStreamSock, parts, 3);
+}
+
+/**
+ * Sends the terminating chunk and closes the stream socket
+ */
+void HTTPServer::endStream() {
+    iovec last;
+    last.iov_base = const_cast<char*>("0\r\n\r\n");
+    last.iov_len = 5;
+    writeAll(UnixStreamSock, &last, 1);
+    close(UnixStreamSock);
+    UnixStreamSock = -1;
 }
 
 /**
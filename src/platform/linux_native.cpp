@@ -0,0 +1,101 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "../jit/aot.hpp"
+#include "../jit/code_cache.hpp"
+#include <cstdlib>
+#include <dlfcn.h>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+
+extern char** environ;
+
+/**
+ * Gets the per user cache directory, $XDG_CACHE_HOME or ~/.cache
+ * @return On success returns the directory otherwise an empty path
+ */
+std::filesystem::path getCacheHome() {
+    const char* xdgCache = std::getenv("XDG_CACHE_HOME");
+    if (xdgCache != nullptr && xdgCache[0] != '\0') {
+        return xdgCache;
+    }
+
+    const char* home = std::getenv("HOME");
+    if (home != nullptr && home[0] != '\0') {
+        return std::filesystem::path(home) / ".cache";
+    }
+    return {};
+}
+
+/**
+ * Loads a shared library
+ * @param path Path of the library
+ * @return On success returns the library handle otherwise nullptr
+ */
+void* openNativeLibrary(const std::filesystem::path& path) {
+    return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+}
+
+/**
+ * Looks up an exported symbol of a shared library
+ * @param library Library handle
+ * @param name Symbol name
+ * @return On success returns the symbol address otherwise nullptr
+ */
+void* findNativeSymbol(void* library, const char* name) {
+    return dlsym(library, name);
+}
+
+/**
+ * Unloads a shared library
+ * @param library Library handle
+ */
+void closeNativeLibrary(void* library) {
+    dlclose(library);
+}
+
+/**
+ * Compiles a C source file into a shared library with the system compiler,
+ * $CC or cc
+ * @param source Path of the C source file
+ * @param output Path of the shared library to write
+ * @return On success returns true otherwise false
+ */
+bool compileNativeLibrary(const std::filesystem::path& source,
+                          const std::filesystem::path& output) {
+    const char* cc = std::getenv("CC");
+    std::string compiler = cc != nullptr && cc[0] != '\0' ? cc : "cc";
+    std::string sourcePath = source.string();
+    std::string outputPath = output.string();
+
+    std::string args[] = {compiler, "-O2",        "-shared",  "-fPIC",
+                          "-o",     outputPath, sourcePath};
+    char* argv[] = {args[0].data(), args[1].data(), args[2].data(),
+                    args[3].data(), args[4].data(), args[5].data(),
+                    args[6].data(), nullptr};
+
+    pid_t pid = 0;
+    if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv, environ) != 0) {
+        return false;
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid) {
+        return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
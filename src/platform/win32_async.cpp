@@ -0,0 +1,58 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#include "../async_io.hpp"
+
+// There is no io_uring on Win32, AsyncIO always uses its thread pool
+
+struct AsyncRing {};
+
+/**
+ * Sets up an io_uring instance
+ * @param entries Number of submission queue entries
+ * @return Always nullptr
+ */
+AsyncRing* openAsyncRing(uint32_t entries) {
+    return nullptr;
+}
+
+/**
+ * Submits a request to the ring, never called
+ * @param ring Ring
+ * @param request Request
+ * @return Always false
+ */
+bool submitAsyncRing(AsyncRing* ring, AsyncRequest* request) {
+    return false;
+}
+
+/**
+ * Takes a completed request from the ring, never called
+ * @param ring Ring
+ * @param block Wait until a request completes
+ * @return Always nullptr
+ */
+AsyncRequest* reapAsyncRing(AsyncRing* ring, bool block) {
+    return nullptr;
+}
+
+/**
+ * Closes the ring, never called
+ * @param ring Ring
+ */
+void closeAsyncRing(AsyncRing* ring) {
+    delete ring;
+}
@@ -0,0 +1,45 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include "../clock.hpp"
+#include <windows.h>
+
+/**
+ * Reads the CPU time consumed by the calling thread
+ * @return Nanoseconds, 0 if the clock is not available
+ */
+uint64_t getThreadCpuNanos() {
+    FILETIME creation;
+    FILETIME exit;
+    FILETIME kernel;
+    FILETIME user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel,
+                        &user)) {
+        return 0;
+    }
+
+    // FILETIME counts 100 ns intervals
+    uint64_t kernelTime =
+        (static_cast<uint64_t>(kernel.dwHighDateTime) << 32) |
+        kernel.dwLowDateTime;
+    uint64_t userTime =
+        (static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+    return (kernelTime + userTime) * 100;
+}
@@ -0,0 +1,316 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include "../file_io.hpp"
+#include <windows.h>
+
+/**
+ * Converts a host file to a Win32 handle
+ * @param file Host file
+ * @return Win32 handle
+ */
+static HANDLE toHandle(HostFile file) {
+    return reinterpret_cast<HANDLE>(file);
+}
+
+/**
+ * Gets the standard input
+ * @return Host file of the standard input
+ */
+HostFile getStdinFile() {
+    return reinterpret_cast<HostFile>(GetStdHandle(STD_INPUT_HANDLE));
+}
+
+/**
+ * Performs a single read, which may return less than size bytes before the
+ * file ends
+ * @param file Host file
+ * @param dest Destination buffer of at least size bytes
+ * @param size Maximum number of bytes to read
+ * @return On success returns the number of bytes read otherwise -1
+ */
+int64_t readHostFileOnce(HostFile file, void* dest, size_t size) {
+    DWORD chunk = size > MAXDWORD ? MAXDWORD : static_cast<DWORD>(size);
+    DWORD res = 0;
+    if (!ReadFile(toHandle(file), dest, chunk, &res, nullptr)) {
+        // The writing end of a pipe was closed
+        return GetLastError() == ERROR_BROKEN_PIPE ? 0 : -1;
+    }
+    return res;
+}
+
+/**
+ * Opens a host file
+ * @param path Path of the file
+ * @param mode Combination of FILE_MODE_* flags
+ * @return On success returns the host file otherwise INVALID_HOST_FILE
+ */
+HostFile openHostFile(const std::filesystem::path& path, uint32_t mode) {
+    DWORD access = 0;
+    if ((mode & FILE_MODE_READ) != 0) {
+        access |= GENERIC_READ;
+    }
+    if ((mode & FILE_MODE_APPEND) != 0) {
+        access |= FILE_APPEND_DATA;
+    } else if ((mode & FILE_MODE_WRITE) != 0) {
+        access |= GENERIC_WRITE;
+    }
+    if (access == 0) {
+        return INVALID_HOST_FILE;
+    }
+
+    bool create = (mode & FILE_MODE_CREATE) != 0;
+    bool truncate = (mode & FILE_MODE_TRUNCATE) != 0;
+    DWORD disposition = OPEN_EXISTING;
+    if (create && truncate) {
+        disposition = CREATE_ALWAYS;
+    } else if (create) {
+        disposition = OPEN_ALWAYS;
+    } else if (truncate) {
+        disposition = TRUNCATE_EXISTING;
+    }
+
+    HANDLE handle = CreateFileW(path.c_str(), access,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return INVALID_HOST_FILE;
+    }
+    return reinterpret_cast<HostFile>(handle);
+}
+
+/**
+ * Reads from a host file until the size is reached or the file ends
+ * @param file Host file
+ * @param dest Destination buffer of at least size bytes
+ * @param size Number of bytes to read
+ * @return On success returns the number of bytes read otherwise -1
+ */
+int64_t readHostFile(HostFile file, void* dest, size_t size) {
+    uint8_t* cursor = static_cast<uint8_t*>(dest);
+    size_t total = 0;
+    while (total < size) {
+        size_t left = size - total;
+        DWORD chunk = left > MAXDWORD ? MAXDWORD : static_cast<DWORD>(left);
+        DWORD res = 0;
+        if (!ReadFile(toHandle(file), cursor + total, chunk, &res, nullptr)) {
+            return -1;
+        }
+        if (res == 0) {
+            break;
+        }
+        total += res;
+    }
+    return static_cast<int64_t>(total);
+}
+
+/**
+ * Writes a buffer to a host file
+ * @param file Host file
+ * @param src Source buffer of at least size bytes
+ * @param size Number of bytes to write
+ * @return On success returns the number of bytes written otherwise -1
+ */
+int64_t writeHostFile(HostFile file, const void* src, size_t size) {
+    const uint8_t* cursor = static_cast<const uint8_t*>(src);
+    size_t total = 0;
+    while (total < size) {
+        size_t left = size - total;
+        DWORD chunk = left > MAXDWORD ? MAXDWORD : static_cast<DWORD>(left);
+        DWORD res = 0;
+        if (!WriteFile(toHandle(file), cursor + total, chunk, &res, nullptr) ||
+            res == 0) {
+            return -1;
+        }
+        total += res;
+    }
+    return static_cast<int64_t>(total);
+}
+
+/**
+ * Reads from a host file at an offset until the size is reached or the file
+ * ends. Moves the file position like every synchronous Win32 read.
+ * @param file Host file
+ * @param dest Destination buffer of at least size bytes
+ * @param size Number of bytes to read
+ * @param offset File offset
+ * @return On success returns the number of bytes read otherwise -1
+ */
+int64_t
+readHostFileAt(HostFile file, void* dest, size_t size, uint64_t offset) {
+    uint8_t* cursor = static_cast<uint8_t*>(dest);
+    size_t total = 0;
+    while (total < size) {
+        size_t left = size - total;
+        DWORD chunk = left > MAXDWORD ? MAXDWORD : static_cast<DWORD>(left);
+        OVERLAPPED position = {};
+        position.Offset = static_cast<DWORD>(offset + total);
+        position.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+        DWORD res = 0;
+        if (!ReadFile(toHandle(file), cursor + total, chunk, &res,
+                      &position)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) {
+                break;
+            }
+            return -1;
+        }
+        if (res == 0) {
+            break;
+        }
+        total += res;
+    }
+    return static_cast<int64_t>(total);
+}
+
+/**
+ * Writes a buffer to a host file at an offset. Moves the file position like
+ * every synchronous Win32 write.
+ * @param file Host file
+ * @param src Source buffer of at least size bytes
+ * @param size Number of bytes to write
+ * @param offset File offset
+ * @return On success returns the number of bytes written otherwise -1
+ */
+int64_t
+writeHostFileAt(HostFile file, const void* src, size_t size, uint64_t offset) {
+    const uint8_t* cursor = static_cast<const uint8_t*>(src);
+    size_t total = 0;
+    while (total < size) {
+        size_t left = size - total;
+        DWORD chunk = left > MAXDWORD ? MAXDWORD : static_cast<DWORD>(left);
+        OVERLAPPED position = {};
+        position.Offset = static_cast<DWORD>(offset + total);
+        position.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+        DWORD res = 0;
+        if (!WriteFile(toHandle(file), cursor + total, chunk, &res,
+                       &position) ||
+            res == 0) {
+            return -1;
+        }
+        total += res;
+    }
+    return static_cast<int64_t>(total);
+}
+
+/**
+ * Moves the position of a host file
+ * @param file Host file
+ * @param offset Offset relative to the origin
+ * @param origin One of FILE_SEEK_*
+ * @return On success returns the new position otherwise -1
+ */
+int64_t seekHostFile(HostFile file, int64_t offset, uint32_t origin) {
+    DWORD method = 0;
+    switch (origin) {
+    case FILE_SEEK_SET:
+        method = FILE_BEGIN;
+        break;
+    case FILE_SEEK_CUR:
+        method = FILE_CURRENT;
+        break;
+    case FILE_SEEK_END:
+        method = FILE_END;
+        break;
+    default:
+        return -1;
+    }
+
+    LARGE_INTEGER distance;
+    distance.QuadPart = offset;
+    LARGE_INTEGER position;
+    if (!SetFilePointerEx(toHandle(file), distance, &position, method)) {
+        return -1;
+    }
+    return position.QuadPart;
+}
+
+/**
+ * Closes a host file
+ * @param file Host file
+ * @return On success returns true otherwise false
+ */
+bool closeHostFile(HostFile file) {
+    return CloseHandle(toHandle(file)) != 0;
+}
+
+/**
+ * Maps a range of a host file read only into memory. The range has to lie
+ * inside of the file.
+ * @param file Host file
+ * @param offset File offset of the range
+ * @param size Size of the range, 0 maps until the end of the file
+ * @param mapping Output mapping
+ * @return On success returns true otherwise false
+ */
+bool mapHostFile(HostFile file,
+                 uint64_t offset,
+                 uint64_t size,
+                 FileMapping& mapping) {
+    LARGE_INTEGER info;
+    if (!GetFileSizeEx(toHandle(file), &info)) {
+        return false;
+    }
+
+    uint64_t fileSize = static_cast<uint64_t>(info.QuadPart);
+    if (offset > fileSize) {
+        return false;
+    }
+    if (size == 0) {
+        size = fileSize - offset;
+    }
+    if (size == 0 || size > fileSize - offset) {
+        return false;
+    }
+
+    HANDLE fileMapping = CreateFileMappingW(toHandle(file), nullptr,
+                                            PAGE_READONLY, 0, 0, nullptr);
+    if (fileMapping == nullptr) {
+        return false;
+    }
+
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    uint64_t granularity = sysInfo.dwAllocationGranularity;
+    uint64_t alignedOffset = offset - offset % granularity;
+    size_t baseSize = static_cast<size_t>(size + (offset - alignedOffset));
+    void* base = MapViewOfFile(fileMapping, FILE_MAP_READ,
+                               static_cast<DWORD>(alignedOffset >> 32),
+                               static_cast<DWORD>(alignedOffset), baseSize);
+
+    // The view keeps the file mapping object alive
+    CloseHandle(fileMapping);
+    if (base == nullptr) {
+        return false;
+    }
+
+    mapping.Base = base;
+    mapping.BaseSize = baseSize;
+    mapping.Data = static_cast<uint8_t*>(base) + (offset - alignedOffset);
+    mapping.Size = size;
+    return true;
+}
+
+/**
+ * Unmaps a host file mapping
+ * @param mapping Mapping created by mapHostFile()
+ */
+void unmapHostFile(const FileMapping& mapping) {
+    UnmapViewOfFile(mapping.Base);
+}
@@ -19,6 +19,7 @@
 #endif
 
 #include "../debug/http.hpp"
+#include <cstdio>
 #include <iostream>
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -135,25 +136,110 @@ void HTTPServer::listenLoop(RequestParser& rq) {
 }
 
 /**
- * Sends a request to the current client socket
- * @param stream Message content
+ * Sends a response to a client socket. Header and body are handed to the
+ * kernel together with a single WSASend call.
+ * @param sock Target client socket
+ * @param res Response with already filled header buffer
  */
-void HTTPServer::sendReq(std::ostream& stream) {
-    std::stringstream ss;
-    ss << stream.rdbuf();
-    std::string string = ss.str();
-
-    uint32_t sendResult = 0;
-    sendResult = send(reinterpret_cast<SOCKET>(ClientSock), string.c_str(),
-                      string.length(), 0);
+static void sendToSock(uint64_t* sock, const Response& res) {
+    WSABUF parts[2];
+    parts[0].buf = const_cast<char*>(res.Head.data());
+    parts[0].len = static_cast<ULONG>(res.Head.size());
+    parts[1].buf =
+        reinterpret_cast<char*>(const_cast<uint8_t*>(res.Body.data()));
+    parts[1].len = static_cast<ULONG>(res.Body.size());
+
+    DWORD sent = 0;
+    uint32_t sendResult = WSASend(reinterpret_cast<SOCKET>(sock), parts, 2,
+                                  &sent, 0, nullptr, nullptr);
     if (sendResult == SOCKET_ERROR) {
         std::cout << "Error [" << WSAGetLastError() << "]: sending failed\n";
-        closesocket(reinterpret_cast<SOCKET>(ClientSock));
+        closesocket(reinterpret_cast<SOCKET>(sock));
         WSACleanup();
         return;
     }
 }
 
+/**
+ * Sends a response to the current client socket
+ * @param res Response with already filled header buffer
+ */
+void HTTPServer::sendRes(const Response& res) {
+    sendToSock(ClientSock, res);
+}
+
+/**
+ * Keeps the current client socket open so it can be answered later with
+ * sendParked() while new requests are accepted
+ */
+void HTTPServer::parkClient() {
+    ParkedSock = ClientSock;
+    ClientSock = reinterpret_cast<uint64_t*>(INVALID_SOCKET);
+}
+
+/**
+ * Sends a response to the parked client socket and closes it
+ * @param res Response with already filled header buffer
+ */
+void HTTPServer::sendParked(const Response& res) {
+    sendToSock(ParkedSock, res);
+    shutdown(reinterpret_cast<SOCKET>(ParkedSock), SD_SEND);
+    closesocket(reinterpret_cast<SOCKET>(ParkedSock));
+    ParkedSock = reinterpret_cast<uint64_t*>(INVALID_SOCKET);
+}
+
+/**
+ * Turns the current client socket into a stream socket. The response header
+ * is sent immediately and its body becomes the first chunk of the stream.
+ * @param res Response with Chunked set and already filled header buffer
+ */
+void HTTPServer::beginStream(const Response& res) {
+    StreamSock = ClientSock;
+    ClientSock = reinterpret_cast<uint64_t*>(INVALID_SOCKET);
+
+    send(reinterpret_cast<SOCKET>(StreamSock), res.Head.data(),
+         static_cast<int>(res.Head.size()), 0);
+    sendChunk(res.Body.data(), res.Body.size());
+}
+
+/**
+ * Sends a chunk of data to the stream socket
+ * @param data Pointer to chunk data
+ * @param size Size of chunk in bytes, must not be 0
+ * @return On success returns true otherwise false
+ */
+bool HTTPServer::sendChunk(const void* data, size_t size) {
+    char sizeLine[20];
+    int sizeLineLen = snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", size);
+
+    WSABUF parts[3];
+    parts[0].buf = sizeLine;
+    parts[0].len = static_cast<ULONG>(sizeLineLen);
+    parts[1].buf = static_cast<char*>(const_cast<void*>(data));
+    parts[1].len = static_cast<ULONG>(size);
+    parts[2].buf = const_cast<char*>("\r\n");
+    parts[2].len = 2;
+
+    DWORD sent = 0;
+    uint32_t sendResult = WSASend(reinterpret_cast<SOCKET>(StreamSock), parts,
+                                  3, &sent, 0, nullptr, nullptr);
+    if (sendResult == SOCKET_ERROR) {
+        std::cout << "Error [" << WSAGetLastError() << "]: sending failed\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Sends the terminating chunk and closes the stream socket
+ */
+void HTTPServer::endStream() {
+    send(reinterpret_cast<SOCKET>(StreamSock), "0\r\n\r\n", 5, 0);
+    shutdown(reinterpret_cast<SOCKET>(StreamSock), SD_SEND);
+    closesocket(reinterpret_cast<SOCKET>(StreamSock));
+    StreamSock = reinterpret_cast<uint64_t*>(INVALID_SOCKET);
+}
+
 /**
  * Shutsdown server and closes listen socket
  */
@@ -0,0 +1,92 @@
+// ======================================================================== //
+// Copyright 2021 Michel Fäh
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ======================================================================== //
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include "../jit/aot.hpp"
+#include "../jit/code_cache.hpp"
+#include <cstdlib>
+#include <string>
+#include <windows.h>
+
+/**
+ * Gets the per user cache directory, %LOCALAPPDATA%
+ * @return On success returns the directory otherwise an empty path
+ */
+std::filesystem::path getCacheHome() {
+    const char* localAppData = std::getenv("LOCALAPPDATA");
+    if (localAppData != nullptr && localAppData[0] != '\0') {
+        return localAppData;
+    }
+    return {};
+}
+
+/**
+ * Loads a shared library
+ * @param path Path of the library
+ * @return On success returns the library handle otherwise nullptr
+ */
+void* openNativeLibrary(const std::filesystem::path& path) {
+    return LoadLibraryW(path.c_str());
+}
+
+/**
+ * Looks up an exported symbol of a shared library
+ * @param library Library handle
+ * @param name Symbol name
+ * @return On success returns the symbol address otherwise nullptr
+ */
+void* findNativeSymbol(void* library, const char* name) {
+    return reinterpret_cast<void*>(
+        GetProcAddress(static_cast<HMODULE>(library), name));
+}
+
+/**
+ * Unloads a shared library
+ * @param library Library handle
+ */
+void closeNativeLibrary(void* library) {
+    FreeLibrary(static_cast<HMODULE>(library));
+}
+
+/**
+ * Compiles a C source file into a DLL with cl.exe
+ * @param source Path of the C source file
+ * @param output Path of the DLL to write
+ * @return On success returns true otherwise false
+ */
+bool compileNativeLibrary(const std::filesystem::path& source,
+                          const std::filesystem::path& output) {
+    std::wstring command = L"cl.exe /nologo /O2 /LD \"" + source.wstring() +
+                           L"\" /Fe:\"" + output.wstring() + L"\"";
+
+    STARTUPINFOW startupInfo{};
+    startupInfo.cb = sizeof(startupInfo);
+    PROCESS_INFORMATION processInfo{};
+    if (!CreateProcessW(nullptr, command.data(), nullptr, nullptr, FALSE, 0,
+                        nullptr, nullptr, &startupInfo, &processInfo)) {
+        return false;
+    }
+
+    WaitForSingleObject(processInfo.hProcess, INFINITE);
+    DWORD exitCode = 1;
+    GetExitCodeProcess(processInfo.hProcess, &exitCode);
+    CloseHandle(processInfo.hThread);
+    CloseHandle(processInfo.hProcess);
+    return exitCode == 0;
+}
@@ -15,13 +15,33 @@
 // ======================================================================== //
 
 #include "uvm.hpp"
+#include "debug/tracer.hpp"
 #include "error.hpp"
 #include "instr/instructions.hpp"
+#include "jit/code_cache.hpp"
 #include "memory.hpp"
 #include <cstring>
 #include <fstream>
 #include <iostream>
 
+/** Supported UX file version */
+static constexpr uint8_t HEADER_VERSION = 1;
+
+/**
+ * Validates the mode of an UX file header
+ * @param mode Mode byte
+ * @return On supported mode returns true otherwise false
+ */
+static bool validateHeaderMode(uint8_t mode) {
+    switch (mode) {
+    case 0x1: // Release
+    case 0x2: // Debug
+        return true;
+    default:
+        return false;
+    }
+}
+
 /**
  * Validates UX file header
  * @param info Pointer to HeaderInfo struct to be filled out
@@ -49,7 +69,7 @@ bool validateHeader(HeaderInfo* info, uint8_t* source, size_t size) {
     // Check version
     constexpr uint64_t VERSION_OFFSET = 0x04;
     uint8_t version = source[VERSION_OFFSET];
-    if (version != 1) {
+    if (version != HEADER_VERSION) {
         std::cout << "[Error] Unsupported file version '" << (uint16_t)version
                   << "'\n";
         return false;
@@ -59,15 +79,11 @@ bool validateHeader(HeaderInfo* info, uint8_t* source, size_t size) {
     // Check mode
     constexpr uint64_t MODE_OFFSET = 0x05;
     uint8_t mode = source[MODE_OFFSET];
-    switch (mode) {
-    case 0x1: // Release
-    case 0x2: // Debug
-        info->Mode = mode;
-        break;
-    default:
+    if (!validateHeaderMode(mode)) {
         std::cout << "[Error] Unsupported mode '" << (uint16_t)mode << "'\n";
         return false;
     }
+    info->Mode = mode;
 
     // Validate start address
     constexpr uint64_t START_ADDR_OFFSET = 0x08;
@@ -248,6 +264,12 @@ void UVM::setFilePath(std::filesystem::path p) {
 bool UVM::init() {
     MMU.initStack();
 
+    // Sections and stack have to fit into the hard memory limit
+    uint64_t hardLimit = MMU.Quota.HardLimit;
+    if (hardLimit != 0 && MMU.usage().total() > hardLimit) {
+        return false;
+    }
+
     // Set the start address of the heap memory range
     MMU.VHeapStart = MMU.VStackEnd + 1;
 
@@ -261,7 +283,7 @@ bool UVM::init() {
         return false;
     }
 
-    MMU.IP = HInfo.StartAddress;
+    MMU.Regs[REG_INSTR_PTR].I64 = HInfo.StartAddress;
 
     return true;
 }
@@ -288,35 +310,177 @@ uint8_t* UVM::readSource(std::filesystem::path p, size_t* size) {
 }
 
 /**
- * Loads an UX source file and initializes it
+ * Loads an UX source file and initializes it. With the image cache enabled,
+ * files which were loaded before take their header and section table from the
+ * cache directory and get their hot loops traced right away. Digesting the file
+ * costs more than validating it, the cache only pays off by its loops.
  * @param buff Pointer to source buffer
  * @param size Size of source buffer
  * @return On success return UVM_SUCCESS otherwise non-zero value
  */
 uint32_t UVM::loadFile(uint8_t* buff, size_t size) {
-    bool validHeader = validateHeader(&HInfo, buff, size);
-    if (!validHeader) {
-        return E_INVALID_HEADER;
+    FileSize = size;
+    CachedImage image;
+    if (UseImageCache) {
+        Digest = digestContent(buff, size);
+        ImageCached = readCachedImage(Digest, FileSize, image) &&
+                      loadCachedImage(image, size);
     }
 
-    bool validSecTable = parseSectionTable(&MMU.Sections, buff, size);
-    if (!validSecTable) {
-        return E_INVALID_SEC_TABLE;
+    if (!ImageCached) {
+        bool validHeader = validateHeader(&HInfo, buff, size);
+        if (!validHeader) {
+            return E_INVALID_HEADER;
+        }
+
+        bool validSecTable = parseSectionTable(&MMU.Sections, buff, size);
+        if (!validSecTable) {
+            return E_INVALID_SEC_TABLE;
+        }
     }
 
     MMU.loadSections(buff, size);
 
+    if (ImageCached) {
+        for (const CachedLoop& loop : image.Loops) {
+            CachedLoopCount += LoopTraces.restore(this, loop.HeadIP, loop.Path);
+        }
+    }
+
     return UVM_SUCCESS;
 }
 
 /**
- * Fetches instruction until execution is stopped or an error occures
+ * Takes the header information and section table from a cached image. The
+ * header and sections are checked as validateHeader() and parseSectionTable()
+ * do, the sections are used to copy from the file buffer.
+ * @param image Cached image of the file
+ * @param size Size of source buffer
+ * @return On success returns true otherwise false
+ */
+bool UVM::loadCachedImage(const CachedImage& image, size_t size) {
+    if (image.Version != HEADER_VERSION || !validateHeaderMode(image.Mode) ||
+        image.StartAddress > size) {
+        return false;
+    }
+
+    for (const CachedSection& sec : image.Sections) {
+        auto memType = MemType::STATIC;
+        if (!parseSectionType(sec.Type, memType) ||
+            !validateSectionPermission(sec.Perm) || sec.VStartAddr > size ||
+            sec.Size > size - sec.VStartAddr) {
+            MMU.Sections.clear();
+            return false;
+        }
+        MMU.Sections.emplace_back(memType, sec.Perm, sec.VStartAddr,
+                                  sec.Size);
+    }
+
+    HInfo.Version = image.Version;
+    HInfo.Mode = image.Mode;
+    HInfo.StartAddress = image.StartAddress;
+    return true;
+}
+
+/**
+ * Stores the header information, the section table and the path of every
+ * recorded loop of the loaded file in the cache directory. Nothing is written
+ * if the image cache is disabled or the cached image already has all of them.
+ */
+void UVM::storeCache() {
+    if (!UseImageCache) {
+        return;
+    }
+
+    CachedImage image;
+    image.Version = HInfo.Version;
+    image.Mode = HInfo.Mode;
+    image.StartAddress = HInfo.StartAddress;
+    for (const MemSection& sec : MMU.Sections) {
+        image.Sections.push_back({static_cast<uint8_t>(sec.Type), sec.Perm,
+                                  sec.VStartAddr, sec.Size});
+    }
+    for (const auto& [headIP, loop] : LoopTraces.Loops) {
+        if (!loop.Trace.Path.empty()) {
+            image.Loops.push_back({headIP, loop.Trace.Path});
+        }
+    }
+
+    if (ImageCached && image.Loops.size() == CachedLoopCount) {
+        return;
+    }
+    writeCachedImage(Digest, FileSize, image);
+}
+
+/**
+ * Attaches a heap profiler to the memory manager. Only allocations made after
+ * this call are recorded.
+ */
+void UVM::enableHeapProfile() {
+    if (HeapProfile == nullptr) {
+        HeapProfile = std::make_unique<HeapProfiler>();
+        MMU.Profiler = HeapProfile.get();
+    }
+}
+
+/**
+ * Attaches a garbage collector to the memory manager. Blocks allocated before
+ * this call are never collected.
+ */
+void UVM::enableGarbageCollector() {
+    if (Collector == nullptr) {
+        Collector = std::make_unique<HeapCollector>();
+        MMU.Collector = Collector.get();
+    }
+}
+
+/**
+ * Deallocates all heap blocks which cannot be reached by the program anymore.
+ * Buffers of pending asynchronous reads are kept.
+ * @return Number of bytes deallocated, 0 if there is no garbage collector
+ */
+uint64_t UVM::collectGarbage() {
+    if (Collector == nullptr) {
+        return 0;
+    }
+
+    std::vector<uint64_t> roots;
+    Async.pendingReads(roots);
+    return Collector->collect(MMU, roots);
+}
+
+/**
+ * Fetches instruction until execution is stopped or an error occures. Taken
+ * backward jumps are counted so that hot loops run from a recorded trace.
  * @return On success returns UVM_SUCCESS otherwise error code
  */
 uint32_t UVM::run() {
+    uint32_t status = UVM_SUCCESS;
+    uint64_t& ip = MMU.Regs[REG_INSTR_PTR].I64;
+    while (Opcode != OP_EXIT && status == UVM_SUCCESS) {
+        uint64_t prevIP = ip;
+        status = nextInstr();
+
+        // Taken backward jumps close a loop
+        if (ip < prevIP && Opcode >= OP_JMP && Opcode <= OP_JLE &&
+            status == UVM_SUCCESS) {
+            status = LoopTraces.onBackEdge(this, ip);
+        }
+    }
+    return status;
+}
+
+/**
+ * Same as run() but records every executed instruction into the tracer
+ * @param tracer Tracer receiving the execution trace
+ * @return On success returns UVM_SUCCESS otherwise error code
+ */
+uint32_t UVM::runTraced(Tracer& tracer) {
     uint32_t status = UVM_SUCCESS;
     while (Opcode != OP_EXIT && status == UVM_SUCCESS) {
+        tracer.begin(MMU);
         status = nextInstr();
+        tracer.commit(MMU, Opcode);
     }
     return status;
 }
@@ -326,598 +490,634 @@ uint32_t UVM::run() {
  * @return On success returns UVM_SUCCESS otherwise error code
  */
 uint32_t UVM::nextInstr() {
-    uint32_t instrWidth = 1;
-
     // Get opcode byte
     uint32_t readRes =
-        MMU.read(MMU.IP, &Opcode, UVMDataSize::BYTE, PERM_EXE_MASK);
+        MMU.read(MMU.Regs[REG_INSTR_PTR].I64, &Opcode, UVMDataSize::BYTE,
+                 PERM_EXE_MASK);
     if (readRes != UVM_SUCCESS) {
         return false;
     }
 
-    uint32_t (*instrCall)(UVM * vm, uint32_t instrWidth, uint32_t flag) =
-        nullptr;
-    uint32_t instrFlag = 0;
+    if (Opcode == OP_EXIT) {
+        return UVM_SUCCESS;
+    }
 
-    switch (Opcode) {
+    DecodedInstr instr;
+    if (decodeInstr(Opcode, instr) != UVM_SUCCESS) {
+        return E_UNKNOWN_OP_CODE;
+    }
+
+    uint32_t fetchRes =
+        MMU.fetchInstruction(MMU.InstrBuffer.data(), instr.Width);
+    if (fetchRes != UVM_SUCCESS) {
+        return E_INVALID_READ;
+    }
+
+    // If Opcode is NOP then the handler will be nullptr
+    uint32_t instrStatus = UVM_SUCCESS;
+    if (instr.Handler != nullptr) {
+        instrStatus = instr.Handler(this, instr.Width, instr.Flag);
+        // UVM_SUCCESS_JUMPED is not meaningful for caller of this function
+        if (instrStatus == UVM_SUCCESS_JUMPED) {
+            return UVM_SUCCESS;
+        }
+    }
+
+    MMU.Regs[REG_INSTR_PTR].I64 += instr.Width;
+    return instrStatus;
+}
+
+/**
+ * Looks up handler, width and flag of an opcode
+ * @param opcode Opcode to decode
+ * @param instr Output decoded instruction
+ * @return On success returns UVM_SUCCESS otherwise E_UNKNOWN_OP_CODE
+ */
+uint32_t UVM::decodeInstr(uint8_t opcode, DecodedInstr& instr) {
+    switch (opcode) {
 
     case OP_NOP:
-        instrWidth = 1;
+        instr.Width = 1;
         break;
 
     /********************************
         PUSH INSTRUCTIONS
     ********************************/
     case OP_PUSH_I8:
-        instrWidth = 2;
-        instrFlag = static_cast<uint32_t>(IntType::I8);
-        instrCall = instr_push_int;
+        instr.Width = 2;
+        instr.Flag = static_cast<uint32_t>(IntType::I8);
+        instr.Handler = instr_push_int;
         break;
     case OP_PUSH_I16:
-        instrWidth = 3;
-        instrFlag = static_cast<uint32_t>(IntType::I16);
-        instrCall = instr_push_int;
+        instr.Width = 3;
+        instr.Flag = static_cast<uint32_t>(IntType::I16);
+        instr.Handler = instr_push_int;
         break;
     case OP_PUSH_I32:
-        instrWidth = 5;
-        instrFlag = static_cast<uint32_t>(IntType::I32);
-        instrCall = instr_push_int;
+        instr.Width = 5;
+        instr.Flag = static_cast<uint32_t>(IntType::I32);
+        instr.Handler = instr_push_int;
         break;
     case OP_PUSH_I64:
-        instrWidth = 9;
-        instrFlag = static_cast<uint32_t>(IntType::I64);
-        instrCall = instr_push_int;
+        instr.Width = 9;
+        instr.Flag = static_cast<uint32_t>(IntType::I64);
+        instr.Handler = instr_push_int;
         break;
     case OP_PUSH_IT_IR:
-        instrWidth = 3;
-        instrCall = instr_push_ireg;
+        instr.Width = 3;
+        instr.Handler = instr_push_ireg;
         break;
 
     /********************************
         POP INSTRUCTIONS
     ********************************/
     case OP_POP_IT:
-        instrWidth = 2;
-        instrCall = instr_pop;
+        instr.Width = 2;
+        instr.Handler = instr_pop;
         break;
     case OP_POP_IT_IR:
-        instrWidth = 3;
-        instrCall = instr_pop_ireg;
+        instr.Width = 3;
+        instr.Handler = instr_pop_ireg;
         break;
 
     /********************************
         LOAD INSTRUCTIONS
     ********************************/
     case OP_LOAD_I8_IR:
-        instrWidth = 3;
-        instrFlag = static_cast<uint32_t>(IntType::I8);
-        instrCall = instr_load_int_ireg;
+        instr.Width = 3;
+        instr.Flag = static_cast<uint32_t>(IntType::I8);
+        instr.Handler = instr_load_int_ireg;
         break;
     case OP_LOAD_I16_IR:
-        instrWidth = 4;
-        instrFlag = static_cast<uint32_t>(IntType::I16);
-        instrCall = instr_load_int_ireg;
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(IntType::I16);
+        instr.Handler = instr_load_int_ireg;
         break;
     case OP_LOAD_I32_IR:
-        instrWidth = 6;
-        instrFlag = static_cast<uint32_t>(IntType::I32);
-        instrCall = instr_load_int_ireg;
+        instr.Width = 6;
+        instr.Flag = static_cast<uint32_t>(IntType::I32);
+        instr.Handler = instr_load_int_ireg;
         break;
     case OP_LOAD_I64_IR:
-        instrWidth = 10;
-        instrFlag = static_cast<uint32_t>(IntType::I64);
-        instrCall = instr_load_int_ireg;
+        instr.Width = 10;
+        instr.Flag = static_cast<uint32_t>(IntType::I64);
+        instr.Handler = instr_load_int_ireg;
         break;
     case OP_LOAD_IT_RO_IR:
-        instrWidth = 9;
-        instrCall = instr_load_ro_ireg;
+        instr.Width = 9;
+        instr.Handler = instr_load_ro_ireg;
         break;
     case OP_LOAD_F32_FR:
-        instrWidth = 6;
-        instrFlag = static_cast<uint32_t>(FloatType::F32);
-        instrCall = instr_loadf_float_freg;
+        instr.Width = 6;
+        instr.Flag = static_cast<uint32_t>(FloatType::F32);
+        instr.Handler = instr_loadf_float_freg;
         break;
     case OP_LOAD_F64_FR:
-        instrWidth = 10;
-        instrFlag = static_cast<uint32_t>(FloatType::F64);
-        instrCall = instr_loadf_float_freg;
+        instr.Width = 10;
+        instr.Flag = static_cast<uint32_t>(FloatType::F64);
+        instr.Handler = instr_loadf_float_freg;
         break;
     case OP_LOAD_RO_FR:
-        instrWidth = 9;
-        instrCall = instr_loadf_ro_freg;
+        instr.Width = 9;
+        instr.Handler = instr_loadf_ro_freg;
         break;
 
     /********************************
         STORE INSTRUCTION
     ********************************/
     case OP_STORE_IT_IR_RO:
-        instrWidth = 9;
-        instrCall = instr_store_ireg_ro;
+        instr.Width = 9;
+        instr.Handler = instr_store_ireg_ro;
         break;
     case OP_STORE_FT_FR_RO:
-        instrWidth = 9;
-        instrCall = instr_storef_freg_ro;
+        instr.Width = 9;
+        instr.Handler = instr_storef_freg_ro;
         break;
 
     /********************************
         COPY INSTRUCTIONS
     ********************************/
     case OP_COPY_I8_RO:
-        instrWidth = 8;
-        instrFlag = static_cast<uint32_t>(IntType::I8);
-        instrCall = instr_copy_int_ro;
+        instr.Width = 8;
+        instr.Flag = static_cast<uint32_t>(IntType::I8);
+        instr.Handler = instr_copy_int_ro;
         break;
     case OP_COPY_I16_RO:
-        instrWidth = 9;
-        instrFlag = static_cast<uint32_t>(IntType::I16);
-        instrCall = instr_copy_int_ro;
+        instr.Width = 9;
+        instr.Flag = static_cast<uint32_t>(IntType::I16);
+        instr.Handler = instr_copy_int_ro;
         break;
     case OP_COPY_I32_RO:
-        instrWidth = 11;
-        instrFlag = static_cast<uint32_t>(IntType::I32);
-        instrCall = instr_copy_int_ro;
+        instr.Width = 11;
+        instr.Flag = static_cast<uint32_t>(IntType::I32);
+        instr.Handler = instr_copy_int_ro;
         break;
     case OP_COPY_I64_RO:
-        instrWidth = 15;
-        instrFlag = static_cast<uint32_t>(IntType::I64);
-        instrCall = instr_copy_int_ro;
+        instr.Width = 15;
+        instr.Flag = static_cast<uint32_t>(IntType::I64);
+        instr.Handler = instr_copy_int_ro;
         break;
     case OP_COPY_IT_IR_IR:
-        instrWidth = 4;
-        instrCall = instr_copy_ireg_ireg;
+        instr.Width = 4;
+        instr.Handler = instr_copy_ireg_ireg;
         break;
     case OP_COPY_IT_RO_RO:
-        instrWidth = 14;
-        instrCall = instr_copy_ro_ro;
+        instr.Width = 14;
+        instr.Handler = instr_copy_ro_ro;
         break;
     case OP_COPY_F32_RO:
-        instrWidth = 11;
-        instrFlag = static_cast<uint32_t>(FloatType::F32);
-        instrCall = instr_copyf_float_ro;
+        instr.Width = 11;
+        instr.Flag = static_cast<uint32_t>(FloatType::F32);
+        instr.Handler = instr_copyf_float_ro;
         break;
     case OP_COPY_F64_RO:
-        instrWidth = 15;
-        instrFlag = static_cast<uint32_t>(FloatType::F64);
-        instrCall = instr_copyf_float_ro;
+        instr.Width = 15;
+        instr.Flag = static_cast<uint32_t>(FloatType::F64);
+        instr.Handler = instr_copyf_float_ro;
         break;
     case OP_COPY_FT_FR_FR:
-        instrWidth = 4;
-        instrCall = instr_copyf_freg_freg;
+        instr.Width = 4;
+        instr.Handler = instr_copyf_freg_freg;
         break;
     case OP_COPY_FT_RO_RO:
-        instrWidth = 14;
-        instrCall = instr_copyf_ro_ro;
+        instr.Width = 14;
+        instr.Handler = instr_copyf_ro_ro;
         break;
 
     /********************************
         ARITHMETIC INSTRUCTIONS
     ********************************/
     case OP_ADD_IR_I8:
-        instrWidth = 3;
-        instrFlag = INSTR_FLAG_OP_ADD | INSTR_FLAG_TYPE_I8;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 3;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::ADD, IntType::I8>;
         break;
     case OP_ADD_IR_I16:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_ADD | INSTR_FLAG_TYPE_I16;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 4;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::ADD, IntType::I16>;
         break;
     case OP_ADD_IR_I32:
-        instrWidth = 6;
-        instrFlag = INSTR_FLAG_OP_ADD | INSTR_FLAG_TYPE_I32;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 6;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::ADD, IntType::I32>;
         break;
     case OP_ADD_IR_I64:
-        instrWidth = 10;
-        instrFlag = INSTR_FLAG_OP_ADD | INSTR_FLAG_TYPE_I64;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 10;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::ADD, IntType::I64>;
         break;
     case OP_ADD_IT_IR_IR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_ADD;
-        instrCall = instr_arithm_common_ireg_ireg;
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(ArithmOp::ADD);
+        instr.Handler = instr_arithm_common_ireg_ireg;
         break;
     case OP_ADDF_FT_FR_FR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_ADD;
-        instrCall = instr_arithm_common_freg_freg;
+        instr.Width = 4;
+        instr.Flag = INSTR_FLAG_OP_ADD;
+        instr.Handler = instr_arithm_common_freg_freg;
         break;
     case OP_ADDF_FR_F32:
-        instrWidth = 6;
-        instrFlag = INSTR_FLAG_OP_ADD | INSTR_FLAG_TYPE_F32;
-        instrCall = instr_arithm_common_freg_float;
+        instr.Width = 6;
+        instr.Flag = INSTR_FLAG_OP_ADD | INSTR_FLAG_TYPE_F32;
+        instr.Handler = instr_arithm_common_freg_float;
         break;
     case OP_ADDF_FR_F64:
-        instrWidth = 10;
-        instrFlag = INSTR_FLAG_OP_ADD | INSTR_FLAG_TYPE_F64;
-        instrCall = instr_arithm_common_freg_float;
+        instr.Width = 10;
+        instr.Flag = INSTR_FLAG_OP_ADD | INSTR_FLAG_TYPE_F64;
+        instr.Handler = instr_arithm_common_freg_float;
         break;
 
     case OP_SUB_IR_I8:
-        instrWidth = 3;
-        instrFlag = INSTR_FLAG_OP_SUB | INSTR_FLAG_TYPE_I8;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 3;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::SUB, IntType::I8>;
         break;
     case OP_SUB_IR_I16:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_SUB | INSTR_FLAG_TYPE_I16;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 4;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::SUB, IntType::I16>;
         break;
     case OP_SUB_IR_I32:
-        instrWidth = 6;
-        instrFlag = INSTR_FLAG_OP_SUB | INSTR_FLAG_TYPE_I32;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 6;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::SUB, IntType::I32>;
         break;
     case OP_SUB_IR_I64:
-        instrWidth = 10;
-        instrFlag = INSTR_FLAG_OP_SUB | INSTR_FLAG_TYPE_I64;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 10;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::SUB, IntType::I64>;
         break;
     case OP_SUB_IT_IR_IR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_SUB;
-        instrCall = instr_arithm_common_ireg_ireg;
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(ArithmOp::SUB);
+        instr.Handler = instr_arithm_common_ireg_ireg;
         break;
     case OP_SUBF_FT_FR_FR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_SUB;
-        instrCall = instr_arithm_common_freg_freg;
+        instr.Width = 4;
+        instr.Flag = INSTR_FLAG_OP_SUB;
+        instr.Handler = instr_arithm_common_freg_freg;
         break;
     case OP_SUBF_FR_F32:
-        instrWidth = 6;
-        instrFlag = INSTR_FLAG_OP_SUB | INSTR_FLAG_TYPE_F32;
-        instrCall = instr_arithm_common_freg_float;
+        instr.Width = 6;
+        instr.Flag = INSTR_FLAG_OP_SUB | INSTR_FLAG_TYPE_F32;
+        instr.Handler = instr_arithm_common_freg_float;
         break;
     case OP_SUBF_FR_F64:
-        instrWidth = 10;
-        instrFlag = INSTR_FLAG_OP_SUB | INSTR_FLAG_TYPE_F64;
-        instrCall = instr_arithm_common_freg_float;
+        instr.Width = 10;
+        instr.Flag = INSTR_FLAG_OP_SUB | INSTR_FLAG_TYPE_F64;
+        instr.Handler = instr_arithm_common_freg_float;
         break;
 
     case OP_MUL_IR_I8:
-        instrWidth = 3;
-        instrFlag = INSTR_FLAG_OP_MUL | INSTR_FLAG_TYPE_I8;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 3;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::MUL, IntType::I8>;
         break;
     case OP_MUL_IR_I16:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_MUL | INSTR_FLAG_TYPE_I16;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 4;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::MUL, IntType::I16>;
         break;
     case OP_MUL_IR_I32:
-        instrWidth = 6;
-        instrFlag = INSTR_FLAG_OP_MUL | INSTR_FLAG_TYPE_I32;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 6;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::MUL, IntType::I32>;
         break;
     case OP_MUL_IR_I64:
-        instrWidth = 10;
-        instrFlag = INSTR_FLAG_OP_MUL | INSTR_FLAG_TYPE_I64;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 10;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::MUL, IntType::I64>;
         break;
     case OP_MUL_IT_IR_IR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_MUL;
-        instrCall = instr_arithm_common_ireg_ireg;
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(ArithmOp::MUL);
+        instr.Handler = instr_arithm_common_ireg_ireg;
         break;
     case OP_MULF_FT_FR_FR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_MUL;
-        instrCall = instr_arithm_common_freg_freg;
+        instr.Width = 4;
+        instr.Flag = INSTR_FLAG_OP_MUL;
+        instr.Handler = instr_arithm_common_freg_freg;
         break;
     case OP_MULF_FR_F32:
-        instrWidth = 6;
-        instrFlag = INSTR_FLAG_OP_MUL | INSTR_FLAG_TYPE_F32;
-        instrCall = instr_arithm_common_freg_float;
+        instr.Width = 6;
+        instr.Flag = INSTR_FLAG_OP_MUL | INSTR_FLAG_TYPE_F32;
+        instr.Handler = instr_arithm_common_freg_float;
         break;
     case OP_MULF_FR_F64:
-        instrWidth = 10;
-        instrFlag = INSTR_FLAG_OP_MUL | INSTR_FLAG_TYPE_F64;
-        instrCall = instr_arithm_common_freg_float;
+        instr.Width = 10;
+        instr.Flag = INSTR_FLAG_OP_MUL | INSTR_FLAG_TYPE_F64;
+        instr.Handler = instr_arithm_common_freg_float;
         break;
     case OP_MULS_IR_I8:
-        instrWidth = 3;
-        instrFlag = INSTR_FLAG_OP_MULS | INSTR_FLAG_TYPE_I8;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 3;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::MULS, IntType::I8>;
         break;
     case OP_MULS_IR_I16:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_MULS | INSTR_FLAG_TYPE_I16;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 4;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::MULS, IntType::I16>;
         break;
     case OP_MULS_IR_I32:
-        instrWidth = 6;
-        instrFlag = INSTR_FLAG_OP_MULS | INSTR_FLAG_TYPE_I32;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 6;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::MULS, IntType::I32>;
         break;
     case OP_MULS_IR_I64:
-        instrWidth = 10;
-        instrFlag = INSTR_FLAG_OP_MULS | INSTR_FLAG_TYPE_I64;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 10;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::MULS, IntType::I64>;
         break;
     case OP_MULS_IT_IR_IR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_MULS;
-        instrCall = instr_arithm_common_ireg_ireg;
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(ArithmOp::MULS);
+        instr.Handler = instr_arithm_common_ireg_ireg;
         break;
 
     case OP_DIV_IR_I8:
-        instrWidth = 3;
-        instrFlag = INSTR_FLAG_OP_DIV | INSTR_FLAG_TYPE_I8;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 3;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::DIV, IntType::I8>;
         break;
     case OP_DIV_IR_I16:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_DIV | INSTR_FLAG_TYPE_I16;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 4;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::DIV, IntType::I16>;
         break;
     case OP_DIV_IR_I32:
-        instrWidth = 6;
-        instrFlag = INSTR_FLAG_OP_DIV | INSTR_FLAG_TYPE_I32;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 6;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::DIV, IntType::I32>;
         break;
     case OP_DIV_IR_I64:
-        instrWidth = 10;
-        instrFlag = INSTR_FLAG_OP_DIV | INSTR_FLAG_TYPE_I64;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 10;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::DIV, IntType::I64>;
         break;
     case OP_DIV_IT_IR_IR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_DIV;
-        instrCall = instr_arithm_common_ireg_ireg;
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(ArithmOp::DIV);
+        instr.Handler = instr_arithm_common_ireg_ireg;
         break;
     case OP_DIVF_FT_FR_FR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_DIV;
-        instrCall = instr_arithm_common_freg_freg;
+        instr.Width = 4;
+        instr.Flag = INSTR_FLAG_OP_DIV;
+        instr.Handler = instr_arithm_common_freg_freg;
         break;
     case OP_DIVF_FR_F32:
-        instrWidth = 6;
-        instrFlag = INSTR_FLAG_OP_DIV | INSTR_FLAG_TYPE_F32;
-        instrCall = instr_arithm_common_freg_float;
+        instr.Width = 6;
+        instr.Flag = INSTR_FLAG_OP_DIV | INSTR_FLAG_TYPE_F32;
+        instr.Handler = instr_arithm_common_freg_float;
         break;
     case OP_DIVF_FR_F64:
-        instrWidth = 10;
-        instrFlag = INSTR_FLAG_OP_DIV | INSTR_FLAG_TYPE_F64;
-        instrCall = instr_arithm_common_freg_float;
+        instr.Width = 10;
+        instr.Flag = INSTR_FLAG_OP_DIV | INSTR_FLAG_TYPE_F64;
+        instr.Handler = instr_arithm_common_freg_float;
         break;
     case OP_DIVS_IR_I8:
-        instrWidth = 3;
-        instrFlag = INSTR_FLAG_OP_DIVS | INSTR_FLAG_TYPE_I8;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 3;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::DIVS, IntType::I8>;
         break;
     case OP_DIVS_IR_I16:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_DIVS | INSTR_FLAG_TYPE_I16;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 4;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::DIVS, IntType::I16>;
         break;
     case OP_DIVS_IR_I32:
-        instrWidth = 6;
-        instrFlag = INSTR_FLAG_OP_DIVS | INSTR_FLAG_TYPE_I32;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 6;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::DIVS, IntType::I32>;
         break;
     case OP_DIVS_IR_I64:
-        instrWidth = 10;
-        instrFlag = INSTR_FLAG_OP_DIVS | INSTR_FLAG_TYPE_I64;
-        instrCall = instr_arithm_common_ireg_int;
+        instr.Width = 10;
+        instr.Handler = instr_arithm_ireg_int<ArithmOp::DIVS, IntType::I64>;
         break;
     case OP_DIVS_IT_IR_IR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_DIVS;
-        instrCall = instr_arithm_common_ireg_ireg;
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(ArithmOp::DIVS);
+        instr.Handler = instr_arithm_common_ireg_ireg;
         break;
 
     case OP_SQRT:
-        instrWidth = 3;
-        instrCall = instr_sqrt;
+        instr.Width = 3;
+        instr.Handler = instr_sqrt;
         break;
     case OP_MOD:
-        instrWidth = 4;
-        instrCall = instr_mod;
+        instr.Width = 4;
+        instr.Handler = instr_mod;
         break;
 
     case OP_AND_IT_IR_IR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_AND;
-        instrCall = instr_bitwise_common_itype_ireg_ireg;
+        instr.Width = 4;
+        instr.Flag = INSTR_FLAG_OP_AND;
+        instr.Handler = instr_bitwise_common_itype_ireg_ireg;
         break;
     case OP_OR_IT_IR_IR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_OR;
-        instrCall = instr_bitwise_common_itype_ireg_ireg;
+        instr.Width = 4;
+        instr.Flag = INSTR_FLAG_OP_OR;
+        instr.Handler = instr_bitwise_common_itype_ireg_ireg;
         break;
     case OP_XOR_IT_IR_IR:
-        instrWidth = 4;
-        instrFlag = INSTR_FLAG_OP_XOR;
-        instrCall = instr_bitwise_common_itype_ireg_ireg;
+        instr.Width = 4;
+        instr.Flag = INSTR_FLAG_OP_XOR;
+        instr.Handler = instr_bitwise_common_itype_ireg_ireg;
         break;
     case OP_NOT_IT_IR:
-        instrWidth = 3;
-        instrCall = instr_not_itype_ireg;
+        instr.Width = 3;
+        instr.Handler = instr_not_itype_ireg;
         break;
 
     case OP_LSH:
-        instrWidth = 3;
-        instrFlag = INSTR_FLAG_OP_LSH;
-        instrCall = instr_shift_common_ireg_ireg;
+        instr.Width = 3;
+        instr.Flag = INSTR_FLAG_OP_LSH;
+        instr.Handler = instr_shift_common_ireg_ireg;
         break;
     case OP_RSH:
-        instrWidth = 3;
-        instrFlag = INSTR_FLAG_OP_RSH;
-        instrCall = instr_shift_common_ireg_ireg;
+        instr.Width = 3;
+        instr.Flag = INSTR_FLAG_OP_RSH;
+        instr.Handler = instr_shift_common_ireg_ireg;
         break;
     case OP_SRSH:
-        instrWidth = 3;
-        instrFlag = INSTR_FLAG_OP_SRSH;
-        instrCall = instr_shift_common_ireg_ireg;
+        instr.Width = 3;
+        instr.Flag = INSTR_FLAG_OP_SRSH;
+        instr.Handler = instr_shift_common_ireg_ireg;
         break;
 
     /********************************
         LEA INSTRUCTION
     ********************************/
     case OP_LEA_RO_IR:
-        instrWidth = 8;
-        instrCall = instr_lea_ro_ireg;
+        instr.Width = 8;
+        instr.Handler = instr_lea_ro_ireg;
         break;
 
     /********************************
         SYSCALL
     ********************************/
     case OP_SYS:
-        instrWidth = 2;
-        instrCall = instr_syscall;
+        instr.Width = 2;
+        instr.Handler = instr_syscall;
         break;
 
     /********************************
         CALL and RET
     ********************************/
     case OP_CALL:
-        instrWidth = 9;
-        instrCall = instr_call;
+        instr.Width = 9;
+        instr.Handler = instr_call;
         break;
     case OP_RET:
-        instrWidth = 1;
-        instrCall = instr_ret;
+        instr.Width = 1;
+        instr.Handler = instr_ret;
         break;
 
     /********************************
         CONDITIONS
     ********************************/
     case OP_JMP: {
-        instrWidth = 9;
-        instrFlag = static_cast<uint32_t>(JumpCondition::UNCONDITIONAL);
-        instrCall = instr_jmp;
+        instr.Width = 9;
+        instr.Flag = static_cast<uint32_t>(JumpCondition::UNCONDITIONAL);
+        instr.Handler = instr_jmp;
         break;
     }
     case OP_JE: {
-        instrWidth = 9;
-        instrFlag = static_cast<uint32_t>(JumpCondition::IF_EQUALS);
-        instrCall = instr_jmp;
+        instr.Width = 9;
+        instr.Flag = static_cast<uint32_t>(JumpCondition::IF_EQUALS);
+        instr.Handler = instr_jmp;
         break;
     }
     case OP_JNE: {
-        instrWidth = 9;
-        instrFlag = static_cast<uint32_t>(JumpCondition::IF_NOT_EQUALS);
-        instrCall = instr_jmp;
+        instr.Width = 9;
+        instr.Flag = static_cast<uint32_t>(JumpCondition::IF_NOT_EQUALS);
+        instr.Handler = instr_jmp;
         break;
     }
     case OP_JGT: {
-        instrWidth = 9;
-        instrFlag = static_cast<uint32_t>(JumpCondition::IF_GREATER_THAN);
-        instrCall = instr_jmp;
+        instr.Width = 9;
+        instr.Flag = static_cast<uint32_t>(JumpCondition::IF_GREATER_THAN);
+        instr.Handler = instr_jmp;
         break;
     }
     case OP_JLT: {
-        instrWidth = 9;
-        instrFlag = static_cast<uint32_t>(JumpCondition::IF_LESS_THAN);
-        instrCall = instr_jmp;
+        instr.Width = 9;
+        instr.Flag = static_cast<uint32_t>(JumpCondition::IF_LESS_THAN);
+        instr.Handler = instr_jmp;
         break;
     }
     case OP_JGE: {
-        instrWidth = 9;
-        instrFlag = static_cast<uint32_t>(JumpCondition::IF_GREATER_EQUALS);
-        instrCall = instr_jmp;
+        instr.Width = 9;
+        instr.Flag = static_cast<uint32_t>(JumpCondition::IF_GREATER_EQUALS);
+        instr.Handler = instr_jmp;
         break;
     }
     case OP_JLE: {
-        instrWidth = 9;
-        instrFlag = static_cast<uint32_t>(JumpCondition::IF_LESS_EQUALS);
-        instrCall = instr_jmp;
+        instr.Width = 9;
+        instr.Flag = static_cast<uint32_t>(JumpCondition::IF_LESS_EQUALS);
+        instr.Handler = instr_jmp;
         break;
     }
     case OP_CMP_IT_IR_IR:
-        instrWidth = 4;
-        instrCall = instr_cmp;
+        instr.Width = 4;
+        instr.Handler = instr_cmp;
         break;
     case OP_CMPF_FT_FR_FR:
-        instrWidth = 4;
-        instrCall = instr_cmpf;
+        instr.Width = 4;
+        instr.Handler = instr_cmpf;
         break;
 
     /********************************
         TYPE CASTING
     ********************************/
     case OP_B2L:
-        instrWidth = 2;
-        instrFlag = static_cast<uint32_t>(IntType::I8);
-        instrCall = instr_unsigned_cast_to_long;
+        instr.Width = 2;
+        instr.Flag = static_cast<uint32_t>(IntType::I8);
+        instr.Handler = instr_unsigned_cast_to_long;
         break;
     case OP_S2L:
-        instrWidth = 2;
-        instrFlag = static_cast<uint32_t>(IntType::I16);
-        instrCall = instr_unsigned_cast_to_long;
+        instr.Width = 2;
+        instr.Flag = static_cast<uint32_t>(IntType::I16);
+        instr.Handler = instr_unsigned_cast_to_long;
         break;
     case OP_I2L:
-        instrWidth = 2;
-        instrFlag = static_cast<uint32_t>(IntType::I32);
-        instrCall = instr_unsigned_cast_to_long;
+        instr.Width = 2;
+        instr.Flag = static_cast<uint32_t>(IntType::I32);
+        instr.Handler = instr_unsigned_cast_to_long;
         break;
 
     case OP_B2SL:
-        instrWidth = 2;
-        instrFlag = INSTR_FLAG_TYPE_I8;
-        instrCall = instr_signed_cast_to_long;
+        instr.Width = 2;
+        instr.Flag = INSTR_FLAG_TYPE_I8;
+        instr.Handler = instr_signed_cast_to_long;
         break;
     case OP_S2SL:
-        instrWidth = 2;
-        instrFlag = INSTR_FLAG_TYPE_I16;
-        instrCall = instr_signed_cast_to_long;
+        instr.Width = 2;
+        instr.Flag = INSTR_FLAG_TYPE_I16;
+        instr.Handler = instr_signed_cast_to_long;
         break;
     case OP_I2SL:
-        instrWidth = 2;
-        instrFlag = INSTR_FLAG_TYPE_I32;
-        instrCall = instr_signed_cast_to_long;
+        instr.Width = 2;
+        instr.Flag = INSTR_FLAG_TYPE_I32;
+        instr.Handler = instr_signed_cast_to_long;
         break;
 
     case OP_F2D:
-        instrWidth = 2;
-        instrCall = instr_f2d;
+        instr.Width = 2;
+        instr.Handler = instr_f2d;
         break;
     case OP_D2F:
-        instrWidth = 2;
-        instrCall = instr_d2f;
+        instr.Width = 2;
+        instr.Handler = instr_d2f;
         break;
     case OP_I2F:
-        instrWidth = 3;
-        instrCall = instr_i2f;
+        instr.Width = 3;
+        instr.Handler = instr_i2f;
         break;
     case OP_I2D:
-        instrWidth = 3;
-        instrCall = instr_i2d;
+        instr.Width = 3;
+        instr.Handler = instr_i2d;
         break;
     case OP_F2I:
-        instrWidth = 3;
-        instrCall = instr_f2i;
+        instr.Width = 3;
+        instr.Handler = instr_f2i;
         break;
     case OP_D2I:
-        instrWidth = 3;
-        instrCall = instr_d2i;
+        instr.Width = 3;
+        instr.Handler = instr_d2i;
         break;
 
     /********************************
-        EXIT
+        VECTOR INSTRUCTIONS
     ********************************/
-    case OP_EXIT:
-        return UVM_SUCCESS;
+    case OP_VLOAD_RO_VR:
+        instr.Width = 8;
+        instr.Handler = instr_vload_ro_vreg;
+        break;
+    case OP_VSTORE_VR_RO:
+        instr.Width = 8;
+        instr.Handler = instr_vstore_vreg_ro;
+        break;
+    case OP_VADD_VT_VR_VR:
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(VecOp::ADD);
+        instr.Handler = instr_varithm_vtype_vreg_vreg;
+        break;
+    case OP_VSUB_VT_VR_VR:
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(VecOp::SUB);
+        instr.Handler = instr_varithm_vtype_vreg_vreg;
+        break;
+    case OP_VMUL_VT_VR_VR:
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(VecOp::MUL);
+        instr.Handler = instr_varithm_vtype_vreg_vreg;
+        break;
+    case OP_VMIN_VT_VR_VR:
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(VecOp::MIN);
+        instr.Handler = instr_varithm_vtype_vreg_vreg;
+        break;
+    case OP_VMAX_VT_VR_VR:
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(VecOp::MAX);
+        instr.Handler = instr_varithm_vtype_vreg_vreg;
+        break;
+    case OP_VCMPEQ_VT_VR_VR:
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(VecOp::CMPEQ);
+        instr.Handler = instr_varithm_vtype_vreg_vreg;
+        break;
+    case OP_VCMPGT_VT_VR_VR:
+        instr.Width = 4;
+        instr.Flag = static_cast<uint32_t>(VecOp::CMPGT);
+        instr.Handler = instr_varithm_vtype_vreg_vreg;
+        break;
+    case OP_VSHUF_VR_I8_VR:
+        instr.Width = 4;
+        instr.Handler = instr_vshuf_vreg_int_vreg;
+        break;
+
     default:
         return E_UNKNOWN_OP_CODE;
     }
 
-    uint32_t fetchRes =
-        MMU.fetchInstruction(MMU.InstrBuffer.data(), instrWidth);
-    if (fetchRes != UVM_SUCCESS) {
-        return E_INVALID_READ;
-    }
-
-    // If Opcode is NOP then instrCall will be nullptr
-    uint32_t instrStatus = UVM_SUCCESS;
-    if (instrCall != nullptr) {
-        instrStatus = instrCall(this, instrWidth, instrFlag);
-        // UVM_SUCCESS_JUMPED is not meaningful for caller of this function
-        if (instrStatus == UVM_SUCCESS_JUMPED) {
-            return UVM_SUCCESS;
-        }
-    }
-
-    MMU.IP += instrWidth;
-    return instrStatus;
+    return UVM_SUCCESS;
 }
@@ -15,13 +15,34 @@
 // ======================================================================== //
 
 #pragma once
+#include "async_io.hpp"
+#include "debug/heap_profiler.hpp"
+#include "gc.hpp"
+#include "jit/code_cache.hpp"
+#include "jit/loop_trace.hpp"
 #include "memory.hpp"
 #include <cstdint>
 #include <filesystem>
 #include <memory>
-#include <sstream>
+#include <string>
 #include <vector>
 
+class UVM;
+struct Tracer;
+
+/** Signature of all instruction handlers */
+using InstrHandler = uint32_t (*)(UVM* vm, uint32_t width, uint32_t flag);
+
+/** Static information of an instruction derived from its opcode */
+struct DecodedInstr {
+    /** Instruction handler, nullptr for nop */
+    InstrHandler Handler = nullptr;
+    /** Instruction width in bytes including the opcode */
+    uint32_t Width = 1;
+    /** Flag passed to the handler */
+    uint32_t Flag = 0;
+};
+
 struct HeaderInfo {
     uint8_t Version = 0;
     uint8_t Mode = 0;
@@ -42,20 +63,50 @@ class UVM {
     /** Current opcode */
     uint8_t Opcode = 0;
     /** Console buffer used for the debugger */
-    std::stringstream DbgConsole;
+    std::string DbgConsole;
+    /** Hot loop detection and recorded loop traces used by run() */
+    LoopTraceCache LoopTraces;
+    /** Take the load-time results and hot loops from the image cache */
+    bool UseImageCache = false;
+    /** Files opened by the program */
+    FileTable Files;
+    /** Asynchronous reads and writes of Files, destroyed before them */
+    AsyncIO Async;
+    /** Standard input of the console syscalls */
+    StdinReader Stdin;
+    /** Heap profiler attached to MMU, null unless enabled */
+    std::unique_ptr<HeapProfiler> HeapProfile;
+    /** Garbage collector attached to MMU, null unless enabled */
+    std::unique_ptr<HeapCollector> Collector;
 
     void setFilePath(std::filesystem::path p);
     bool init();
     uint32_t run();
+    uint32_t runTraced(Tracer& tracer);
     uint32_t nextInstr();
+    static uint32_t decodeInstr(uint8_t opcode, DecodedInstr& instr);
     uint8_t* readSource(std::filesystem::path p, size_t* size);
     uint32_t loadFile(uint8_t* buff, size_t size);
+    void storeCache();
+    void enableHeapProfile();
+    void enableGarbageCollector();
+    uint64_t collectGarbage();
 
   private:
     /** Source file path */
     std::filesystem::path SourcePath;
     /** Header information */
     HeaderInfo HInfo;
+    /** Content digest of the loaded file, valid if UseImageCache */
+    ContentDigest Digest = {};
+    /** Size of the loaded file */
+    uint64_t FileSize = 0;
+    /** The loaded file was validated by an earlier run */
+    bool ImageCached = false;
+    /** Number of loops restored from the cached image */
+    size_t CachedLoopCount = 0;
+
+    bool loadCachedImage(const CachedImage& image, size_t size);
 };
 
 bool validateHeader(HeaderInfo* info, uint8_t* source, size_t size);